@@ -0,0 +1,21 @@
+/*
+ * Shared helpers for the benchmark programs.
+ */
+#include <time.h>
+
+/*
+ * Return the current time in seconds, for measuring elapsed intervals.
+ */
+static inline double bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Return the number of nanoseconds per operation for 'ops' operations that
+ * took 'secs' seconds.
+ */
+static inline double bench_ns_per_op(const double secs, const size_t ops) {
+    return ops ? secs * 1e9 / ops : 0;
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "./bench.h"
+#include "../chashmap.h"
+#include "../hashmap.h"
+
+#define KEYSIZE 16
+#define NKEYS 100000
+#define OPS 4000000
+#define MAX_THREADS 64
+
+/*
+ * Compare the concurrent chashmap with a plain hashmap behind one global
+ * mutex, which is how the hashmap has to be shared between threads.
+ *
+ * Each workload does OPS operations in total, split evenly between the
+ * threads, on keys chosen at random from a map prefilled with NKEYS keys.
+ * Writes overwrite an existing key with a new value.
+ */
+
+struct bench_run {
+    struct chashmap *cm;
+    struct hashmap *hm;
+    pthread_mutex_t *lock;
+    const char *keys;
+    int write_pct;
+    size_t ops;
+    unsigned long long seed;
+};
+
+static inline unsigned long long next_random(unsigned long long *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+static void *run_chashmap(void *p) {
+    struct bench_run *r = p;
+    volatile size_t found = 0;
+    for (size_t i = 0; i < r->ops; i++) {
+        const unsigned long long x = next_random(&r->seed);
+        const char *k = &r->keys[(x % NKEYS) * KEYSIZE];
+        if ((int) ((x >> 32) % 100) < r->write_pct) {
+            int *v = malloc(sizeof *v);
+            *v = (int) i;
+            chashmap_set(r->cm, k, v);
+        } else {
+            found += chashmap_get(r->cm, k) != 0;
+        }
+    }
+    return 0;
+}
+
+static void *run_locked(void *p) {
+    struct bench_run *r = p;
+    volatile size_t found = 0;
+    for (size_t i = 0; i < r->ops; i++) {
+        const unsigned long long x = next_random(&r->seed);
+        const char *k = &r->keys[(x % NKEYS) * KEYSIZE];
+        pthread_mutex_lock(r->lock);
+        if ((int) ((x >> 32) % 100) < r->write_pct) {
+            int *v = malloc(sizeof *v);
+            *v = (int) i;
+            hashmap_set(r->hm, k, v);
+        } else {
+            found += hashmap_get(r->hm, k) != 0;
+        }
+        pthread_mutex_unlock(r->lock);
+    }
+    return 0;
+}
+
+/*
+ * Run 'fn' on 'nthreads' threads sharing 'base', and return the throughput
+ * in millions of operations per second.
+ */
+static double bench_threads(
+        void *(*fn)(void *),
+        const struct bench_run *base,
+        const int nthreads) {
+    pthread_t threads[MAX_THREADS];
+    struct bench_run runs[MAX_THREADS];
+    double t0 = bench_now();
+    for (int i = 0; i < nthreads; i++) {
+        runs[i] = *base;
+        runs[i].ops = OPS / nthreads;
+        runs[i].seed = 0x9E3779B97F4A7C15ull * (i + 1);
+        pthread_create(&threads[i], 0, fn, &runs[i]);
+    }
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], 0);
+    }
+    double t1 = bench_now();
+    return (double) (OPS / nthreads) * nthreads / (t1 - t0) / 1e6;
+}
+
+int main(void) {
+    char *keys = malloc(NKEYS * KEYSIZE);
+    struct chashmap *cm = chashmap_create();
+    struct hashmap *hm = hashmap_create_with_hash(hash_xx64_len);
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    for (size_t i = 0; i < NKEYS; i++) {
+        snprintf(&keys[i * KEYSIZE], KEYSIZE, "key:%zu", i);
+        int *v = malloc(sizeof *v);
+        *v = (int) i;
+        chashmap_set(cm, &keys[i * KEYSIZE], v);
+        v = malloc(sizeof *v);
+        *v = (int) i;
+        hashmap_set(hm, &keys[i * KEYSIZE], v);
+    }
+
+    const int WRITES[] = {5, 50};
+    printf("%-8s %8s %14s %14s\n",
+            "writes", "threads", "chashmap Mops", "locked Mops");
+    for (size_t w = 0; w < sizeof WRITES / sizeof WRITES[0]; w++) {
+        struct bench_run base = {cm, hm, &lock, keys, WRITES[w], 0, 0};
+        for (int n = 1; n <= MAX_THREADS; n *= 2) {
+            printf("%7d%% %8d %14.2f %14.2f\n", WRITES[w], n,
+                    bench_threads(run_chashmap, &base, n),
+                    bench_threads(run_locked, &base, n));
+        }
+    }
+
+    chashmap_destroy(cm);
+    hashmap_destroy(hm);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "./bench.h"
+#include "../fhashmap.h"
+
+#define KEYSIZE 24
+
+/*
+ * Compare the cost of freezing a hashmap with hashmap_freeze() against what
+ * it buys back on lookups, for keys that are all present and for keys that
+ * are all missing.  Keys are looked up in a random order, so neither map
+ * gains from its entries lying in memory in the order they were added.
+ */
+
+static void bench(const size_t n, const char *keys, const size_t *order) {
+    volatile size_t found = 0;
+    double t0 = bench_now();
+    struct hashmap *m = hashmap_create_with_hash(hash_xx64_len);
+    for (size_t i = 0; i < n; i++) {
+        int *v = malloc(sizeof *v);
+        *v = (int) i;
+        hashmap_set(m, &keys[i * KEYSIZE], v);
+    }
+    double t1 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += hashmap_get(m, &keys[order[i] * KEYSIZE]) != 0;
+    }
+    double t2 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += hashmap_get(m, &keys[(order[i] + n) * KEYSIZE]) != 0;
+    }
+    double t3 = bench_now();
+    struct fhashmap *f = hashmap_freeze(m);
+    double t4 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += fhashmap_get(f, &keys[order[i] * KEYSIZE]) != 0;
+    }
+    double t5 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += fhashmap_get(f, &keys[(order[i] + n) * KEYSIZE]) != 0;
+    }
+    double t6 = bench_now();
+    fhashmap_destroy(f);
+
+    printf("%10zu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", n,
+            (t1 - t0) * 1e3, (t4 - t3) * 1e3,
+            bench_ns_per_op(t2 - t1, n), bench_ns_per_op(t5 - t4, n),
+            bench_ns_per_op(t3 - t2, n), bench_ns_per_op(t6 - t5, n));
+}
+
+int main(int argc, char **argv) {
+    size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 4000000;
+    /* Twice as many keys as the largest map, the second half for misses. */
+    char *keys = malloc(2 * max * KEYSIZE);
+    for (size_t i = 0; i < 2 * max; i++) {
+        snprintf(&keys[i * KEYSIZE], KEYSIZE, "key:%zu", i * 7919);
+    }
+    printf("%10s %10s %10s %10s %10s %10s %10s\n", "keys",
+            "build ms", "freeze ms", "get ns", "frozen ns", "miss ns",
+            "f.miss ns");
+    size_t *order = malloc(max * sizeof *order);
+    for (size_t n = 1000; n <= max; n *= 4) {
+        for (size_t i = 0; i < n; i++) {
+            order[i] = i;
+        }
+        for (size_t i = n - 1; i > 0; i--) {
+            const size_t j = (size_t) rand() % (i + 1);
+            const size_t t = order[i];
+            order[i] = order[j];
+            order[j] = t;
+        }
+        bench(n, keys, order);
+    }
+    free(order);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./bench.h"
+#include "../hashmap.h"
+
+#define KEYSIZE 16
+
+/*
+ * Compare hashmap_get() in a loop with the batched, prefetching
+ * hashmap_get_many(), on maps large enough that nearly every lookup misses
+ * the last-level cache.
+ *
+ * Keys are probed in a random order, so neither the bucket array nor the
+ * slab-allocated entries are walked sequentially.  The probe keys themselves
+ * are laid out in probe order, so reading them costs the same either way.
+ */
+
+static unsigned long long rng = 0x9E3779B97F4A7C15ull;
+
+static size_t random_below(const size_t n) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (size_t) (rng % n);
+}
+
+static void bench_size(const size_t n, const size_t nprobes) {
+    char *keys = malloc(n * KEYSIZE);
+    char *probes = malloc(nprobes * KEYSIZE);
+    const char **probe_keys = malloc(nprobes * sizeof *probe_keys);
+    void **out = malloc(nprobes * sizeof *out);
+    struct hashmap *m = hashmap_create_with_hash(hash_xx64_len);
+
+    for (size_t i = 0; i < n; i++) {
+        snprintf(&keys[i * KEYSIZE], KEYSIZE, "k%zu", i * 7919);
+        int *v = malloc(sizeof *v);
+        *v = (int) i;
+        hashmap_set(m, &keys[i * KEYSIZE], v);
+    }
+    /* Finish any incremental resize, so both methods see the same table. */
+    for (size_t i = 0; i < m->size; i++) {
+        hashmap_get(m, "");
+    }
+    for (size_t i = 0; i < nprobes; i++) {
+        memcpy(&probes[i * KEYSIZE], &keys[random_below(n) * KEYSIZE],
+                KEYSIZE);
+        probe_keys[i] = &probes[i * KEYSIZE];
+    }
+
+    volatile size_t found = 0;
+    double t0 = bench_now();
+    for (size_t i = 0; i < nprobes; i++) {
+        found += hashmap_get(m, probe_keys[i]) != 0;
+    }
+    double t1 = bench_now();
+    hashmap_get_many(m, probe_keys, nprobes, out);
+    double t2 = bench_now();
+    for (size_t i = 0; i < nprobes; i++) {
+        found += out[i] != 0;
+    }
+
+    const double loop = bench_ns_per_op(t1 - t0, nprobes);
+    const double many = bench_ns_per_op(t2 - t1, nprobes);
+    printf("%10zu %10zu %10.1f %10.1f %8.2fx\n", n,
+            (size_t) m->size * sizeof *m->buckets / (1 << 20),
+            loop, many, loop / many);
+
+    hashmap_destroy(m);
+    free(keys);
+    free(probes);
+    free(probe_keys);
+    free(out);
+}
+
+int main(int argc, char *argv[]) {
+    size_t max = 1 << 24;
+    if (argc > 1) {
+        max = strtoul(argv[1], 0, 10);
+    }
+    const size_t nprobes = 1 << 22;
+
+    printf("%10s %10s %10s %10s %9s\n",
+            "keys", "buckets MB", "get ns", "many ns", "speedup");
+    for (size_t n = 1 << 16; n <= max; n *= 4) {
+        bench_size(n, nprobes);
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "./bench.h"
+#include "../hamt.h"
+#include "../hashmap.h"
+
+#define KEYSIZE 24
+#define VERSIONS 100
+#define CHANGES 4
+
+/*
+ * Keep VERSIONS versions of a map of n keys, each differing from the one
+ * before in CHANGES keys, either as HAMT versions or as hashmaps made with
+ * hashmap_copy().  Report the time to make each version, the memory that all
+ * of them take together, and the lookup time in the last version.
+ *
+ * Each run happens in a child process, so its memory can be measured on its
+ * own as the growth in peak resident set size.
+ */
+
+static char *make_keys(const size_t n) {
+    char *keys = malloc(n * KEYSIZE);
+    for (size_t i = 0; i < n; i++) {
+        snprintf(&keys[i * KEYSIZE], KEYSIZE, "config.%zu", i * 7919);
+    }
+    return keys;
+}
+
+static int *int_value(const size_t i) {
+    int *v = malloc(sizeof *v);
+    *v = (int) i;
+    return v;
+}
+
+/*
+ * Return the peak resident set size of this process so far, in kilobytes.
+ */
+static long peak_kb(void) {
+    struct rusage u;
+    getrusage(RUSAGE_SELF, &u);
+    return u.ru_maxrss;
+}
+
+static void report(
+        const char *name,
+        const size_t n,
+        const double build,
+        const long kb,
+        const double get) {
+    printf("%-10s %10zu %14.1f %12.1f %10.1f\n", name, n,
+            bench_ns_per_op(build, VERSIONS) / 1e3, kb / 1024.0,
+            bench_ns_per_op(get, n));
+    fflush(stdout);
+}
+
+static void bench_hamt(const size_t n, const char *keys) {
+    struct hamt *versions[VERSIONS + 1];
+    struct hamt *t = hamt_create(), *next;
+    for (size_t i = 0; i < n; i++) {
+        next = hamt_set(t, &keys[i * KEYSIZE], int_value(i));
+        hamt_destroy(t);
+        t = next;
+    }
+    versions[0] = t;
+
+    const long kb = peak_kb();
+    double t0 = bench_now();
+    for (size_t v = 1; v <= VERSIONS; v++) {
+        t = versions[v - 1];
+        for (size_t c = 0; c < CHANGES; c++) {
+            const size_t i = (v * 7 + c * 131) % n;
+            next = hamt_set(t, &keys[i * KEYSIZE], int_value(v));
+            if (t != versions[v - 1]) {
+                hamt_destroy(t);
+            }
+            t = next;
+        }
+        versions[v] = t;
+    }
+    double t1 = bench_now();
+    volatile size_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+        found += hamt_get(t, &keys[i * KEYSIZE]) != 0;
+    }
+    double t2 = bench_now();
+    report("hamt", n, t1 - t0, peak_kb() - kb, t2 - t1);
+}
+
+static void bench_copy(const size_t n, const char *keys) {
+    struct hashmap *versions[VERSIONS + 1];
+    struct hashmap *m = hashmap_create_with_hash(hash_xx64_len);
+    for (size_t i = 0; i < n; i++) {
+        hashmap_set(m, &keys[i * KEYSIZE], int_value(i));
+    }
+    versions[0] = m;
+
+    const long kb = peak_kb();
+    double t0 = bench_now();
+    for (size_t v = 1; v <= VERSIONS; v++) {
+        m = hashmap_create_with_hash(hash_xx64_len);
+        hashmap_copy(m, versions[v - 1]);
+        for (size_t c = 0; c < CHANGES; c++) {
+            const size_t i = (v * 7 + c * 131) % n;
+            hashmap_set(m, &keys[i * KEYSIZE], int_value(v));
+        }
+        versions[v] = m;
+    }
+    double t1 = bench_now();
+    volatile size_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+        found += hashmap_get(m, &keys[i * KEYSIZE]) != 0;
+    }
+    double t2 = bench_now();
+    /* Copies share their values, so they are left for exit() to clean up. */
+    report("copy", n, t1 - t0, peak_kb() - kb, t2 - t1);
+}
+
+/*
+ * Run 'fn' in a child process and wait for it.
+ */
+static void run_child(
+        void (*fn)(const size_t, const char *),
+        const size_t n,
+        const char *keys) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        fn(n, keys);
+        exit(0);
+    }
+    waitpid(pid, 0, 0);
+}
+
+int main(void) {
+    const size_t SIZES[] = {1000, 10000, 100000};
+    printf("%-10s %10s %14s %12s %10s\n",
+            "engine", "keys", "us/version", "MB", "get ns");
+    for (size_t s = 0; s < sizeof SIZES / sizeof SIZES[0]; s++) {
+        char *keys = make_keys(SIZES[s]);
+        run_child(bench_hamt, SIZES[s], keys);
+        run_child(bench_copy, SIZES[s], keys);
+        free(keys);
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./bench.h"
+#include "../hash.h"
+
+/*
+ * Measure the hash functions in hash.c for raw throughput across key lengths,
+ * and for how evenly they spread realistic key sets over a power-of-two
+ * bucket array, as hashmap indexes them.
+ */
+
+struct hash_info {
+    const char *name;
+    hash_func fn;
+};
+
+static const struct hash_info HASHES[] = {
+    {"shimmy2", hash_shimmy2_len},
+    {"wy", hash_wy_len},
+    {"xx64", hash_xx64_len},
+};
+#define NHASHES (sizeof HASHES / sizeof HASHES[0])
+
+#define BUFSIZE (1 << 20)
+
+static void bench_throughput(void) {
+    static const size_t LENGTHS[] = {4, 8, 16, 32, 64, 256, 1024, 4096};
+    char *buf = malloc(BUFSIZE + 4096);
+    for (size_t i = 0; i < BUFSIZE + 4096; i++) {
+        buf[i] = (char) (i * 2654435761u >> 13);
+    }
+
+    printf("%-10s", "GB/s");
+    for (size_t l = 0; l < sizeof LENGTHS / sizeof LENGTHS[0]; l++) {
+        printf(" %8zu", LENGTHS[l]);
+    }
+    printf("\n");
+
+    for (size_t h = 0; h < NHASHES; h++) {
+        printf("%-10s", HASHES[h].name);
+        for (size_t l = 0; l < sizeof LENGTHS / sizeof LENGTHS[0]; l++) {
+            const size_t len = LENGTHS[l];
+            const size_t total = (size_t) 256 << 20;
+            volatile unsigned long sink = 0;
+            double t0 = bench_now();
+            for (size_t done = 0, off = 0; done < total; done += len) {
+                sink ^= HASHES[h].fn(&buf[off], len);
+                off = (off + len + 1) & (BUFSIZE - 1);
+            }
+            double t1 = bench_now();
+            printf(" %8.2f", total / (t1 - t0) / 1e9);
+        }
+        printf("\n");
+    }
+    free(buf);
+}
+
+/*
+ * Write the 'i'th key of the named key set into 'k', returning its length.
+ */
+static size_t make_key(const int set, const size_t i, char *k) {
+    unsigned long long x = i * 0x9E3779B97F4A7C15ull;
+    switch (set) {
+    case 0:
+        return sprintf(k, "%zu", i);
+    case 1:
+        return sprintf(k, "user:%zu:session", i);
+    case 2:
+        return sprintf(k, "%08llx-%04llx-4%03llx-%04llx-%012llx",
+                x >> 32, (x >> 16) & 0xFFFF, x & 0xFFF,
+                ((x >> 7) & 0x3FFF) | 0x8000, (x * 31) & 0xFFFFFFFFFFFFull);
+    case 3:
+        /* Eight byte binary integers, as for packed IDs. */
+        memcpy(k, &i, sizeof i);
+        return sizeof i;
+    default:
+        /* Short lowercase words. */
+        {
+            size_t len = 3 + i % 6;
+            size_t n = i;
+            for (size_t c = 0; c < len; c++) {
+                k[c] = 'a' + n % 26;
+                n = n / 26 + c * 7;
+            }
+            k[len] = '\0';
+            return len;
+        }
+    }
+}
+
+static const char *KEYSETS[] = {"decimal", "prefixed", "uuid", "binary", "words"};
+#define NKEYSETS (sizeof KEYSETS / sizeof KEYSETS[0])
+
+static void bench_distribution(const size_t nbuckets) {
+    const size_t nkeys = nbuckets * 2;
+    unsigned int *counts = malloc(nbuckets * sizeof *counts);
+    unsigned long *hashes = malloc(nkeys * sizeof *hashes);
+    char k[64];
+
+    printf("\n%zu keys into %zu buckets (chi2/df near 1.0 is ideal)\n",
+            nkeys, nbuckets);
+    printf("%-10s %-10s %10s %10s %10s %10s\n",
+            "hash", "keys", "chi2/df", "max", "empty %", "collide");
+    for (size_t h = 0; h < NHASHES; h++) {
+        for (size_t set = 0; set < NKEYSETS; set++) {
+            memset(counts, 0, nbuckets * sizeof *counts);
+            for (size_t i = 0; i < nkeys; i++) {
+                size_t len = make_key(set, i, k);
+                hashes[i] = HASHES[h].fn(k, len);
+                counts[hashes[i] & (nbuckets - 1)]++;
+            }
+
+            double expected = (double) nkeys / nbuckets;
+            double chi2 = 0;
+            unsigned int max = 0;
+            size_t empty = 0;
+            for (size_t b = 0; b < nbuckets; b++) {
+                double d = counts[b] - expected;
+                chi2 += d * d / expected;
+                if (counts[b] > max) {
+                    max = counts[b];
+                }
+                empty += counts[b] == 0;
+            }
+
+            /* Count keys whose full hash repeats an earlier key's hash. */
+            size_t collisions = 0;
+            for (size_t b = 0; b < nbuckets; b++) {
+                counts[b] = 0;
+            }
+            for (size_t i = 0; i < nkeys; i++) {
+                size_t b = hashes[i] & (nbuckets - 1);
+                for (size_t j = 0; j < i && counts[b]; j++) {
+                    if (hashes[j] == hashes[i]) {
+                        collisions++;
+                        break;
+                    }
+                }
+                counts[b]++;
+            }
+
+            printf("%-10s %-10s %10.2f %10u %10.1f %10zu\n",
+                    HASHES[h].name, KEYSETS[set], chi2 / (nbuckets - 1),
+                    max, 100.0 * empty / nbuckets, collisions);
+        }
+    }
+    free(counts);
+    free(hashes);
+}
+
+int main(void) {
+    bench_throughput();
+    bench_distribution(1 << 12);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "./bench.h"
+#include "../hashmap.h"
+#include "../ohashmap.h"
+
+#define KEYSIZE 24
+
+/*
+ * Compare the chained hashmap with the open-addressing ohashmap on inserts,
+ * successful lookups and unsuccessful lookups, at a few map sizes.
+ */
+
+static char *make_keys(const size_t n, const char *prefix) {
+    char *keys = malloc(n * KEYSIZE);
+    for (size_t i = 0; i < n; i++) {
+        snprintf(&keys[i * KEYSIZE], KEYSIZE, "%s%zu", prefix, i * 7919);
+    }
+    return keys;
+}
+
+static void bench_chained(const size_t n, const char *hit, const char *miss) {
+    volatile size_t found = 0;
+    double t0 = bench_now();
+    struct hashmap *m = hashmap_create();
+    for (size_t i = 0; i < n; i++) {
+        int *v = malloc(sizeof *v);
+        *v = (int) i;
+        hashmap_set(m, &hit[i * KEYSIZE], v);
+    }
+    double t1 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += hashmap_get(m, &hit[i * KEYSIZE]) != 0;
+    }
+    double t2 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += hashmap_get(m, &miss[i * KEYSIZE]) != 0;
+    }
+    double t3 = bench_now();
+    hashmap_destroy(m);
+
+    printf("%-10s %10zu %10.1f %10.1f %10.1f\n", "chained", n,
+            bench_ns_per_op(t1 - t0, n),
+            bench_ns_per_op(t2 - t1, n),
+            bench_ns_per_op(t3 - t2, n));
+}
+
+static void bench_open(const size_t n, const char *hit, const char *miss) {
+    volatile size_t found = 0;
+    double t0 = bench_now();
+    struct ohashmap *m = ohashmap_create();
+    for (size_t i = 0; i < n; i++) {
+        int *v = malloc(sizeof *v);
+        *v = (int) i;
+        ohashmap_set(m, &hit[i * KEYSIZE], v);
+    }
+    double t1 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += ohashmap_get(m, &hit[i * KEYSIZE]) != 0;
+    }
+    double t2 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += ohashmap_get(m, &miss[i * KEYSIZE]) != 0;
+    }
+    double t3 = bench_now();
+    ohashmap_destroy(m);
+
+    printf("%-10s %10zu %10.1f %10.1f %10.1f\n", "open", n,
+            bench_ns_per_op(t1 - t0, n),
+            bench_ns_per_op(t2 - t1, n),
+            bench_ns_per_op(t3 - t2, n));
+}
+
+int main(int argc, char *argv[]) {
+    size_t max = 1000000;
+    if (argc > 1) {
+        max = strtoul(argv[1], 0, 10);
+    }
+
+    printf("%-10s %10s %10s %10s %10s\n",
+            "engine", "keys", "set ns", "hit ns", "miss ns");
+    for (size_t n = 1000; n <= max; n *= 10) {
+        char *hit = make_keys(n, "key:");
+        char *miss = make_keys(n, "nokey:");
+        bench_chained(n, hit, miss);
+        bench_open(n, hit, miss);
+        free(hit);
+        free(miss);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "./bench.h"
+#include "../hashmap.h"
+#include "../intern.h"
+
+#define FIELDS 16
+#define KEYSIZE 40
+
+/*
+ * Many small maps sharing one set of longish keys, like records parsed from
+ * JSON: compare the memory the maps take with and without interned keys, and
+ * the cost of looking keys up by string against looking them up by handle.
+ */
+
+static void bench(const size_t n, char keys[][KEYSIZE], const bool interned) {
+    struct intern *t = interned ? intern_create() : 0;
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.hash = hash_xx64_len;
+    o.values = HASHMAP_VALUES_WORD;
+    o.intern = t;
+    struct hashmap **maps = malloc(n * sizeof *maps);
+    const char *handles[FIELDS];
+    for (size_t j = 0; j < FIELDS; j++) {
+        handles[j] = interned ? intern_add(t, keys[j]) : 0;
+    }
+
+    double t0 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        maps[i] = hashmap_create_with_options(&o);
+        for (size_t j = 0; j < FIELDS; j++) {
+            uintptr_t v = i + j;
+            hashmap_set(maps[i], keys[j], &v);
+        }
+    }
+    double t1 = bench_now();
+    volatile uintptr_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < FIELDS; j++) {
+            total += *(uintptr_t *) hashmap_get(maps[i], keys[j]);
+        }
+    }
+    double t2 = bench_now();
+    if (interned) {
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < FIELDS; j++) {
+                total += *(uintptr_t *) hashmap_get_interned(maps[i],
+                        handles[j]);
+            }
+        }
+    }
+    double t3 = bench_now();
+
+    size_t bytes = 0;
+    struct hashmap_stats st;
+    for (size_t i = 0; i < n; i++) {
+        hashmap_stats(maps[i], &st);
+        bytes += st.entry_bytes;
+        hashmap_destroy(maps[i]);
+    }
+    free(maps);
+    intern_destroy(t);
+
+    printf("%-10s %10zu %10.1f %10.1f %10.1f %10.1f\n",
+            interned ? "interned" : "copied", n,
+            (double) bytes / (n * FIELDS),
+            bench_ns_per_op(t1 - t0, n * FIELDS),
+            bench_ns_per_op(t2 - t1, n * FIELDS),
+            interned ? bench_ns_per_op(t3 - t2, n * FIELDS) : 0.0);
+}
+
+int main(int argc, char **argv) {
+    size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 100000;
+    char keys[FIELDS][KEYSIZE];
+    for (size_t j = 0; j < FIELDS; j++) {
+        snprintf(keys[j], KEYSIZE, "some_fairly_descriptive_field_%zu", j);
+    }
+    printf("%-10s %10s %10s %10s %10s %10s\n", "mode", "maps",
+            "entry B", "set ns", "get ns", "handle ns");
+    for (size_t n = 1000; n <= max; n *= 10) {
+        bench(n, keys, false);
+        bench(n, keys, true);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "./bench.h"
+#include "../mhashmap.h"
+
+#define KEYSIZE 24
+#define PATH "bench_mhashmap.dat"
+
+/*
+ * Compare the two ways a service can get a large map at startup: building it
+ * with hashmap_set() from its source data, or opening a file written earlier
+ * with mhashmap_write().  Then compare lookups in each.
+ *
+ * The file is still in the page cache when it is opened, so this measures
+ * the best case for the mapping: page faults, but no disk reads.
+ */
+
+static size_t int_size(const void *v) {
+    (void) v;
+    return sizeof (int);
+}
+
+static void bench(const size_t n, const char *keys) {
+    volatile size_t found = 0;
+    double t0 = bench_now();
+    struct hashmap *m = hashmap_create_with_hash(hash_xx64_len);
+    for (size_t i = 0; i < n; i++) {
+        int *v = malloc(sizeof *v);
+        *v = (int) i;
+        hashmap_set(m, &keys[i * KEYSIZE], v);
+    }
+    double t1 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += hashmap_get(m, &keys[i * KEYSIZE]) != 0;
+    }
+    double t2 = bench_now();
+    mhashmap_write(m, PATH, int_size);
+    double t3 = bench_now();
+    hashmap_destroy(m);
+
+    double t4 = bench_now();
+    struct mhashmap *f = mhashmap_open(PATH);
+    double t5 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += mhashmap_get(f, &keys[i * KEYSIZE], 0) != 0;
+    }
+    double t6 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        found += mhashmap_get(f, &keys[i * KEYSIZE], 0) != 0;
+    }
+    double t7 = bench_now();
+    const size_t size = f->size;
+    mhashmap_close(f);
+    unlink(PATH);
+
+    printf("%10zu %10.1f %10.1f %10.3f %10.1f %10.1f %10.1f %8.1f\n", n,
+            (t1 - t0) * 1e3, (t3 - t2) * 1e3, (t5 - t4) * 1e3,
+            bench_ns_per_op(t2 - t1, n), bench_ns_per_op(t6 - t5, n),
+            bench_ns_per_op(t7 - t6, n), size / 1048576.0);
+}
+
+int main(int argc, char **argv) {
+    size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 4000000;
+    char *keys = malloc(max * KEYSIZE);
+    for (size_t i = 0; i < max; i++) {
+        snprintf(&keys[i * KEYSIZE], KEYSIZE, "key:%zu", i * 7919);
+    }
+    printf("%10s %10s %10s %10s %10s %10s %10s %8s\n", "keys",
+            "build ms", "write ms", "open ms", "get ns", "first ns",
+            "mmap ns", "MB");
+    for (size_t n = 1000; n <= max; n *= 4) {
+        bench(n, keys);
+    }
+    free(keys);
+    return 0;
+}
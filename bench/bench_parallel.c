@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "./bench.h"
+#include "../pool.h"
+#include "../slisti.h"
+
+/*
+ * Measure how slisti_list_pmap(), slisti_list_pfilter() and
+ * slisti_list_preduce() scale from 1 to 32 threads, against the serial
+ * functions.  Times are in nanoseconds per value, and the speedup is against
+ * the serial function.
+ */
+
+/* Enough work per value that the walk along the list is not all there is */
+static int work(int x) {
+    unsigned int h = x;
+    for (int i = 0; i < 8; i++) {
+        h = h * 2654435761u + 1;
+    }
+    return (int) (h >> 1);
+}
+
+static bool keep(int x) {
+    return work(x) & 1;
+}
+
+/*
+ * Reduce functions must be associative, so this one is cheap.  The sum of
+ * rand() values soon overflows, so add as unsigned, which wraps.
+ */
+static int add(int x, int y) {
+    return (int) ((unsigned int) x + (unsigned int) y);
+}
+
+static void print_row(const char *how, const double *secs,
+        const double *serial, const int n) {
+    printf("%-8s", how);
+    for (int i = 0; i < 3; i++) {
+        printf(" %10.2f %8.2fx", bench_ns_per_op(secs[i], n),
+                serial[i] / secs[i]);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    const int n = argc > 1 ? atoi(argv[1]) : 10000000;
+    int *input = malloc(n * sizeof *input);
+    for (int i = 0; i < n; i++) {
+        input[i] = rand();
+    }
+    struct slisti_list *list = slisti_list_from_array(input, n);
+    volatile int sink = 0;
+    double serial[3], secs[3], t;
+
+    t = bench_now();
+    struct slisti_list *dest = slisti_list_map(list, work);
+    serial[0] = bench_now() - t;
+    slisti_list_destroy(dest);
+    t = bench_now();
+    dest = slisti_list_filter(list, keep);
+    serial[1] = bench_now() - t;
+    slisti_list_destroy(dest);
+    t = bench_now();
+    sink += slisti_list_reduce(list, add);
+    serial[2] = bench_now() - t;
+
+    printf("%-8s %10s %9s %10s %9s %10s %9s\n", "threads", "map ns",
+            "speedup", "filter ns", "speedup", "reduce ns", "speedup");
+    print_row("serial", serial, serial, n);
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        struct pool *pool = pool_create(threads);
+        t = bench_now();
+        dest = slisti_list_pmap(list, work, pool);
+        secs[0] = bench_now() - t;
+        slisti_list_destroy(dest);
+        t = bench_now();
+        dest = slisti_list_pfilter(list, keep, pool);
+        secs[1] = bench_now() - t;
+        slisti_list_destroy(dest);
+        t = bench_now();
+        sink += slisti_list_preduce(list, add, 0, pool);
+        secs[2] = bench_now() - t;
+        pool_destroy(pool);
+
+        char how[16];
+        snprintf(how, sizeof how, "%d", threads);
+        print_row(how, secs, serial, n);
+    }
+    slisti_list_destroy(list);
+    free(input);
+    return 0;
+}
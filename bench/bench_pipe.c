@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "./bench.h"
+#include "../slisti.h"
+
+/*
+ * Compare map, filter and reduce chained through intermediate lists against
+ * the same steps fused into one pipeline, on lists of up to ten million
+ * values.  Times are in nanoseconds per value of the source list.
+ */
+
+static int twice(int x) {
+    return x * 2;
+}
+
+static bool small(int x) {
+    return x < 1000;
+}
+
+/* Sums of ten million values overflow an int, so add as unsigned */
+static int add(int x, int y) {
+    return (int) ((unsigned int) x + (unsigned int) y);
+}
+
+static void bench(const int n, const int *input) {
+    struct slisti_list *list = slisti_list_from_array(input, n);
+    struct slisti_pipe pipe;
+    volatile int sink = 0;
+    double t0, t1, t2, t3, t4, t5;
+    int out[10];
+
+    /* map, filter and reduce */
+    t0 = bench_now();
+    struct slisti *mapped = slisti_map(list->head, twice);
+    struct slisti *filtered = slisti_filter(mapped, small);
+    sink += slisti_reduce(filtered, add);
+    slisti_destroy(mapped);
+    slisti_destroy(filtered);
+    t1 = bench_now();
+    sink += slisti_pipe_reduce(slisti_pipe_filter(slisti_pipe_map(
+                    slisti_pipe_init(&pipe, list->head), twice), small), add);
+    t2 = bench_now();
+
+    /* map, filter and collect the first ten values */
+    mapped = slisti_map(list->head, twice);
+    filtered = slisti_filter(mapped, small);
+    struct slisti *first = slisti_slice(filtered, 0, 10);
+    sink += slisti_length(first);
+    slisti_destroy(mapped);
+    slisti_destroy(filtered);
+    slisti_destroy(first);
+    t3 = bench_now();
+    sink += slisti_pipe_to_array(slisti_pipe_take(slisti_pipe_filter(
+                    slisti_pipe_map(slisti_pipe_init(&pipe, list->head),
+                        twice), small), 10), out, 10);
+    t4 = bench_now();
+
+    /* map and write out as JSON */
+    mapped = slisti_map(list->head, twice);
+    char *json = slisti_to_json(mapped);
+    sink += json[1];
+    free(json);
+    slisti_destroy(mapped);
+    t5 = bench_now();
+    json = slisti_pipe_to_json(slisti_pipe_map(
+                slisti_pipe_init(&pipe, list->head), twice));
+    sink += json[1];
+    free(json);
+    const double t6 = bench_now();
+    slisti_list_destroy(list);
+
+    printf("%10d %10.2f %10.2f %10.2f %10.4f %10.2f %10.2f\n", n,
+            bench_ns_per_op(t1 - t0, n), bench_ns_per_op(t2 - t1, n),
+            bench_ns_per_op(t3 - t2, n), bench_ns_per_op(t4 - t3, n),
+            bench_ns_per_op(t5 - t4, n), bench_ns_per_op(t6 - t5, n));
+}
+
+int main(int argc, char **argv) {
+    int max = argc > 1 ? atoi(argv[1]) : 10000000;
+    int *input = malloc(max * sizeof *input);
+    for (int i = 0; i < max; i++) {
+        input[i] = rand() % 1000;
+    }
+    printf("%10s %10s %10s %10s %10s %10s %10s\n", "values", "reduce ns",
+            "fused ns", "first ns", "fused ns", "json ns", "fused ns");
+    for (int n = 1000; n <= max; n *= 10) {
+        bench(n, input);
+    }
+    free(input);
+    return 0;
+}
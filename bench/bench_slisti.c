@@ -0,0 +1,103 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "./bench.h"
+#include "../slisti.h"
+
+#define REPEAT 100
+
+/*
+ * Compare building a list by appending, then asking for its length and last
+ * element (REPEAT times), on bare slisti cells and through a struct
+ * slisti_list handle.  Appending to bare cells walks the whole list each
+ * time, so it is only run on the smaller lists.
+ *
+ * Then time the builders that make a cell per value, and destroying what they
+ * built, which is where a list spends its time allocating.
+ */
+
+static int twice(int x) {
+    return x * 2;
+}
+
+static bool is_even(int x) {
+    return x % 2 == 0;
+}
+
+static void bench_cells(const int n) {
+    volatile int sink = 0;
+    double t0 = bench_now();
+    struct slisti *list = slisti_create(0);
+    for (int i = 1; i < n; i++) {
+        slisti_append(list, i);
+    }
+    double t1 = bench_now();
+    for (int r = 0; r < REPEAT; r++) {
+        sink += slisti_length(list) + slisti_get(list, -1)->value;
+    }
+    double t2 = bench_now();
+    slisti_destroy(list);
+
+    printf("%-8s %10d %12.1f %12.1f\n", "cells", n,
+            bench_ns_per_op(t1 - t0, n), bench_ns_per_op(t2 - t1, REPEAT));
+}
+
+static void bench_handle(const int n) {
+    volatile int sink = 0;
+    double t0 = bench_now();
+    struct slisti_list *list = slisti_list_create();
+    for (int i = 0; i < n; i++) {
+        slisti_list_append(list, i);
+    }
+    double t1 = bench_now();
+    for (int r = 0; r < REPEAT; r++) {
+        sink += slisti_list_length(list) + slisti_list_get(list, -1)->value;
+    }
+    double t2 = bench_now();
+    slisti_list_destroy(list);
+
+    printf("%-8s %10d %12.1f %12.1f\n", "handle", n,
+            bench_ns_per_op(t1 - t0, n), bench_ns_per_op(t2 - t1, REPEAT));
+}
+
+static void bench_build(const int n, const int *input) {
+    double t0 = bench_now();
+    struct slisti *list = slisti_from_array(input, n);
+    double t1 = bench_now();
+    struct slisti *mapped = slisti_map(list, twice);
+    double t2 = bench_now();
+    struct slisti *filtered = slisti_filter(list, is_even);
+    double t3 = bench_now();
+    slisti_destroy(list);
+    slisti_destroy(mapped);
+    slisti_destroy(filtered);
+    double t4 = bench_now();
+
+    printf("%10d %12.1f %12.1f %12.1f %12.1f\n", n,
+            bench_ns_per_op(t1 - t0, n), bench_ns_per_op(t2 - t1, n),
+            bench_ns_per_op(t3 - t2, n), bench_ns_per_op(t4 - t3, 2 * n));
+}
+
+int main(int argc, char **argv) {
+    int max = argc > 1 ? atoi(argv[1]) : 1000000;
+    printf("%-8s %10s %12s %12s\n", "list", "values", "append ns",
+            "len+last ns");
+    for (int n = 1000; n <= max; n *= 10) {
+        if (n <= 10000) {
+            bench_cells(n);
+        }
+        bench_handle(n);
+    }
+
+    int *input = malloc(10 * max * sizeof *input);
+    for (int i = 0; i < 10 * max; i++) {
+        input[i] = i;
+    }
+    printf("\n%10s %12s %12s %12s %12s\n", "values", "array ns", "map ns",
+            "filter ns", "destroy ns");
+    for (int n = 1000; n <= 10 * max; n *= 10) {
+        bench_build(n, input);
+    }
+    free(input);
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "./bench.h"
+#include "../slisti.h"
+#include "../ulisti.h"
+
+/*
+ * Compare slisti, with one cell per value, against ulisti, with a run of
+ * values per node, on building a list from an array, walking it with find,
+ * get and reduce, and on the memory the list structures take.
+ */
+
+/* Sums of ten million values overflow an int, so add as unsigned */
+static int add(int x, int y) {
+    return (int) ((unsigned int) x + (unsigned int) y);
+}
+
+static void bench_slisti(const int n, const int *input) {
+    volatile int sink = 0;
+    double t0 = bench_now();
+    struct slisti *list = slisti_from_array(input, n);
+    double t1 = bench_now();
+    sink += slisti_length(list);
+    double t2 = bench_now();
+    sink += slisti_find(list, -1) != 0;
+    double t3 = bench_now();
+    sink += slisti_get(list, n / 2)->value;
+    double t4 = bench_now();
+    sink += slisti_reduce(list, add);
+    double t5 = bench_now();
+    slisti_destroy(list);
+
+    printf("%-8s %10d %10.1f %10.2f %10.2f %10.2f %10.2f %10.1f\n",
+            "slisti", n, bench_ns_per_op(t1 - t0, n),
+            bench_ns_per_op(t2 - t1, n), bench_ns_per_op(t3 - t2, n),
+            bench_ns_per_op(t4 - t3, n / 2), bench_ns_per_op(t5 - t4, n),
+            (double) sizeof (struct slisti));
+}
+
+static void bench_ulisti(const int n, const int *input) {
+    volatile int sink = 0;
+    double t0 = bench_now();
+    struct ulisti *list = ulisti_from_array(input, n);
+    double t1 = bench_now();
+    sink += ulisti_length(list);
+    double t2 = bench_now();
+    sink += ulisti_find(list, -1) != 0;
+    double t3 = bench_now();
+    sink += *ulisti_get(list, n / 2);
+    double t4 = bench_now();
+    sink += ulisti_reduce(list, add);
+    double t5 = bench_now();
+
+    size_t bytes = sizeof *list;
+    for (struct ulisti_node *node = list->head; node; node = node->next) {
+        bytes += sizeof *node;
+    }
+    ulisti_destroy(list);
+
+    printf("%-8s %10d %10.1f %10.2f %10.2f %10.2f %10.2f %10.1f\n",
+            "ulisti", n, bench_ns_per_op(t1 - t0, n),
+            bench_ns_per_op(t2 - t1, n), bench_ns_per_op(t3 - t2, n),
+            bench_ns_per_op(t4 - t3, n / 2), bench_ns_per_op(t5 - t4, n),
+            (double) bytes / n);
+}
+
+int main(int argc, char **argv) {
+    int max = argc > 1 ? atoi(argv[1]) : 10000000;
+    int *input = malloc(max * sizeof *input);
+    for (int i = 0; i < max; i++) {
+        input[i] = rand() % 1000;
+    }
+    printf("%-8s %10s %10s %10s %10s %10s %10s %10s\n", "list", "values",
+            "build ns", "length ns", "find ns", "get ns", "reduce ns",
+            "bytes");
+    for (int n = 1000; n <= max; n *= 10) {
+        bench_slisti(n, input);
+        bench_ulisti(n, input);
+    }
+    free(input);
+    return 0;
+}
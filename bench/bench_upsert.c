@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "./bench.h"
+#include "../hashmap.h"
+
+#define KEYSIZE 24
+#define ROUNDS 4
+
+/*
+ * Compare ways of keeping a count per key: hashmap_exists(), then
+ * hashmap_get() or hashmap_set(), against one hashmap_get_or_insert() call,
+ * on a map of pointer values and on a map of word values.  Then compare
+ * removing every key with hashmap_get() and hashmap_delete() against
+ * hashmap_take().
+ *
+ * Every key is counted ROUNDS times, so all but the first update of each key
+ * finds it already there.
+ */
+
+static void bench_lookups(const size_t n, const char *keys) {
+    volatile int total = 0;
+    double t0 = bench_now();
+    struct hashmap *m = hashmap_create_with_hash(hash_xx64_len);
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < n; i++) {
+            const char *k = &keys[i * KEYSIZE];
+            if (hashmap_exists(m, k)) {
+                (*(int *) hashmap_get(m, k))++;
+            } else {
+                int *v = malloc(sizeof *v);
+                *v = 1;
+                hashmap_set(m, k, v);
+            }
+        }
+    }
+    double t1 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        const char *k = &keys[i * KEYSIZE];
+        total += *(int *) hashmap_get(m, k);
+        hashmap_delete(m, k);
+    }
+    double t2 = bench_now();
+    hashmap_destroy(m);
+
+    printf("%-16s %10zu %10.1f %10.1f\n", "exists/get/set", n,
+            bench_ns_per_op(t1 - t0, n * ROUNDS),
+            bench_ns_per_op(t2 - t1, n));
+}
+
+static void bench_upsert(const size_t n, const char *keys) {
+    volatile int total = 0;
+    double t0 = bench_now();
+    struct hashmap *m = hashmap_create_with_hash(hash_xx64_len);
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < n; i++) {
+            bool created;
+            int **v = hashmap_get_or_insert(m, &keys[i * KEYSIZE],
+                    &created);
+            if (created) {
+                *v = calloc(1, sizeof **v);
+            }
+            (**v)++;
+        }
+    }
+    double t1 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        int *v;
+        hashmap_take(m, &keys[i * KEYSIZE], &v);
+        total += *v;
+        free(v);
+    }
+    double t2 = bench_now();
+    hashmap_destroy(m);
+
+    printf("%-16s %10zu %10.1f %10.1f\n", "get_or_insert", n,
+            bench_ns_per_op(t1 - t0, n * ROUNDS),
+            bench_ns_per_op(t2 - t1, n));
+}
+
+static void bench_words(const size_t n, const char *keys) {
+    volatile uintptr_t total = 0;
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.hash = hash_xx64_len;
+    o.values = HASHMAP_VALUES_WORD;
+    double t0 = bench_now();
+    struct hashmap *m = hashmap_create_with_options(&o);
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < n; i++) {
+            (*(uintptr_t *) hashmap_get_or_insert(m, &keys[i * KEYSIZE],
+                    0))++;
+        }
+    }
+    double t1 = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        uintptr_t v;
+        hashmap_take(m, &keys[i * KEYSIZE], &v);
+        total += v;
+    }
+    double t2 = bench_now();
+    hashmap_destroy(m);
+
+    printf("%-16s %10zu %10.1f %10.1f\n", "words", n,
+            bench_ns_per_op(t1 - t0, n * ROUNDS),
+            bench_ns_per_op(t2 - t1, n));
+}
+
+int main(int argc, char **argv) {
+    size_t max = argc > 1 ? strtoul(argv[1], 0, 10) : 1000000;
+    char *keys = malloc(max * KEYSIZE);
+    for (size_t i = 0; i < max; i++) {
+        snprintf(&keys[i * KEYSIZE], KEYSIZE, "key:%zu", i * 7919);
+    }
+    printf("%-16s %10s %10s %10s\n", "method", "keys", "update ns",
+            "remove ns");
+    for (size_t n = 1000; n <= max; n *= 10) {
+        bench_lookups(n, keys);
+        bench_upsert(n, keys);
+        bench_words(n, keys);
+    }
+    free(keys);
+    return 0;
+}
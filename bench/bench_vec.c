@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "./bench.h"
+#include "../vec.h"
+#include "../slisti.h"
+#include "../ulisti.h"
+
+/*
+ * Compare map, filter and reduce with a function called for every value
+ * against the built-in SIMD kernels at each level, on a plain array, on an
+ * ulisti and on an slisti.  Times are in nanoseconds per value.
+ */
+
+/* Sums of ten million values overflow an int, so add as unsigned */
+static int add(int x, int y) {
+    return (int) ((unsigned int) x + (unsigned int) y);
+}
+
+static int max(int x, int y) {
+    return x > y ? x : y;
+}
+
+static int add1(int x) {
+    return x + 1;
+}
+
+static int clamp(int x) {
+    return x < 100 ? 100 : x > 900 ? 900 : x;
+}
+
+static bool lt500(int x) {
+    return x < 500;
+}
+
+static const char *levels[] = {"scalar", "sse2", "avx2"};
+
+static void print_row(const char *type, const char *how, const size_t n,
+        const double *secs) {
+    printf("%-8s %-8s", type, how);
+    for (int i = 0; i < 5; i++) {
+        printf(" %10.2f", bench_ns_per_op(secs[i], n));
+    }
+    printf("\n");
+}
+
+static void bench_array_fn(const size_t n, const int *input, int *out) {
+    /* Called through volatile pointers, so that they are not inlined */
+    int (*volatile fadd)(int, int) = add, (*volatile fmax)(int, int) = max;
+    int (*volatile fadd1)(int) = add1, (*volatile fclamp)(int) = clamp;
+    bool (*volatile flt)(int) = lt500;
+    volatile int sink = 0;
+    double secs[5], t;
+    int state = 0;
+    size_t count = 0;
+
+    t = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        state = fadd(state, input[i]);
+    }
+    secs[0] = bench_now() - t;
+    sink += state;
+    t = bench_now();
+    state = 0;
+    for (size_t i = 0; i < n; i++) {
+        state = fmax(state, input[i]);
+    }
+    secs[1] = bench_now() - t;
+    sink += state;
+    t = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        out[i] = fadd1(input[i]);
+    }
+    secs[2] = bench_now() - t;
+    t = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        out[i] = fclamp(input[i]);
+    }
+    secs[3] = bench_now() - t;
+    t = bench_now();
+    for (size_t i = 0; i < n; i++) {
+        if (flt(input[i])) {
+            out[count++] = input[i];
+        }
+    }
+    secs[4] = bench_now() - t;
+    sink += count;
+    print_row("array", "fn", n, secs);
+}
+
+static void bench_array(const size_t n, const int *input, int *out) {
+    volatile long long sink = 0;
+    double secs[5], t;
+    t = bench_now();
+    sink += vec_sum(input, n);
+    secs[0] = bench_now() - t;
+    t = bench_now();
+    sink += vec_max(input, n);
+    secs[1] = bench_now() - t;
+    t = bench_now();
+    vec_add(out, input, n, 1);
+    secs[2] = bench_now() - t;
+    t = bench_now();
+    vec_clamp(out, input, n, 100, 900);
+    secs[3] = bench_now() - t;
+    t = bench_now();
+    sink += vec_filter_lt(out, input, n, 500);
+    secs[4] = bench_now() - t;
+    print_row("array", levels[vec_level()], n, secs);
+}
+
+/*
+ * The list benchmarks below time building each new list, but not destroying
+ * it again.
+ */
+static void bench_ulisti_fn(const size_t n, const struct ulisti *list) {
+    volatile int sink = 0;
+    double secs[5], t;
+    struct ulisti *dest;
+    t = bench_now();
+    sink += ulisti_reduce(list, add);
+    secs[0] = bench_now() - t;
+    t = bench_now();
+    sink += ulisti_reduce(list, max);
+    secs[1] = bench_now() - t;
+    t = bench_now();
+    dest = ulisti_map(list, add1);
+    secs[2] = bench_now() - t;
+    ulisti_destroy(dest);
+    t = bench_now();
+    dest = ulisti_map(list, clamp);
+    secs[3] = bench_now() - t;
+    ulisti_destroy(dest);
+    t = bench_now();
+    dest = ulisti_filter(list, lt500);
+    secs[4] = bench_now() - t;
+    ulisti_destroy(dest);
+    print_row("ulisti", "fn", n, secs);
+}
+
+static void bench_ulisti(const size_t n, const struct ulisti *list) {
+    volatile long long sink = 0;
+    double secs[5], t;
+    struct ulisti *dest;
+    t = bench_now();
+    sink += ulisti_sum(list);
+    secs[0] = bench_now() - t;
+    t = bench_now();
+    sink += ulisti_max(list);
+    secs[1] = bench_now() - t;
+    t = bench_now();
+    dest = ulisti_add(list, 1);
+    secs[2] = bench_now() - t;
+    ulisti_destroy(dest);
+    t = bench_now();
+    dest = ulisti_clamp(list, 100, 900);
+    secs[3] = bench_now() - t;
+    ulisti_destroy(dest);
+    t = bench_now();
+    dest = ulisti_filter_lt(list, 500);
+    secs[4] = bench_now() - t;
+    ulisti_destroy(dest);
+    print_row("ulisti", levels[vec_level()], n, secs);
+}
+
+static void bench_slisti_fn(const size_t n, const struct slisti_list *list) {
+    volatile int sink = 0;
+    double secs[5], t;
+    struct slisti_list *dest;
+    t = bench_now();
+    sink += slisti_list_reduce(list, add);
+    secs[0] = bench_now() - t;
+    t = bench_now();
+    sink += slisti_list_reduce(list, max);
+    secs[1] = bench_now() - t;
+    t = bench_now();
+    dest = slisti_list_map(list, add1);
+    secs[2] = bench_now() - t;
+    slisti_list_destroy(dest);
+    t = bench_now();
+    dest = slisti_list_map(list, clamp);
+    secs[3] = bench_now() - t;
+    slisti_list_destroy(dest);
+    t = bench_now();
+    dest = slisti_list_filter(list, lt500);
+    secs[4] = bench_now() - t;
+    slisti_list_destroy(dest);
+    print_row("slisti", "fn", n, secs);
+}
+
+static void bench_slisti(const size_t n, const struct slisti_list *list) {
+    volatile long long sink = 0;
+    double secs[5], t;
+    struct slisti_list *dest;
+    t = bench_now();
+    sink += slisti_sum(list->head);
+    secs[0] = bench_now() - t;
+    t = bench_now();
+    sink += slisti_max(list->head);
+    secs[1] = bench_now() - t;
+    t = bench_now();
+    dest = slisti_list_add(list, 1);
+    secs[2] = bench_now() - t;
+    slisti_list_destroy(dest);
+    t = bench_now();
+    dest = slisti_list_clamp(list, 100, 900);
+    secs[3] = bench_now() - t;
+    slisti_list_destroy(dest);
+    t = bench_now();
+    dest = slisti_list_filter_lt(list, 500);
+    secs[4] = bench_now() - t;
+    slisti_list_destroy(dest);
+    print_row("slisti", levels[vec_level()], n, secs);
+}
+
+int main(int argc, char **argv) {
+    const size_t n = argc > 1 ? (size_t) atoi(argv[1]) : 10000000;
+    int *input = malloc(n * sizeof *input);
+    int *out = malloc(n * sizeof *out);
+    for (size_t i = 0; i < n; i++) {
+        input[i] = rand() % 1000;
+    }
+    struct ulisti *ulist = ulisti_from_array(input, n);
+    struct slisti_list *slist = slisti_list_from_array(input, n);
+    const enum vec_level best = vec_level();
+
+    printf("%-8s %-8s %10s %10s %10s %10s %10s\n", "type", "kernel",
+            "sum ns", "max ns", "add ns", "clamp ns", "filter ns");
+    bench_array_fn(n, input, out);
+    for (int level = VEC_SCALAR; level <= (int) best; level++) {
+        vec_use(level);
+        bench_array(n, input, out);
+    }
+    bench_ulisti_fn(n, ulist);
+    for (int level = VEC_SCALAR; level <= (int) best; level++) {
+        vec_use(level);
+        bench_ulisti(n, ulist);
+    }
+    bench_slisti_fn(n, slist);
+    for (int level = VEC_SCALAR; level <= (int) best; level++) {
+        vec_use(level);
+        bench_slisti(n, slist);
+    }
+
+    ulisti_destroy(ulist);
+    slisti_list_destroy(slist);
+    free(input);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,424 @@
+#include <stdlib.h>
+#include <string.h>
+#include "./chashmap.h"
+#include "./epoch.h"
+
+/* Table sizes are powers of two, and never smaller than the stripe count. */
+#define CHASHMAP_INIT_SIZE CHASHMAP_STRIPES
+#define CHASHMAP_MAX_SIZE (1ul << 31)
+#define CHASHMAP_STRIPE_BITS 6
+#define CHASHMAP_MAX_LOAD 1
+
+/*
+ * Return the hash 'hash' spread over all 64 bits with a Fibonacci multiply.
+ *
+ * Bucket indexes are taken from the top bits of the result, so the top
+ * CHASHMAP_STRIPE_BITS bits give the stripe.  That makes a key's stripe the
+ * same in every table size, and each stripe a contiguous range of buckets.
+ */
+static inline unsigned long long chashmap_mix(const unsigned long hash) {
+    return hash * 0x9E3779B97F4A7C15ull;
+}
+
+static inline size_t chashmap_stripe(const unsigned long hash) {
+    return (size_t) (chashmap_mix(hash) >> (64 - CHASHMAP_STRIPE_BITS));
+}
+
+static inline size_t chashmap_index(
+        const struct chashmap_table *t,
+        const unsigned long hash) {
+    return (size_t) (chashmap_mix(hash) >> t->shift);
+}
+
+static struct chashmap_table *chashmap_table_create(const size_t size) {
+    struct chashmap_table *t = calloc(
+            1, sizeof *t + size * sizeof t->buckets[0]);
+    if (!t) {
+        return 0;
+    }
+    t->size = size;
+    t->shift = 64;
+    for (size_t s = size; s > 1; s >>= 1) {
+        t->shift--;
+    }
+    atomic_init(&t->next, 0);
+    return t;
+}
+
+/*
+ * Create a map that hashes keys with 'hash', or with hash_xx64_len() if
+ * 'hash' is NULL.  Return a pointer to the map, or NULL on failure.
+ */
+struct chashmap *chashmap_create_with_hash(hash_func hash) {
+    struct chashmap *m = malloc(sizeof *m);
+    if (!m) {
+        return 0;
+    }
+    struct chashmap_table *t = chashmap_table_create(CHASHMAP_INIT_SIZE);
+    if (!t) {
+        free(m);
+        return 0;
+    }
+    m->hash = hash ? hash : hash_xx64_len;
+    atomic_init(&m->table, t);
+    atomic_init(&m->count, 0);
+    pthread_mutex_init(&m->resize_lock, 0);
+    for (size_t s = 0; s < CHASHMAP_STRIPES; s++) {
+        pthread_mutex_init(&m->locks[s], 0);
+    }
+    return m;
+}
+
+/*
+ * Create a map using hash_xx64_len(), whose high bits are as well mixed as
+ * its low ones.
+ */
+struct chashmap *chashmap_create() {
+    return chashmap_create_with_hash(hash_xx64_len);
+}
+
+/*
+ * Free the entries of stripe 's' in table 't', and their values too if
+ * 'values' is true.
+ */
+static void chashmap_stripe_free(
+        struct chashmap_table *t,
+        const size_t s,
+        const bool values) {
+    const size_t per = t->size / CHASHMAP_STRIPES;
+    struct chashmap_entry *e, *next;
+    for (size_t i = s * per; i < (s + 1) * per; i++) {
+        e = atomic_load_explicit(&t->buckets[i], memory_order_relaxed);
+        while (e) {
+            next = atomic_load_explicit(&e->next, memory_order_relaxed);
+            if (values) {
+                free(atomic_load_explicit(&e->value, memory_order_relaxed));
+            }
+            free(e);
+            e = next;
+        }
+        atomic_store_explicit(&t->buckets[i], 0, memory_order_relaxed);
+    }
+}
+
+/*
+ * Destroy map 'm' and every value in it.
+ *
+ * No other thread may be using the map.  Entries and values that were
+ * already retired are left to the epoch reclaimer.
+ */
+void chashmap_destroy(struct chashmap *m) {
+    struct chashmap_table *t = atomic_load(&m->table);
+    struct chashmap_table *next = atomic_load(&t->next);
+    for (size_t s = 0; s < CHASHMAP_STRIPES; s++) {
+        if (next && atomic_load(&t->moved[s])) {
+            chashmap_stripe_free(next, s, true);
+        } else {
+            chashmap_stripe_free(t, s, true);
+        }
+    }
+    free(next);
+    free(t);
+    pthread_mutex_destroy(&m->resize_lock);
+    for (size_t s = 0; s < CHASHMAP_STRIPES; s++) {
+        pthread_mutex_destroy(&m->locks[s]);
+    }
+    free(m);
+}
+
+size_t chashmap_count(struct chashmap *m) {
+    return atomic_load(&m->count);
+}
+
+/*
+ * Return the table that currently holds the keys with hash 'hash'.
+ *
+ * During a resize, a stripe that has already been moved is looked up in the
+ * next table instead, and so on if that table is itself being replaced.
+ */
+static struct chashmap_table *chashmap_table_for(
+        struct chashmap *m,
+        const unsigned long hash) {
+    const size_t s = chashmap_stripe(hash);
+    struct chashmap_table *t;
+    t = atomic_load_explicit(&m->table, memory_order_acquire);
+    while (atomic_load_explicit(&t->moved[s], memory_order_acquire)) {
+        t = atomic_load_explicit(&t->next, memory_order_acquire);
+    }
+    return t;
+}
+
+/*
+ * Search the chain starting at 'e' for the 'len' byte key 'k' with hash
+ * 'hash'.
+ *
+ * Return a pointer to the matching entry, if found, or NULL otherwise.
+ */
+static struct chashmap_entry *chashmap_find(
+        struct chashmap_entry *e,
+        const unsigned long hash,
+        const char *k,
+        const size_t len) {
+    while (e) {
+        if (e->hash == hash && e->len == len && memcmp(e->key, k, len) == 0) {
+            return e;
+        }
+        e = atomic_load_explicit(&e->next, memory_order_acquire);
+    }
+    return 0;
+}
+
+static struct chashmap_entry *chashmap_entry_create(
+        const unsigned long hash,
+        const char *k,
+        const size_t len,
+        void *v) {
+    struct chashmap_entry *e = malloc(
+            offsetof(struct chashmap_entry, key) + len + 1);
+    if (!e) {
+        return 0;
+    }
+    atomic_init(&e->next, 0);
+    e->hash = hash;
+    atomic_init(&e->value, v);
+    e->len = len;
+    memcpy(e->key, k, len);
+    e->key[len] = '\0';
+    return e;
+}
+
+/*
+ * Copy the entries of stripe 's' from table 't' into table 'next', mark the
+ * stripe as moved, and retire the originals.
+ *
+ * The stripe's lock is held throughout, so no writer can change it under us.
+ * Readers still walking the old chains are unaffected, since the original
+ * entries are only retired, not modified.  The copies take over ownership of
+ * the values.
+ *
+ * Return whether the stripe was moved.  If an allocation fails, the stripe is
+ * left in the old table.
+ */
+static bool chashmap_stripe_move(
+        struct chashmap *m,
+        struct chashmap_table *t,
+        struct chashmap_table *next,
+        const size_t s) {
+    const size_t per = t->size / CHASHMAP_STRIPES;
+    struct chashmap_entry *e, *c;
+    size_t i, j;
+    pthread_mutex_lock(&m->locks[s]);
+    for (i = s * per; i < (s + 1) * per; i++) {
+        e = atomic_load_explicit(&t->buckets[i], memory_order_relaxed);
+        for (; e; e = atomic_load_explicit(&e->next, memory_order_relaxed)) {
+            c = chashmap_entry_create(e->hash, e->key, e->len,
+                    atomic_load_explicit(&e->value, memory_order_relaxed));
+            if (!c) {
+                chashmap_stripe_free(next, s, false);
+                pthread_mutex_unlock(&m->locks[s]);
+                return false;
+            }
+            j = chashmap_index(next, e->hash);
+            atomic_store_explicit(&c->next, atomic_load_explicit(
+                        &next->buckets[j], memory_order_relaxed),
+                    memory_order_relaxed);
+            atomic_store_explicit(&next->buckets[j], c, memory_order_relaxed);
+        }
+    }
+    atomic_store_explicit(&t->moved[s], true, memory_order_release);
+    for (i = s * per; i < (s + 1) * per; i++) {
+        e = atomic_load_explicit(&t->buckets[i], memory_order_relaxed);
+        while (e) {
+            c = atomic_load_explicit(&e->next, memory_order_relaxed);
+            epoch_retire(e);
+            e = c;
+        }
+    }
+    pthread_mutex_unlock(&m->locks[s]);
+    return true;
+}
+
+/*
+ * Grow map 'm' into a table twice the size, or carry on with a resize that an
+ * earlier call could not finish.
+ *
+ * Only one thread resizes at a time; any other thread that gets here in the
+ * meantime returns straight away rather than waiting.
+ */
+static void chashmap_grow(struct chashmap *m) {
+    if (pthread_mutex_trylock(&m->resize_lock) != 0) {
+        return;
+    }
+    struct chashmap_table *t = atomic_load(&m->table);
+    struct chashmap_table *next = atomic_load(&t->next);
+    if (!next) {
+        if (atomic_load(&m->count) <= t->size * CHASHMAP_MAX_LOAD ||
+                t->size >= CHASHMAP_MAX_SIZE ||
+                !(next = chashmap_table_create(t->size * 2))) {
+            pthread_mutex_unlock(&m->resize_lock);
+            return;
+        }
+        atomic_store_explicit(&t->next, next, memory_order_release);
+    }
+    for (size_t s = 0; s < CHASHMAP_STRIPES; s++) {
+        if (!atomic_load_explicit(&t->moved[s], memory_order_relaxed) &&
+                !chashmap_stripe_move(m, t, next, s)) {
+            pthread_mutex_unlock(&m->resize_lock);
+            return;
+        }
+    }
+    atomic_store_explicit(&m->table, next, memory_order_release);
+    pthread_mutex_unlock(&m->resize_lock);
+    epoch_retire(t);
+}
+
+/*
+ * Set the 'len' byte key 'k' to value 'v' in map 'm'.
+ *
+ * If an entry for the given key already exists, it takes the new value, and
+ * the old value is retired: it is freed once no reader can still be using
+ * it.  Otherwise, a new entry is created.
+ *
+ * 'v' must point to alloc'd memory.  When the map is destroyed, the data
+ * pointed to by 'v' will be freed also.
+ *
+ * Return whether the entry was set successfully.
+ */
+bool chashmap_set_len(struct chashmap *m, const void *k, size_t len, void *v) {
+    if (!m || !k || !v) {
+        return false;
+    }
+    const unsigned long hash = m->hash(k, len);
+    const size_t s = chashmap_stripe(hash);
+    epoch_enter();
+    pthread_mutex_lock(&m->locks[s]);
+    struct chashmap_table *t = chashmap_table_for(m, hash);
+    _Atomic(struct chashmap_entry *) *bucket =
+        &t->buckets[chashmap_index(t, hash)];
+    struct chashmap_entry *e = chashmap_find(
+            atomic_load_explicit(bucket, memory_order_relaxed), hash, k, len);
+    if (e) {
+        void *old = atomic_exchange(&e->value, v);
+        pthread_mutex_unlock(&m->locks[s]);
+        epoch_leave();
+        if (old != v) {
+            epoch_retire(old);
+        }
+        return true;
+    }
+
+    e = chashmap_entry_create(hash, k, len, v);
+    if (!e) {
+        pthread_mutex_unlock(&m->locks[s]);
+        epoch_leave();
+        return false;
+    }
+    atomic_store_explicit(&e->next,
+            atomic_load_explicit(bucket, memory_order_relaxed),
+            memory_order_relaxed);
+    atomic_store_explicit(bucket, e, memory_order_release);
+    const size_t count = atomic_fetch_add(&m->count, 1) + 1;
+    const bool grow = count > t->size * CHASHMAP_MAX_LOAD ||
+        t != atomic_load(&m->table);
+    pthread_mutex_unlock(&m->locks[s]);
+    epoch_leave();
+
+    if (grow) {
+        chashmap_grow(m);
+    }
+    return true;
+}
+
+bool chashmap_set(struct chashmap *m, const char *k, void *v) {
+    if (!k) {
+        return false;
+    }
+    return chashmap_set_len(m, k, strlen(k), v);
+}
+
+/*
+ * Return the value for the 'len' byte key 'k' in map 'm', or a NULL pointer
+ * if the key does not exist in the map.
+ *
+ * No lock is taken.  If another thread may replace or delete this key, call
+ * this inside epoch_enter() and epoch_leave(), and use the value before
+ * leaving, so that it cannot be freed in the meantime.
+ */
+void *chashmap_get_len(struct chashmap *m, const void *k, size_t len) {
+    if (!k) {
+        return 0;
+    }
+    const unsigned long hash = m->hash(k, len);
+    void *v = 0;
+    epoch_enter();
+    struct chashmap_table *t = chashmap_table_for(m, hash);
+    struct chashmap_entry *e = chashmap_find(atomic_load_explicit(
+                &t->buckets[chashmap_index(t, hash)], memory_order_acquire),
+            hash, k, len);
+    if (e) {
+        v = atomic_load_explicit(&e->value, memory_order_acquire);
+    }
+    epoch_leave();
+    return v;
+}
+
+void *chashmap_get(struct chashmap *m, const char *k) {
+    if (!k) {
+        return 0;
+    }
+    return chashmap_get_len(m, k, strlen(k));
+}
+
+bool chashmap_exists_len(struct chashmap *m, const void *k, size_t len) {
+    return chashmap_get_len(m, k, len) != 0;
+}
+
+bool chashmap_exists(struct chashmap *m, const char *k) {
+    return chashmap_get(m, k) != 0;
+}
+
+/*
+ * Delete the entry for the 'len' byte key 'k' from map 'm'.
+ *
+ * The entry and its value are retired, and freed once no reader can still be
+ * using them.
+ *
+ * Return whether an entry was deleted.
+ */
+bool chashmap_delete_len(struct chashmap *m, const void *k, size_t len) {
+    if (!m || !k) {
+        return false;
+    }
+    const unsigned long hash = m->hash(k, len);
+    const size_t s = chashmap_stripe(hash);
+    epoch_enter();
+    pthread_mutex_lock(&m->locks[s]);
+    struct chashmap_table *t = chashmap_table_for(m, hash);
+    _Atomic(struct chashmap_entry *) *link =
+        &t->buckets[chashmap_index(t, hash)];
+    struct chashmap_entry *e;
+    while ((e = atomic_load_explicit(link, memory_order_relaxed))) {
+        if (e->hash == hash && e->len == len && memcmp(e->key, k, len) == 0) {
+            atomic_store_explicit(link,
+                    atomic_load_explicit(&e->next, memory_order_relaxed),
+                    memory_order_release);
+            atomic_fetch_sub(&m->count, 1);
+            pthread_mutex_unlock(&m->locks[s]);
+            epoch_leave();
+            epoch_retire(atomic_load(&e->value));
+            epoch_retire(e);
+            return true;
+        }
+        link = &e->next;
+    }
+    pthread_mutex_unlock(&m->locks[s]);
+    epoch_leave();
+    return false;
+}
+
+bool chashmap_delete(struct chashmap *m, const char *k) {
+    if (!k) {
+        return false;
+    }
+    return chashmap_delete_len(m, k, strlen(k));
+}
@@ -0,0 +1,57 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "./hash.h"
+
+/*
+ * A hashmap that can be used from many threads at once.
+ *
+ * Writers lock one of CHASHMAP_STRIPES stripes, each covering a contiguous
+ * range of buckets, so writers to different parts of the map do not contend.
+ * Readers take no locks at all: they walk the chains inside an epoch critical
+ * section (see epoch.h), and unlinked entries and replaced values are only
+ * freed once no reader can still see them.
+ *
+ * Resizing moves one stripe at a time into a new table, holding only that
+ * stripe's lock.  Readers and writers check whether their stripe has moved
+ * yet to decide which table to use, so nobody waits for the whole resize.
+ */
+#define CHASHMAP_STRIPES 64
+
+struct chashmap_entry {
+    _Atomic(struct chashmap_entry *) next;
+    unsigned long hash;
+    _Atomic(void *) value;
+    size_t len;
+    char key[];
+};
+
+struct chashmap_table {
+    size_t size;
+    unsigned int shift;
+    _Atomic(struct chashmap_table *) next;
+    atomic_bool moved[CHASHMAP_STRIPES];
+    _Atomic(struct chashmap_entry *) buckets[];
+};
+
+struct chashmap {
+    hash_func hash;
+    _Atomic(struct chashmap_table *) table;
+    atomic_size_t count;
+    pthread_mutex_t resize_lock;
+    pthread_mutex_t locks[CHASHMAP_STRIPES];
+};
+
+struct chashmap *chashmap_create();
+struct chashmap *chashmap_create_with_hash(hash_func);
+void chashmap_destroy(struct chashmap *);
+size_t chashmap_count(struct chashmap *);
+bool chashmap_set(struct chashmap *, const char *, void *);
+void *chashmap_get(struct chashmap *, const char *);
+bool chashmap_delete(struct chashmap *, const char *);
+bool chashmap_exists(struct chashmap *, const char *);
+bool chashmap_set_len(struct chashmap *, const void *, size_t, void *);
+void *chashmap_get_len(struct chashmap *, const void *, size_t);
+bool chashmap_delete_len(struct chashmap *, const void *, size_t);
+bool chashmap_exists_len(struct chashmap *, const void *, size_t);
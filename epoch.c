@@ -0,0 +1,202 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "./epoch.h"
+
+/*
+ * Objects retired during global epoch 'e' are kept on the retiring thread's
+ * list for 'e' until the global epoch reaches 'e + 2'.  The global epoch only
+ * advances when every thread inside a critical section has seen the current
+ * one, so by then no reader can still be holding a pointer to them.  That
+ * means only three lists per thread are ever needed.
+ */
+#define EPOCH_LISTS 3
+/* Number of objects a thread retires between attempts to advance the epoch. */
+#define EPOCH_RETIRE_BATCH 64
+
+struct epoch_list {
+    unsigned long epoch;
+    size_t count;
+    size_t capacity;
+    void **items;
+};
+
+struct epoch_thread {
+    _Atomic unsigned long epoch;
+    atomic_bool active;
+    atomic_bool in_use;
+    unsigned int nest;
+    size_t retired;
+    struct epoch_list lists[EPOCH_LISTS];
+    struct epoch_thread *next;
+};
+
+static _Atomic unsigned long epoch_global = 0;
+static _Atomic(struct epoch_thread *) epoch_threads = 0;
+static pthread_key_t epoch_key;
+static pthread_once_t epoch_once = PTHREAD_ONCE_INIT;
+static _Thread_local struct epoch_thread *epoch_self = 0;
+
+/*
+ * Release the calling thread's registration when it exits.
+ *
+ * Anything it retired but could not free yet stays on its lists, and will be
+ * freed by whichever thread takes over the registration next.
+ */
+static void epoch_thread_exit(void *p) {
+    struct epoch_thread *t = p;
+    t->nest = 0;
+    atomic_store(&t->active, false);
+    atomic_store(&t->in_use, false);
+}
+
+static void epoch_init(void) {
+    pthread_key_create(&epoch_key, epoch_thread_exit);
+}
+
+/*
+ * Return the calling thread's registration, taking over a released one or
+ * adding a new one if it has none yet.
+ *
+ * Registrations are never freed, so the list can be walked without locks.
+ */
+static struct epoch_thread *epoch_thread(void) {
+    if (epoch_self) {
+        return epoch_self;
+    }
+    pthread_once(&epoch_once, epoch_init);
+    struct epoch_thread *t;
+    for (t = atomic_load(&epoch_threads); t; t = t->next) {
+        bool free = false;
+        if (atomic_compare_exchange_strong(&t->in_use, &free, true)) {
+            break;
+        }
+    }
+    if (!t) {
+        t = calloc(1, sizeof *t);
+        if (!t) {
+            /* There is no way to report failure from epoch_enter(). */
+            abort();
+        }
+        atomic_init(&t->epoch, 0);
+        atomic_init(&t->active, false);
+        atomic_init(&t->in_use, true);
+        t->next = atomic_load(&epoch_threads);
+        while (!atomic_compare_exchange_weak(&epoch_threads, &t->next, t)) {
+        }
+    }
+    pthread_setspecific(epoch_key, t);
+    epoch_self = t;
+    return t;
+}
+
+/*
+ * Enter a critical section.  Until the matching epoch_leave(), nothing
+ * retired by any thread after this point will be freed.
+ */
+void epoch_enter(void) {
+    struct epoch_thread *t = epoch_thread();
+    if (t->nest++ == 0) {
+        atomic_store(&t->active, true);
+        atomic_store(&t->epoch, atomic_load(&epoch_global));
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+}
+
+/*
+ * Leave a critical section entered with epoch_enter().
+ */
+void epoch_leave(void) {
+    struct epoch_thread *t = epoch_self;
+    if (--t->nest == 0) {
+        atomic_store_explicit(&t->active, false, memory_order_release);
+    }
+}
+
+/*
+ * Free every object on list 'l'.
+ */
+static void epoch_list_free(struct epoch_list *l) {
+    for (size_t i = 0; i < l->count; i++) {
+        free(l->items[i]);
+    }
+    l->count = 0;
+}
+
+/*
+ * Try to advance the global epoch, then free whatever the calling thread
+ * retired at least two epochs ago.
+ *
+ * The epoch cannot advance while any thread is still inside a critical
+ * section it entered during an earlier epoch.
+ *
+ * Return whether the global epoch was advanced.
+ */
+bool epoch_reclaim(void) {
+    struct epoch_thread *self = epoch_thread();
+    unsigned long e = atomic_load(&epoch_global);
+    bool advanced = true;
+    for (struct epoch_thread *t = atomic_load(&epoch_threads); t;
+            t = t->next) {
+        if (atomic_load(&t->active) && atomic_load(&t->epoch) != e) {
+            advanced = false;
+            break;
+        }
+    }
+    if (advanced) {
+        advanced = atomic_compare_exchange_strong(&epoch_global, &e, e + 1);
+        e = atomic_load(&epoch_global);
+    }
+    for (size_t i = 0; i < EPOCH_LISTS; i++) {
+        struct epoch_list *l = &self->lists[i];
+        if (l->count && l->epoch + 2 <= e) {
+            epoch_list_free(l);
+        }
+    }
+    return advanced;
+}
+
+/*
+ * Free the object at 'p' with free() once no reader can be using it any
+ * more.
+ *
+ * 'p' must already be unreachable for readers that have not yet entered their
+ * critical section.
+ */
+void epoch_retire(void *p) {
+    if (!p) {
+        return;
+    }
+    struct epoch_thread *t = epoch_thread();
+    const unsigned long e = atomic_load(&epoch_global);
+    struct epoch_list *l = &t->lists[e % EPOCH_LISTS];
+    if (l->epoch != e) {
+        /* Anything still here is from epoch e - 3 or earlier. */
+        epoch_list_free(l);
+        l->epoch = e;
+    }
+    if (l->count == l->capacity) {
+        size_t capacity = l->capacity ? l->capacity * 2 : EPOCH_RETIRE_BATCH;
+        void **items = realloc(l->items, capacity * sizeof *items);
+        if (!items) {
+            /*
+             * Wait for it to be safe to free instead.  That can never happen
+             * inside a critical section of our own, so in that case the
+             * object has to be leaked.
+             */
+            if (t->nest == 0) {
+                while (atomic_load(&epoch_global) < e + 2) {
+                    epoch_reclaim();
+                }
+                free(p);
+            }
+            return;
+        }
+        l->items = items;
+        l->capacity = capacity;
+    }
+    l->items[l->count++] = p;
+    if (++t->retired % EPOCH_RETIRE_BATCH == 0) {
+        epoch_reclaim();
+    }
+}
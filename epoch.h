@@ -0,0 +1,22 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stdbool.h>
+
+/*
+ * Epoch-based memory reclamation for data structures with lock-free readers.
+ *
+ * Readers bracket their accesses with epoch_enter() and epoch_leave().
+ * Writers that unlink an object pass it to epoch_retire() instead of free(),
+ * and it is freed only once every reader that might still hold a pointer to
+ * it has left.  Critical sections may nest.
+ *
+ * Each thread is registered automatically the first time it calls in, and
+ * its registration is released for reuse when the thread exits.
+ */
+void epoch_enter(void);
+void epoch_leave(void);
+void epoch_retire(void *);
+bool epoch_reclaim(void);
+
+#endif
@@ -0,0 +1,364 @@
+#include <stdlib.h>
+#include <string.h>
+#include "./fhashmap.h"
+#include "./hash.h"
+#include "./intern.h"
+
+/* Average number of keys per displacement bucket. */
+#define FHASHMAP_LAMBDA 4
+
+/* Give up on a bucket after trying this many displacements. */
+#define FHASHMAP_MAX_DISP 0x10000000u
+
+/* Alignment of inline values within the key block. */
+#define FHASHMAP_VALUE_ALIGN _Alignof (max_align_t)
+
+/*
+ * Return the slot out of 'n' for a key with hash 'hash' in a bucket with
+ * displacement 'd'.
+ *
+ * The displacement is folded into the hash and the result mixed with the
+ * 64 bit finaliser from MurmurHash3, so that every displacement gives a
+ * bucket's keys a fresh, independent set of slots.
+ */
+static inline size_t fhashmap_position(
+        const uint64_t hash,
+        const uint32_t d,
+        const size_t n) {
+    uint64_t x = hash + d * 0x9e3779b97f4a7c15ull;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return (size_t) (((x >> 32) * (uint64_t) n) >> 32);
+}
+
+static inline size_t fhashmap_bucket(const uint64_t hash, const size_t n) {
+    return (size_t) (((hash & 0xffffffffu) * (uint64_t) n) >> 32);
+}
+
+static inline size_t fhashmap_slot_index(
+        const struct fhashmap *f,
+        const uint64_t hash) {
+    const uint32_t d = f->disp[fhashmap_bucket(hash, f->nbuckets)];
+    if (d & FHASHMAP_DIRECT) {
+        return d & ~FHASHMAP_DIRECT;
+    }
+    return fhashmap_position(hash, d, f->count);
+}
+
+/*
+ * Entries of the hashmap being frozen, sorted by bucket, along with the keys'
+ * hashes.
+ */
+struct fhashmap_builder {
+    const struct hashmap_entry **entries;
+    uint64_t *hashes;
+    size_t n;
+    size_t nbuckets;
+    size_t *starts;
+    size_t largest;
+    bool *taken;
+    size_t *trial;
+};
+
+/*
+ * Find a displacement for bucket 'b' that sends each of its keys to a
+ * distinct free slot, mark those slots taken, and store the displacement in
+ * 'f'.
+ *
+ * Return false if no displacement works, which only happens if two keys in
+ * the bucket have the same 64 bit hash.
+ */
+static bool fhashmap_place(
+        struct fhashmap_builder *w,
+        struct fhashmap *f,
+        const size_t b) {
+    const size_t start = w->starts[b];
+    const size_t size = w->starts[b + 1] - start;
+    const uint64_t *hashes = &w->hashes[start];
+    for (size_t i = 1; i < size; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (hashes[i] == hashes[j]) {
+                return false;
+            }
+        }
+    }
+    for (uint32_t d = 0; d < FHASHMAP_MAX_DISP; d++) {
+        size_t i;
+        for (i = 0; i < size; i++) {
+            const size_t pos = fhashmap_position(hashes[i], d, w->n);
+            if (w->taken[pos]) {
+                break;
+            }
+            w->taken[pos] = true;
+            w->trial[i] = pos;
+        }
+        if (i == size) {
+            f->disp[b] = d;
+            return true;
+        }
+        while (i-- > 0) {
+            w->taken[w->trial[i]] = false;
+        }
+    }
+    return false;
+}
+
+/*
+ * Collect every entry of hashmap 'm' into 'w', grouped by displacement
+ * bucket, including any entries still in the old bucket array.
+ */
+static void fhashmap_collect(
+        struct fhashmap_builder *w,
+        const struct hashmap *m) {
+    const bool rehash =
+        (m->intern ? m->intern->hash : m->hash) != hash_xx64_len;
+    struct hashmap_entry **arrays[] = {m->old_buckets, m->buckets};
+    const size_t from[] = {m->migrated, 0};
+    const size_t to[] = {m->old_buckets ? m->old_size : 0, m->size};
+    for (int pass = 0; pass < 2; pass++) {
+        for (int a = 0; a < 2; a++) {
+            for (size_t i = from[a]; i < to[a]; i++) {
+                for (const struct hashmap_entry *e = arrays[a][i]; e;
+                        e = e->next) {
+                    size_t len;
+                    const char *k = hashmap_entry_key(m, e, &len);
+                    const uint64_t hash = rehash ?
+                        hash_xx64_len(k, len) : e->hash;
+                    const size_t b = fhashmap_bucket(hash, w->nbuckets);
+                    if (pass == 0) {
+                        w->starts[b + 1]++;
+                    } else {
+                        const size_t at = w->starts[b]++;
+                        w->entries[at] = e;
+                        w->hashes[at] = hash;
+                    }
+                }
+            }
+        }
+        if (pass == 0) {
+            w->largest = 1;
+            for (size_t b = 1; b <= w->nbuckets; b++) {
+                if (w->starts[b] > w->largest) {
+                    w->largest = w->starts[b];
+                }
+                w->starts[b] += w->starts[b - 1];
+            }
+        } else {
+            /* Each start has moved along to the next bucket's. */
+            memmove(&w->starts[1], &w->starts[0],
+                    w->nbuckets * sizeof *w->starts);
+            w->starts[0] = 0;
+        }
+    }
+}
+
+/*
+ * Work out the displacements for every bucket in 'w', placing the largest
+ * buckets first while the table is still mostly empty.
+ *
+ * Buckets with a single key are placed last, each straight into the next free
+ * slot, so the hardest part of filling a table with no spare room costs
+ * nothing.
+ */
+static bool fhashmap_displace(struct fhashmap_builder *w, struct fhashmap *f) {
+    for (size_t size = w->largest; size > 1; size--) {
+        for (size_t b = 0; b < w->nbuckets; b++) {
+            if (w->starts[b + 1] - w->starts[b] == size &&
+                    !fhashmap_place(w, f, b)) {
+                return false;
+            }
+        }
+    }
+    size_t free_slot = 0;
+    for (size_t b = 0; b < w->nbuckets; b++) {
+        if (w->starts[b + 1] - w->starts[b] == 1) {
+            while (w->taken[free_slot]) {
+                free_slot++;
+            }
+            w->taken[free_slot] = true;
+            f->disp[b] = FHASHMAP_DIRECT | (uint32_t) free_slot;
+        }
+    }
+    return true;
+}
+
+/*
+ * Return 'n' rounded up to a multiple of FHASHMAP_VALUE_ALIGN.
+ */
+static inline size_t fhashmap_pad(const size_t n) {
+    const size_t align = FHASHMAP_VALUE_ALIGN;
+    return (n + align - 1) & ~(align - 1);
+}
+
+/*
+ * Fill in the slots of 'f' from the entries of hashmap 'm', taking its
+ * values over, and copy every key into one block in slot order.  An inline
+ * value is copied in after its key.
+ */
+static bool fhashmap_fill(
+        struct fhashmap_builder *w,
+        struct fhashmap *f,
+        const struct hashmap *m) {
+    const bool inline_values = m->values == HASHMAP_VALUES_INLINE;
+    size_t total = 0;
+    for (size_t i = 0; i < w->n; i++) {
+        const struct hashmap_entry *e = w->entries[i];
+        struct fhashmap_slot *s = &f->slots[fhashmap_slot_index(f,
+                w->hashes[i])];
+        s->hash = w->hashes[i];
+        s->key = hashmap_entry_key(m, e, &s->len);
+        s->value = e->value;
+        total += inline_values ?
+            fhashmap_pad(fhashmap_pad(s->len + 1) + m->value_size) :
+            s->len + 1;
+    }
+    f->keys = malloc(total ? total : 1);
+    if (!f->keys) {
+        return false;
+    }
+    char *k = f->keys;
+    for (size_t i = 0; i < w->n; i++) {
+        struct fhashmap_slot *s = &f->slots[i];
+        memcpy(k, s->key, s->len);
+        k[s->len] = 0;
+        s->key = k;
+        if (inline_values) {
+            k += fhashmap_pad(s->len + 1);
+            memcpy(k, s->value, m->value_size);
+            s->value = k;
+            k += fhashmap_pad(m->value_size);
+        } else {
+            k += s->len + 1;
+        }
+    }
+    return true;
+}
+
+static void fhashmap_builder_destroy(struct fhashmap_builder *w) {
+    free(w->entries);
+    free(w->hashes);
+    free(w->starts);
+    free(w->taken);
+    free(w->trial);
+}
+
+/*
+ * Build an immutable, minimal perfect hashed map from the contents of
+ * hashmap 'm', for a set of keys that is built once and only read after.
+ *
+ * Building is much slower than filling a hashmap, since every bucket of keys
+ * has to search for a displacement that fits, but a lookup then costs one
+ * hash, one read of the bucket's displacement, one slot and one key compare,
+ * with no chains to follow and no empty slots.
+ *
+ * On success, the values move over to the new map and 'm' is destroyed.  If
+ * the map cannot be built, return a NULL pointer and leave 'm' as it was.
+ * This happens if memory runs out, if 'm' has 2^31 keys or more, or if two
+ * keys have the same 64 bit xx64 hash.
+ */
+struct fhashmap *hashmap_freeze(struct hashmap *m) {
+    if (!m || m->count >= FHASHMAP_DIRECT) {
+        return 0;
+    }
+    struct fhashmap_builder w;
+    w.n = m->count;
+    w.nbuckets = w.n / FHASHMAP_LAMBDA + 1;
+    w.entries = malloc((w.n ? w.n : 1) * sizeof *w.entries);
+    w.hashes = malloc((w.n ? w.n : 1) * sizeof *w.hashes);
+    w.starts = calloc(w.nbuckets + 1, sizeof *w.starts);
+    w.taken = calloc(w.n ? w.n : 1, sizeof *w.taken);
+    w.trial = 0;
+    w.largest = 1;
+
+    struct fhashmap *f = calloc(1, sizeof *f);
+    if (f) {
+        f->count = w.n;
+        f->nbuckets = w.nbuckets;
+        f->values = m->values;
+        f->free_value = m->free_value;
+        f->disp = calloc(w.nbuckets, sizeof *f->disp);
+        f->slots = calloc(w.n ? w.n : 1, sizeof *f->slots);
+    }
+    bool ok = f && f->disp && f->slots &&
+        w.entries && w.hashes && w.starts && w.taken;
+    if (ok) {
+        fhashmap_collect(&w, m);
+        w.trial = malloc(w.largest * sizeof *w.trial);
+        ok = w.trial && fhashmap_displace(&w, f) && fhashmap_fill(&w, f, m);
+    }
+    if (!ok) {
+        fhashmap_builder_destroy(&w);
+        if (f) {
+            f->free_value = 0;
+            fhashmap_destroy(f);
+        }
+        return 0;
+    }
+
+    /* The values belong to the frozen map now. */
+    for (size_t i = 0; i < w.n; i++) {
+        ((struct hashmap_entry *) w.entries[i])->value = 0;
+    }
+    fhashmap_builder_destroy(&w);
+    hashmap_destroy(m);
+    return f;
+}
+
+/*
+ * Destroy frozen map 'f', handing each of its values to the 'free_value'
+ * function it took over from its hashmap, if any.
+ */
+void fhashmap_destroy(struct fhashmap *f) {
+    if (!f) {
+        return;
+    }
+    for (size_t i = 0; f->free_value && i < f->count; i++) {
+        if (f->slots[i].value) {
+            f->free_value(f->slots[i].value);
+        }
+    }
+    free(f->keys);
+    free(f->slots);
+    free(f->disp);
+    free(f);
+}
+
+/*
+ * Return the value for the 'len' byte key 'k' in frozen map 'f', or for word
+ * and inline values, a pointer to it.
+ *
+ * If the key does not exist in the map, return a NULL pointer.
+ */
+void *fhashmap_get_len(const struct fhashmap *f, const void *k, size_t len) {
+    if (f->count == 0) {
+        return 0;
+    }
+    const uint64_t hash = hash_xx64_len(k, len);
+    const struct fhashmap_slot *s = &f->slots[fhashmap_slot_index(f, hash)];
+    if (s->hash == hash && s->len == len && memcmp(s->key, k, len) == 0) {
+        return f->values == HASHMAP_VALUES_WORD ? (void *) &s->value :
+            s->value;
+    }
+    return 0;
+}
+
+void *fhashmap_get(const struct fhashmap *f, const char *k) {
+    if (!k) {
+        return 0;
+    }
+    return fhashmap_get_len(f, k, strlen(k));
+}
+
+bool fhashmap_exists_len(const struct fhashmap *f, const void *k, size_t len) {
+    return fhashmap_get_len(f, k, len) != 0;
+}
+
+bool fhashmap_exists(const struct fhashmap *f, const char *k) {
+    if (!k) {
+        return false;
+    }
+    return fhashmap_exists_len(f, k, strlen(k));
+}
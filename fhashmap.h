@@ -0,0 +1,48 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "./hashmap.h"
+
+/*
+ * An immutable hashmap built from a struct hashmap by hashmap_freeze(), using
+ * a minimal perfect hash: every key has a slot of its own, and there are
+ * exactly as many slots as keys.
+ *
+ * Keys are hashed with hash_xx64_len() and split into 'nbuckets' small
+ * buckets.  Each bucket has a displacement in 'disp', chosen when the map was
+ * built so that the keys of every bucket land in distinct free slots.  A
+ * lookup hashes the key once, reads its bucket's displacement, works out the
+ * slot, and compares the one key found there.
+ *
+ * A displacement with FHASHMAP_DIRECT set holds the slot number itself, for
+ * buckets with just one key, which are placed last in whatever slots are
+ * left.
+ *
+ * Values are kept the way the hashmap kept them.  Inline values are copied
+ * into 'keys' along with their keys.
+ */
+#define FHASHMAP_DIRECT 0x80000000u
+
+struct fhashmap_slot {
+    uint64_t hash;
+    const char *key;
+    size_t len;
+    void *value;
+};
+
+struct fhashmap {
+    size_t count;
+    size_t nbuckets;
+    uint32_t *disp;
+    struct fhashmap_slot *slots;
+    char *keys;
+    enum hashmap_values values;
+    hashmap_free_func free_value;
+};
+
+struct fhashmap *hashmap_freeze(struct hashmap *);
+void fhashmap_destroy(struct fhashmap *);
+void *fhashmap_get(const struct fhashmap *, const char *);
+bool fhashmap_exists(const struct fhashmap *, const char *);
+void *fhashmap_get_len(const struct fhashmap *, const void *, size_t);
+bool fhashmap_exists_len(const struct fhashmap *, const void *, size_t);
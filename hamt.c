@@ -0,0 +1,604 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "./hamt.h"
+
+/* Each level of the trie branches on this many bits of the hash. */
+#define HAMT_BITS 5
+#define HAMT_MASK ((1u << HAMT_BITS) - 1)
+/* Once a node is this deep in bits, the hash has nothing left to branch on. */
+#define HAMT_HASH_BITS (sizeof (unsigned long) * CHAR_BIT)
+
+#ifdef __GNUC__
+#define hamt_popcount(x) ((unsigned int) __builtin_popcount(x))
+#else
+static inline unsigned int hamt_popcount(uint32_t x) {
+    unsigned int n = 0;
+    for (; x; x &= x - 1) {
+        n++;
+    }
+    return n;
+}
+#endif
+
+/*
+ * Outcomes of removing a key from a node.
+ */
+enum hamt_result {
+    HAMT_ABSENT,
+    HAMT_REMOVED,
+    HAMT_FAILED
+};
+
+struct hamt *hamt_create_with_hash(hash_func hash) {
+    struct hamt *t = malloc(sizeof *t);
+    if (!t) {
+        return 0;
+    }
+    t->hash = hash ? hash : hash_xx64_len;
+    t->count = 0;
+    t->root = 0;
+    return t;
+}
+
+/*
+ * Create an empty map, hashing its keys with hash_xx64_len().
+ */
+struct hamt *hamt_create() {
+    return hamt_create_with_hash(0);
+}
+
+/*
+ * Return the bit for hash 'hash' in the bitmap of a node 'shift' bits deep.
+ */
+static inline uint32_t hamt_bit(
+        const unsigned long hash,
+        const unsigned int shift) {
+    return 1u << ((hash >> shift) & HAMT_MASK);
+}
+
+/*
+ * Return the position in the slots of node 'n' of the slot for 'bit'.
+ */
+static inline unsigned int hamt_index(
+        const struct hamt_node *n,
+        const uint32_t bit) {
+    return hamt_popcount(n->bitmap & (bit - 1));
+}
+
+/*
+ * Take another reference to leaf or node 'p'.  Leaves and nodes both begin
+ * with their reference count, so it does not matter which.
+ */
+static inline void hamt_retain(void *p) {
+    ++*(unsigned int *) p;
+}
+
+static void hamt_leaf_release(struct hamt_leaf *l) {
+    if (--l->refs == 0) {
+        free(l->value);
+        free(l);
+    }
+}
+
+/*
+ * Drop a reference to node 'n', and once there are none left, free it and
+ * drop its own references to everything in its slots.
+ */
+static void hamt_node_release(struct hamt_node *n) {
+    if (!n || --n->refs) {
+        return;
+    }
+    if (!n->bitmap) {
+        for (unsigned int i = 0; i < n->size; i++) {
+            hamt_leaf_release(n->slots[i]);
+        }
+    } else {
+        unsigned int i = 0;
+        for (uint32_t b = n->bitmap; b; b &= b - 1, i++) {
+            if (n->leafmap & b & -b) {
+                hamt_leaf_release(n->slots[i]);
+            } else {
+                hamt_node_release(n->slots[i]);
+            }
+        }
+    }
+    free(n);
+}
+
+static struct hamt_leaf *hamt_leaf_create(
+        const unsigned long hash,
+        const char *k,
+        const size_t len,
+        void *v) {
+    struct hamt_leaf *l = malloc(offsetof(struct hamt_leaf, key) + len + 1);
+    if (!l) {
+        return 0;
+    }
+    l->refs = 1;
+    l->hash = hash;
+    l->value = v;
+    l->len = len;
+    memcpy(l->key, k, len);
+    l->key[len] = '\0';
+    return l;
+}
+
+/*
+ * Return whether leaf 'l' holds the 'len' byte key 'k' with hash 'hash'.
+ */
+static inline bool hamt_leaf_match(
+        const struct hamt_leaf *l,
+        const unsigned long hash,
+        const char *k,
+        const size_t len) {
+    return l->hash == hash && l->len == len && memcmp(l->key, k, len) == 0;
+}
+
+static struct hamt_node *hamt_node_alloc(const unsigned int size) {
+    struct hamt_node *n = malloc(sizeof *n + size * sizeof n->slots[0]);
+    if (n) {
+        n->refs = 1;
+        n->size = size;
+    }
+    return n;
+}
+
+/*
+ * Return a copy of node 'n' with the slot at position 'i', for 'bit', holding
+ * 'slot' instead, which is a leaf if 'leaf' is true.
+ *
+ * The copy takes a reference to everything it shares with 'n', but not to
+ * 'slot'.  Return a NULL pointer if the copy cannot be allocated.
+ */
+static struct hamt_node *hamt_node_replace(
+        const struct hamt_node *n,
+        const unsigned int i,
+        const uint32_t bit,
+        void *slot,
+        const bool leaf) {
+    struct hamt_node *c = hamt_node_alloc(n->size);
+    if (!c) {
+        return 0;
+    }
+    c->bitmap = n->bitmap;
+    c->leafmap = leaf ? n->leafmap | bit : n->leafmap & ~bit;
+    for (unsigned int j = 0; j < n->size; j++) {
+        if (j != i) {
+            c->slots[j] = n->slots[j];
+            hamt_retain(c->slots[j]);
+        }
+    }
+    c->slots[i] = slot;
+    return c;
+}
+
+/*
+ * As for hamt_node_replace(), but with a new slot inserted at position 'i'.
+ */
+static struct hamt_node *hamt_node_insert(
+        const struct hamt_node *n,
+        const unsigned int i,
+        const uint32_t bit,
+        void *slot,
+        const bool leaf) {
+    struct hamt_node *c = hamt_node_alloc(n->size + 1);
+    if (!c) {
+        return 0;
+    }
+    c->bitmap = n->bitmap | bit;
+    c->leafmap = leaf ? n->leafmap | bit : n->leafmap;
+    for (unsigned int j = 0; j < n->size; j++) {
+        c->slots[j < i ? j : j + 1] = n->slots[j];
+        hamt_retain(n->slots[j]);
+    }
+    c->slots[i] = slot;
+    return c;
+}
+
+/*
+ * As for hamt_node_replace(), but with the slot at position 'i' removed.
+ */
+static struct hamt_node *hamt_node_remove(
+        const struct hamt_node *n,
+        const unsigned int i,
+        const uint32_t bit) {
+    struct hamt_node *c = hamt_node_alloc(n->size - 1);
+    if (!c) {
+        return 0;
+    }
+    c->bitmap = n->bitmap & ~bit;
+    c->leafmap = n->leafmap & ~bit;
+    for (unsigned int j = 0; j < n->size; j++) {
+        if (j != i) {
+            c->slots[j < i ? j : j - 1] = n->slots[j];
+            hamt_retain(n->slots[j]);
+        }
+    }
+    return c;
+}
+
+/*
+ * Return a new node 'shift' bits deep holding the two leaves 'a' and 'b',
+ * with as many nodes below it as it takes for their hashes to differ, or a
+ * collision node if they never do.
+ */
+static struct hamt_node *hamt_node_pair(
+        struct hamt_leaf *a,
+        struct hamt_leaf *b,
+        const unsigned int shift) {
+    struct hamt_node *n;
+    if (shift >= HAMT_HASH_BITS) {
+        if (!(n = hamt_node_alloc(2))) {
+            return 0;
+        }
+        n->bitmap = 0;
+        n->leafmap = 0;
+        n->slots[0] = a;
+        n->slots[1] = b;
+        hamt_retain(a);
+        hamt_retain(b);
+        return n;
+    }
+
+    const uint32_t bit_a = hamt_bit(a->hash, shift);
+    const uint32_t bit_b = hamt_bit(b->hash, shift);
+    if (bit_a == bit_b) {
+        struct hamt_node *sub = hamt_node_pair(a, b, shift + HAMT_BITS);
+        if (!sub) {
+            return 0;
+        }
+        if (!(n = hamt_node_alloc(1))) {
+            hamt_node_release(sub);
+            return 0;
+        }
+        n->bitmap = bit_a;
+        n->leafmap = 0;
+        n->slots[0] = sub;
+        return n;
+    }
+
+    if (!(n = hamt_node_alloc(2))) {
+        return 0;
+    }
+    n->bitmap = bit_a | bit_b;
+    n->leafmap = n->bitmap;
+    n->slots[bit_a < bit_b ? 0 : 1] = a;
+    n->slots[bit_a < bit_b ? 1 : 0] = b;
+    hamt_retain(a);
+    hamt_retain(b);
+    return n;
+}
+
+/*
+ * Return a copy of node 'n', 'shift' bits deep, with leaf 'l' set in it,
+ * replacing any leaf for the same key.  'n' itself is unchanged.  If the key
+ * was not there before, set 'added'.
+ *
+ * Return a NULL pointer if any of the new nodes cannot be allocated.
+ */
+static struct hamt_node *hamt_node_set(
+        const struct hamt_node *n,
+        const unsigned int shift,
+        struct hamt_leaf *l,
+        bool *added) {
+    struct hamt_node *c, *sub;
+    if (!n->bitmap) {
+        for (unsigned int i = 0; i < n->size; i++) {
+            if (hamt_leaf_match(n->slots[i], l->hash, l->key, l->len)) {
+                if ((c = hamt_node_replace(n, i, 0, l, true))) {
+                    hamt_retain(l);
+                }
+                return c;
+            }
+        }
+        if ((c = hamt_node_insert(n, n->size, 0, l, true))) {
+            hamt_retain(l);
+            *added = true;
+        }
+        return c;
+    }
+
+    const uint32_t bit = hamt_bit(l->hash, shift);
+    const unsigned int i = hamt_index(n, bit);
+    if (!(n->bitmap & bit)) {
+        if ((c = hamt_node_insert(n, i, bit, l, true))) {
+            hamt_retain(l);
+            *added = true;
+        }
+        return c;
+    }
+    if (n->leafmap & bit) {
+        struct hamt_leaf *old = n->slots[i];
+        if (hamt_leaf_match(old, l->hash, l->key, l->len)) {
+            if ((c = hamt_node_replace(n, i, bit, l, true))) {
+                hamt_retain(l);
+            }
+            return c;
+        }
+        /* Another key lives here, so push both down into a new node. */
+        sub = hamt_node_pair(old, l, shift + HAMT_BITS);
+        *added = true;
+    } else {
+        sub = hamt_node_set(n->slots[i], shift + HAMT_BITS, l, added);
+    }
+    if (!sub) {
+        return 0;
+    }
+    if (!(c = hamt_node_replace(n, i, bit, sub, false))) {
+        hamt_node_release(sub);
+    }
+    return c;
+}
+
+/*
+ * Work out node 'n', 'shift' bits deep, without the 'len' byte key 'k' with
+ * hash 'hash'.  'n' itself is unchanged.
+ *
+ * If the key is there, set 'out' to what should take the place of 'n': a
+ * copy of it without the key, or a NULL pointer if nothing is left.  Below the
+ * root, a node that would be left holding a single leaf is replaced by the
+ * leaf itself, and 'leaf' is set to say so.
+ */
+static enum hamt_result hamt_node_delete(
+        const struct hamt_node *n,
+        const unsigned int shift,
+        const unsigned long hash,
+        const char *k,
+        const size_t len,
+        void **out,
+        bool *leaf) {
+    *leaf = false;
+    if (!n->bitmap) {
+        for (unsigned int i = 0; i < n->size; i++) {
+            if (!hamt_leaf_match(n->slots[i], hash, k, len)) {
+                continue;
+            }
+            if (n->size == 2) {
+                *out = n->slots[1 - i];
+                hamt_retain(*out);
+                *leaf = true;
+                return HAMT_REMOVED;
+            }
+            *out = hamt_node_remove(n, i, 0);
+            return *out ? HAMT_REMOVED : HAMT_FAILED;
+        }
+        return HAMT_ABSENT;
+    }
+
+    const uint32_t bit = hamt_bit(hash, shift);
+    const unsigned int i = hamt_index(n, bit);
+    if (!(n->bitmap & bit)) {
+        return HAMT_ABSENT;
+    }
+    if (n->leafmap & bit) {
+        if (!hamt_leaf_match(n->slots[i], hash, k, len)) {
+            return HAMT_ABSENT;
+        }
+        if (n->size == 1) {
+            *out = 0;
+            return HAMT_REMOVED;
+        }
+        if (n->size == 2 && shift > 0 && (n->leafmap & ~bit)) {
+            *out = n->slots[1 - i];
+            hamt_retain(*out);
+            *leaf = true;
+            return HAMT_REMOVED;
+        }
+        *out = hamt_node_remove(n, i, bit);
+        return *out ? HAMT_REMOVED : HAMT_FAILED;
+    }
+
+    void *sub;
+    bool sub_leaf;
+    enum hamt_result r = hamt_node_delete(
+            n->slots[i], shift + HAMT_BITS, hash, k, len, &sub, &sub_leaf);
+    if (r != HAMT_REMOVED) {
+        return r;
+    }
+    if (sub_leaf && n->size == 1 && shift > 0) {
+        /* Pass the last leaf further up. */
+        *out = sub;
+        *leaf = true;
+        return HAMT_REMOVED;
+    }
+    if (!sub) {
+        *out = hamt_node_remove(n, i, bit);
+    } else if (!(*out = hamt_node_replace(n, i, bit, sub, sub_leaf))) {
+        if (sub_leaf) {
+            hamt_leaf_release(sub);
+        } else {
+            hamt_node_release(sub);
+        }
+    }
+    return *out ? HAMT_REMOVED : HAMT_FAILED;
+}
+
+/*
+ * Release version 't' of a map.  Whatever no other version shares is freed,
+ * values included.
+ */
+void hamt_destroy(struct hamt *t) {
+    if (!t) {
+        return;
+    }
+    hamt_node_release(t->root);
+    free(t);
+}
+
+/*
+ * Return the value for the 'len' byte key 'k' in version 't'.
+ *
+ * If the key does not exist in this version, return a NULL pointer.
+ */
+void *hamt_get_len(const struct hamt *t, const void *k, size_t len) {
+    const unsigned long hash = t->hash(k, len);
+    const struct hamt_node *n = t->root;
+    for (unsigned int shift = 0; n; shift += HAMT_BITS) {
+        if (!n->bitmap) {
+            for (unsigned int i = 0; i < n->size; i++) {
+                const struct hamt_leaf *l = n->slots[i];
+                if (hamt_leaf_match(l, hash, k, len)) {
+                    return l->value;
+                }
+            }
+            return 0;
+        }
+        const uint32_t bit = hamt_bit(hash, shift);
+        if (!(n->bitmap & bit)) {
+            return 0;
+        }
+        const void *slot = n->slots[hamt_index(n, bit)];
+        if (n->leafmap & bit) {
+            const struct hamt_leaf *l = slot;
+            return hamt_leaf_match(l, hash, k, len) ? l->value : 0;
+        }
+        n = slot;
+    }
+    return 0;
+}
+
+void *hamt_get(const struct hamt *t, const char *k) {
+    if (!k) {
+        return 0;
+    }
+    return hamt_get_len(t, k, strlen(k));
+}
+
+bool hamt_exists_len(const struct hamt *t, const void *k, size_t len) {
+    return hamt_get_len(t, k, len) != 0;
+}
+
+bool hamt_exists(const struct hamt *t, const char *k) {
+    if (!k) {
+        return false;
+    }
+    return hamt_exists_len(t, k, strlen(k));
+}
+
+/*
+ * Return a new version of 't' holding 'count' keys under 'root', which the
+ * new version takes over.
+ */
+static struct hamt *hamt_version(
+        const struct hamt *t,
+        struct hamt_node *root,
+        const size_t count) {
+    struct hamt *r = malloc(sizeof *r);
+    if (!r) {
+        return 0;
+    }
+    r->hash = t->hash;
+    r->count = count;
+    r->root = root;
+    return r;
+}
+
+/*
+ * Return a new version of 't' with the 'len' byte key 'k' set to value 'v'.
+ * 't' itself is unchanged, and the two versions share all but the nodes on
+ * the path to the key.
+ *
+ * 'v' must point to alloc'd memory, and belongs to the map from now on.  It
+ * is freed once no version holds it any longer.
+ *
+ * Return a NULL pointer if the new version cannot be created, in which case
+ * 'v' still belongs to the caller.
+ */
+struct hamt *hamt_set_len(
+        const struct hamt *t,
+        const void *k,
+        size_t len,
+        void *v) {
+    if (!t || !k || !v) {
+        return 0;
+    }
+    if (hamt_get_len(t, k, len) == v) {
+        if (t->root) {
+            hamt_retain(t->root);
+        }
+        struct hamt *r = hamt_version(t, t->root, t->count);
+        if (!r) {
+            hamt_node_release(t->root);
+        }
+        return r;
+    }
+
+    const unsigned long hash = t->hash(k, len);
+    struct hamt_leaf *l = hamt_leaf_create(hash, k, len, v);
+    if (!l) {
+        return 0;
+    }
+    struct hamt_node *root = 0;
+    bool added = false;
+    if (!t->root) {
+        if ((root = hamt_node_alloc(1))) {
+            root->bitmap = hamt_bit(hash, 0);
+            root->leafmap = root->bitmap;
+            root->slots[0] = l;
+            hamt_retain(l);
+            added = true;
+        }
+    } else {
+        root = hamt_node_set(t->root, 0, l, &added);
+    }
+
+    struct hamt *r = root ? hamt_version(t, root, t->count + added) : 0;
+    if (!r) {
+        hamt_node_release(root);
+        l->value = 0;
+    }
+    hamt_leaf_release(l);
+    return r;
+}
+
+struct hamt *hamt_set(const struct hamt *t, const char *k, void *v) {
+    if (!k) {
+        return 0;
+    }
+    return hamt_set_len(t, k, strlen(k), v);
+}
+
+/*
+ * Return a new version of 't' without the 'len' byte key 'k'.  't' itself is
+ * unchanged.  If the key is not in 't', the new version has the same
+ * contents.
+ *
+ * Return a NULL pointer if the new version cannot be created.
+ */
+struct hamt *hamt_delete_len(const struct hamt *t, const void *k, size_t len) {
+    if (!t || !k) {
+        return 0;
+    }
+    if (t->root) {
+        void *root;
+        bool leaf;
+        switch (hamt_node_delete(t->root, 0, t->hash(k, len), k, len,
+                    &root, &leaf)) {
+            case HAMT_FAILED:
+                return 0;
+            case HAMT_REMOVED: {
+                struct hamt *r = hamt_version(t, root, t->count - 1);
+                if (!r) {
+                    hamt_node_release(root);
+                }
+                return r;
+            }
+            case HAMT_ABSENT:
+                break;
+        }
+        hamt_retain(t->root);
+    }
+    struct hamt *r = hamt_version(t, t->root, t->count);
+    if (!r) {
+        hamt_node_release(t->root);
+    }
+    return r;
+}
+
+struct hamt *hamt_delete(const struct hamt *t, const char *k) {
+    if (!k) {
+        return 0;
+    }
+    return hamt_delete_len(t, k, strlen(k));
+}
@@ -0,0 +1,57 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "./hash.h"
+
+/*
+ * A persistent hash array mapped trie.
+ *
+ * Each struct hamt is one immutable version of a map.  hamt_set() and
+ * hamt_delete() leave the version they are given alone and return a new one,
+ * which copies only the nodes on the path from the root to the key, one for
+ * every 5 bits of hash at most, and shares everything else with the old
+ * version.  Versions can be kept and destroyed in any order.
+ *
+ * A node has a slot for each of the 32 values of the next 5 bits of the hash,
+ * but only stores the slots in use.  'bitmap' says which those are, and a
+ * slot's position in 'slots' is the number of bits set below its own.
+ * 'leafmap' says which of them hold a key and value, rather than another
+ * node.  Once the hash runs out of bits, keys with equal hashes share a
+ * collision node, which has a 'bitmap' of zero and simply lists them.
+ *
+ * Leaves and nodes are reference counted, and a value is freed along with the
+ * last leaf that holds it.
+ */
+struct hamt_leaf {
+    unsigned int refs;
+    unsigned long hash;
+    void *value;
+    size_t len;
+    char key[];
+};
+
+struct hamt_node {
+    unsigned int refs;
+    unsigned int size;
+    uint32_t bitmap;
+    uint32_t leafmap;
+    void *slots[];
+};
+
+struct hamt {
+    hash_func hash;
+    size_t count;
+    struct hamt_node *root;
+};
+
+struct hamt *hamt_create();
+struct hamt *hamt_create_with_hash(hash_func);
+void hamt_destroy(struct hamt *);
+struct hamt *hamt_set(const struct hamt *, const char *, void *);
+void *hamt_get(const struct hamt *, const char *);
+struct hamt *hamt_delete(const struct hamt *, const char *);
+bool hamt_exists(const struct hamt *, const char *);
+struct hamt *hamt_set_len(const struct hamt *, const void *, size_t, void *);
+void *hamt_get_len(const struct hamt *, const void *, size_t);
+struct hamt *hamt_delete_len(const struct hamt *, const void *, size_t);
+bool hamt_exists_len(const struct hamt *, const void *, size_t);
@@ -1,5 +1,7 @@
 #include <limits.h>
+#include <stdint.h>
 #include <string.h>
+#include "./hash.h"
 
 /*
  * Compute an unsigned long integer hash from a byte array.
@@ -45,3 +47,226 @@ unsigned long hash_shimmy2(const char *bytes) {
     }
     return hash_shimmy2_len(bytes, strlen(bytes));
 }
+
+/*
+ * Read 8 or 4 bytes from 'p' as a little-endian integer, whatever the host
+ * byte order and alignment.
+ */
+static inline uint64_t read64(const unsigned char *p) {
+    return (uint64_t) p[0] | (uint64_t) p[1] << 8 |
+        (uint64_t) p[2] << 16 | (uint64_t) p[3] << 24 |
+        (uint64_t) p[4] << 32 | (uint64_t) p[5] << 40 |
+        (uint64_t) p[6] << 48 | (uint64_t) p[7] << 56;
+}
+
+static inline uint64_t read32(const unsigned char *p) {
+    return (uint64_t) p[0] | (uint64_t) p[1] << 8 |
+        (uint64_t) p[2] << 16 | (uint64_t) p[3] << 24;
+}
+
+static inline uint64_t rotl64(const uint64_t x, const int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/*
+ * Multiply 'a' by 'b' as a 128-bit product, and return the high and low
+ * halves XORed together.
+ */
+static inline uint64_t wymix(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 uint128;
+    uint128 r = (uint128) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+    const uint64_t ha = a >> 32, hb = b >> 32;
+    const uint64_t la = (uint32_t) a, lb = (uint32_t) b;
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const uint64_t t = rl + (rm0 << 32);
+    const uint64_t lo = t + (rm1 << 32);
+    const uint64_t c = (t < rl) + (lo < t);
+    const uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+static const uint64_t WY_SECRET[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull,
+};
+
+/*
+ * Compute an unsigned long integer hash from a byte array, following the
+ * wyhash design.
+ *
+ * Keys of up to 16 bytes are read as at most four overlapping 32-bit words;
+ * longer keys are consumed 16 or 48 bytes at a time, each pair of 64-bit words
+ * folded in with a 128-bit multiply.  A zero 'len' hashes the empty key, and
+ * 'bytes' is not read.
+ */
+unsigned long hash_wy_len(const char *bytes, const size_t len) {
+    const unsigned char *p = (const unsigned char *) bytes;
+    uint64_t seed = wymix(WY_SECRET[0], WY_SECRET[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            const size_t q = (len >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + q);
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - q);
+        } else if (len > 0) {
+            a = (uint64_t) p[0] << 16 | (uint64_t) p[len >> 1] << 8 |
+                p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i >= 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(read64(p) ^ WY_SECRET[1],
+                        read64(p + 8) ^ seed);
+                see1 = wymix(read64(p + 16) ^ WY_SECRET[2],
+                        read64(p + 24) ^ see1);
+                see2 = wymix(read64(p + 32) ^ WY_SECRET[3],
+                        read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(read64(p) ^ WY_SECRET[1], read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    a ^= WY_SECRET[1];
+    b ^= seed;
+    return wymix(wymix(a, b) ^ WY_SECRET[0] ^ len, WY_SECRET[1]);
+}
+
+/*
+ * As for hash_wy_len(), except we consume bytes from 'bytes' until we
+ * encounter a zero byte.  A NULL pointer hashes the same as an empty key.
+ */
+unsigned long hash_wy(const char *bytes) {
+    return hash_wy_len(bytes, bytes ? strlen(bytes) : 0);
+}
+
+#define XX_PRIME1 0x9E3779B185EBCA87ull
+#define XX_PRIME2 0xC2B2AE3D27D4EB4Full
+#define XX_PRIME3 0x165667B19E3779F9ull
+#define XX_PRIME4 0x85EBCA77C2B2AE63ull
+#define XX_PRIME5 0x27D4EB2F165667C5ull
+
+static inline uint64_t xx64_round(uint64_t acc, const uint64_t input) {
+    acc += input * XX_PRIME2;
+    acc = rotl64(acc, 31);
+    return acc * XX_PRIME1;
+}
+
+static inline uint64_t xx64_merge(uint64_t acc, const uint64_t val) {
+    acc ^= xx64_round(0, val);
+    return acc * XX_PRIME1 + XX_PRIME4;
+}
+
+/*
+ * Compute an unsigned long integer hash from a byte array, using XXH64 with a
+ * seed of zero.
+ *
+ * Keys of 32 bytes or more are consumed in 32-byte stripes by four
+ * independent accumulators.  The remainder is folded in 8, 4 and then 1 byte
+ * at a time, and the result is passed through a final avalanche.  A zero
+ * 'len' hashes the empty key, and 'bytes' is not read.
+ */
+unsigned long hash_xx64_len(const char *bytes, const size_t len) {
+    const unsigned char *p = (const unsigned char *) bytes;
+    const unsigned char *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        const unsigned char *limit = end - 32;
+        uint64_t v1 = XX_PRIME1 + XX_PRIME2;
+        uint64_t v2 = XX_PRIME2;
+        uint64_t v3 = 0;
+        uint64_t v4 = -XX_PRIME1;
+        do {
+            v1 = xx64_round(v1, read64(p));
+            v2 = xx64_round(v2, read64(p + 8));
+            v3 = xx64_round(v3, read64(p + 16));
+            v4 = xx64_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xx64_merge(h, v1);
+        h = xx64_merge(h, v2);
+        h = xx64_merge(h, v3);
+        h = xx64_merge(h, v4);
+    } else {
+        h = XX_PRIME5;
+    }
+    h += len;
+
+    while (p + 8 <= end) {
+        h ^= xx64_round(0, read64(p));
+        h = rotl64(h, 27) * XX_PRIME1 + XX_PRIME4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= read32(p) * XX_PRIME1;
+        h = rotl64(h, 23) * XX_PRIME2 + XX_PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= *p * XX_PRIME5;
+        h = rotl64(h, 11) * XX_PRIME1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= XX_PRIME2;
+    h ^= h >> 29;
+    h *= XX_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+/*
+ * As for hash_xx64_len(), except we consume bytes from 'bytes' until we
+ * encounter a zero byte.  A NULL pointer hashes the same as an empty key.
+ */
+unsigned long hash_xx64(const char *bytes) {
+    return hash_xx64_len(bytes, bytes ? strlen(bytes) : 0);
+}
+
+/*
+ * Hash 'n' keys with hash function 'fn', writing the hash of keys[i] to
+ * out[i].
+ *
+ * If 'lens' is not NULL, keys[i] is lens[i] bytes long.  Otherwise each key
+ * is NUL-terminated.  The results are exactly what calling 'fn' on each key
+ * in turn would give.
+ *
+ * Hashing a whole batch before touching any table lets callers issue all of
+ * the table accesses for the batch together, rather than interleaving them
+ * with hashing.
+ */
+void hash_batch(
+        hash_func fn,
+        const char *const *keys,
+        const size_t *lens,
+        const size_t n,
+        unsigned long *out) {
+    if (lens) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = fn(keys[i], lens[i]);
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = fn(keys[i], strlen(keys[i]));
+        }
+    }
+}
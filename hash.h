@@ -1 +1,21 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+
+/*
+ * A function computing a hash from 'len' bytes.
+ */
+typedef unsigned long (*hash_func)(const char *, const size_t);
+
+unsigned long hash_shimmy2_len(const char *, const size_t);
 unsigned long hash_shimmy2(const char *);
+unsigned long hash_wy_len(const char *, const size_t);
+unsigned long hash_wy(const char *);
+unsigned long hash_xx64_len(const char *, const size_t);
+unsigned long hash_xx64(const char *);
+
+void hash_batch(hash_func, const char *const *, const size_t *, const size_t,
+        unsigned long *);
+
+#endif
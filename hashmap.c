@@ -2,56 +2,1034 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
+#include <time.h>
 #include "./hashmap.h"
 #include "./hash.h"
+#include "./intern.h"
+#include "./slab.h"
 
 #define HASHMAP_INIT_SIZE 32
-#define HASHMAP_MAX_SIZE UINT_MAX
+/* The largest power of two an unsigned int can hold. */
+#define HASHMAP_MAX_SIZE (UINT_MAX / 2 + 1)
 #define HASHMAP_SCALE_FACTOR 2
-#define HASHMAP_MAX_LOAD 2
+#define HASHMAP_MAX_LOAD 1.0
+#define HASHMAP_MIN_LOAD 0.125
+/* Number of old buckets moved into the new array by each operation. */
+#define HASHMAP_MIGRATE_STEP 4
+/* Number of keys hashed together by the *_many functions. */
+#define HASHMAP_BATCH 32
+/* Alignment of inline values within their entries. */
+#define HASHMAP_VALUE_ALIGN _Alignof (max_align_t)
 
-struct hashmap *hashmap_create_size(const size_t size) {
-    struct hashmap *m;
-    m = malloc(sizeof *m);
-    m->size = size;
+#ifdef __GNUC__
+#define hashmap_prefetch(p) __builtin_prefetch(p)
+#else
+#define hashmap_prefetch(p) ((void) (p))
+#endif
+
+/*
+ * Add 'n' to counter 'field' of hashmap 'm', and read the clock for timing
+ * resizes, only if the map keeps counters (see struct hashmap_counters).
+ */
+#ifdef HASHMAP_COUNTERS
+#define hashmap_count(m, field, n) ((m)->counters.field += (n))
+#define hashmap_clock() hashmap_now()
+#else
+#define hashmap_count(m, field, n) ((void) (n))
+#define hashmap_clock() 0.0
+#endif
+
+#ifdef HASHMAP_COUNTERS
+static double hashmap_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+#endif
+
+/*
+ * Fill in 'o' with the default sizing policy.
+ */
+void hashmap_options_init(struct hashmap_options *o) {
+    o->hash = hash_shimmy2_len;
+    o->capacity = 0;
+    o->max_load = HASHMAP_MAX_LOAD;
+    o->min_load = HASHMAP_MIN_LOAD;
+    o->growth = HASHMAP_SCALE_FACTOR;
+    o->values = HASHMAP_VALUES_POINTER;
+    o->value_size = 0;
+    o->free_value = free;
+    o->intern = 0;
+}
+
+/*
+ * Return the number of buckets needed to hold 'n' entries without exceeding
+ * 'max_load': the smallest power of two that will do, but no less than
+ * HASHMAP_INIT_SIZE and no more than HASHMAP_MAX_SIZE.
+ */
+static size_t hashmap_size_for(const size_t n, const double max_load) {
+    size_t size = HASHMAP_INIT_SIZE;
+    while (size < HASHMAP_MAX_SIZE && size * max_load < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+/*
+ * Work out the entry counts at which hashmap 'm' should next grow or shrink,
+ * for its current number of buckets.
+ */
+static void hashmap_set_limits(struct hashmap *m) {
+    const double grow = m->size * m->max_load;
+    if (m->size >= HASHMAP_MAX_SIZE || grow >= UINT_MAX) {
+        m->grow_at = UINT_MAX;
+    } else {
+        m->grow_at = (unsigned int) grow;
+    }
+    if (m->size > m->min_size) {
+        m->shrink_at = (unsigned int) (m->size * m->min_load);
+    } else {
+        m->shrink_at = 0;
+    }
+}
+
+/*
+ * Create a hashmap with the sizing policy in 'o', or the default policy if
+ * 'o' is a NULL pointer.
+ *
+ * Return a NULL pointer if the options are invalid, or if the map cannot be
+ * allocated.  'max_load' must be positive, 'growth' at least 2, and shrinking
+ * by 'growth' must leave the map below 'max_load' again, so 'min_load' times
+ * 'growth' must be less than 'max_load'.  Inline values must have a non-zero
+ * 'value_size'.
+ */
+struct hashmap *hashmap_create_with_options(const struct hashmap_options *o) {
+    struct hashmap_options defaults;
+    if (!o) {
+        hashmap_options_init(&defaults);
+        o = &defaults;
+    }
+    if (!(o->max_load > 0) || !(o->min_load >= 0) ||
+            o->growth < 2 || o->growth > HASHMAP_MAX_SIZE) {
+        return 0;
+    }
+    if (o->values > HASHMAP_VALUES_INLINE ||
+            (o->values == HASHMAP_VALUES_INLINE && o->value_size == 0)) {
+        return 0;
+    }
+    unsigned int growth = 2;
+    while (growth < o->growth) {
+        growth <<= 1;
+    }
+    if (o->min_load * growth >= o->max_load) {
+        return 0;
+    }
+
+    struct hashmap *m = malloc(sizeof *m);
+    if (!m) {
+        return 0;
+    }
+    m->hash = o->hash ? o->hash : hash_shimmy2_len;
+    m->size = hashmap_size_for(o->capacity, o->max_load);
     m->count = 0;
-    m->buckets = calloc(size, sizeof (struct hashmap_entry *));
+    m->buckets = calloc(m->size, sizeof (struct hashmap_entry *));
+    m->old_size = 0;
+    m->migrated = 0;
+    m->old_buckets = 0;
+    m->slab = slab_create();
+    if (!m->buckets || !m->slab) {
+        free(m->buckets);
+        slab_destroy(m->slab);
+        free(m);
+        return 0;
+    }
+    m->max_load = o->max_load;
+    m->min_load = o->min_load;
+    m->growth = growth;
+    m->min_size = m->size;
+    hashmap_set_limits(m);
+    m->gen = 0;
+    m->shared_gen = 0;
+    m->shared = false;
+    m->snapshots = 0;
+    m->retired = 0;
+    m->values = o->values;
+    m->value_size = o->values == HASHMAP_VALUES_INLINE ? o->value_size : 0;
+    m->free_value =
+            o->values == HASHMAP_VALUES_POINTER ? o->free_value : 0;
+    m->resizes = 0;
+    m->intern = o->intern;
+    memset(&m->counters, 0, sizeof m->counters);
     return m;
 }
 
-struct hashmap *hashmap_create() {
-    return hashmap_create_size(HASHMAP_INIT_SIZE);
+struct hashmap *hashmap_create() {
+    return hashmap_create_with_options(0);
+}
+
+/*
+ * Create a hashmap that hashes its keys with 'hash' instead of the default
+ * hash_shimmy2_len().  Any of the *_len functions in hash.h will do.
+ *
+ * If 'hash' is a NULL pointer, the default is used.
+ */
+struct hashmap *hashmap_create_with_hash(hash_func hash) {
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.hash = hash;
+    return hashmap_create_with_options(&o);
+}
+
+/*
+ * Return the offset of the inline value in an entry with a key of 'len'
+ * bytes.
+ */
+static inline size_t hashmap_value_offset(const size_t len) {
+    const size_t align = HASHMAP_VALUE_ALIGN;
+    const size_t end = offsetof(struct hashmap_entry, key) + len + 1;
+    return (end + align - 1) & ~(align - 1);
+}
+
+/*
+ * Return the number of bytes needed for an entry of hashmap 'm' with a key of
+ * 'len' bytes.
+ */
+static inline size_t hashmap_entry_size(
+        const struct hashmap *m,
+        const size_t len) {
+    if (m->values == HASHMAP_VALUES_INLINE) {
+        return hashmap_value_offset(len) + m->value_size;
+    }
+    return offsetof(struct hashmap_entry, key) + len + 1;
+}
+
+static void hashmap_entry_destroy(
+        struct hashmap *m,
+        struct hashmap_entry *e) {
+    if (e->value && m->free_value) {
+        m->free_value(e->value);
+    }
+    slab_free(m->slab, e, hashmap_entry_size(m, e->len));
+}
+
+/*
+ * Store the value given as 'v' in entry 'e' of hashmap 'm': the pointer
+ * itself, or for word and inline values, the value it points to.
+ */
+static inline void hashmap_entry_store(
+        const struct hashmap *m,
+        struct hashmap_entry *e,
+        void *v) {
+    switch (m->values) {
+        case HASHMAP_VALUES_POINTER:
+            e->value = v;
+            break;
+        case HASHMAP_VALUES_WORD:
+            e->value = (void *) *(const uintptr_t *) v;
+            break;
+        case HASHMAP_VALUES_INLINE:
+            memcpy(e->value, v, m->value_size);
+            break;
+    }
+}
+
+/*
+ * Copy the value of entry 'e' in hashmap 'm' to 'out', in the form
+ * hashmap_entry_store() takes it.
+ */
+static inline void hashmap_entry_load(
+        const struct hashmap *m,
+        const struct hashmap_entry *e,
+        void *out) {
+    switch (m->values) {
+        case HASHMAP_VALUES_POINTER:
+            *(void **) out = e->value;
+            break;
+        case HASHMAP_VALUES_WORD:
+            *(uintptr_t *) out = (uintptr_t) e->value;
+            break;
+        case HASHMAP_VALUES_INLINE:
+            memcpy(out, e->value, m->value_size);
+            break;
+    }
+}
+
+/*
+ * Return the value of entry 'e' in hashmap 'm', as hashmap_get() would: the
+ * pointer stored, or for word and inline values, a pointer to the value
+ * inside the entry.
+ */
+void *hashmap_entry_value(
+        const struct hashmap *m,
+        const struct hashmap_entry *e) {
+    if (m->values == HASHMAP_VALUES_WORD) {
+        return (void *) &e->value;
+    }
+    return e->value;
+}
+
+/*
+ * An entry or value that hashmap 'm' no longer uses, but that a snapshot
+ * taken before generation 'gen' might still be looking at.
+ */
+struct hashmap_retired {
+    struct hashmap_retired *next;
+    struct hashmap_entry *entry;
+    void *value;
+    unsigned int gen;
+};
+
+/*
+ * Return whether something from generation 'gen' of hashmap 'm' may be
+ * visible to one of its snapshots.
+ */
+static inline bool hashmap_shared(const struct hashmap *m, unsigned int gen) {
+    return gen < m->shared_gen;
+}
+
+/*
+ * Put entry 'e' and value 'v' (either of which may be NULL) aside, to be
+ * freed once every snapshot that might see them has been destroyed.
+ *
+ * Return whether there was memory to keep track of them.
+ */
+static bool hashmap_retire(
+        struct hashmap *m,
+        struct hashmap_entry *e,
+        void *v) {
+    struct hashmap_retired *r = malloc(sizeof *r);
+    if (!r) {
+        return false;
+    }
+    r->entry = e;
+    r->value = v;
+    r->gen = m->gen;
+    r->next = m->retired;
+    m->retired = r;
+    return true;
+}
+
+/*
+ * Free everything on the retired list of hashmap 'm' that no snapshot of
+ * generation 'gen' or later can see.
+ */
+static void hashmap_release(struct hashmap *m, const unsigned int gen) {
+    struct hashmap_retired **link = &m->retired;
+    struct hashmap_retired *r;
+    while ((r = *link)) {
+        if (r->gen > gen) {
+            link = &r->next;
+            continue;
+        }
+        *link = r->next;
+        if (r->value) {
+            m->free_value(r->value);
+        }
+        if (r->entry) {
+            slab_free(m->slab, r->entry,
+                    hashmap_entry_size(m, r->entry->len));
+        }
+        free(r);
+    }
+}
+
+/*
+ * Return a copy of entry 'e' of hashmap 'm', allocated from its slab as part
+ * of the current generation, with its 'next' link cleared.
+ */
+static struct hashmap_entry *hashmap_entry_clone(
+        struct hashmap *m,
+        const struct hashmap_entry *e) {
+    const size_t size = hashmap_entry_size(m, e->len);
+    struct hashmap_entry *c = slab_alloc(m->slab, size);
+    if (c) {
+        memcpy(c, e, size);
+        c->next = 0;
+        c->gen = m->gen;
+        if (m->values == HASHMAP_VALUES_INLINE) {
+            c->value = (char *) c + hashmap_value_offset(c->len);
+        }
+    }
+    return c;
+}
+
+/*
+ * Make sure the entry at '*link' in hashmap 'm' is not shared with any
+ * snapshot, replacing it with a copy of its own if it is.
+ *
+ * Return the entry now at '*link', or a NULL pointer if the copy could not be
+ * made.
+ */
+static struct hashmap_entry *hashmap_entry_own(
+        struct hashmap *m,
+        struct hashmap_entry **link) {
+    struct hashmap_entry *e = *link;
+    if (!hashmap_shared(m, e->gen)) {
+        return e;
+    }
+    struct hashmap_entry *c = hashmap_entry_clone(m, e);
+    if (!c) {
+        return 0;
+    }
+    if (!hashmap_retire(m, e, 0)) {
+        slab_free(m->slab, c, hashmap_entry_size(m, c->len));
+        return 0;
+    }
+    c->next = e->next;
+    *link = c;
+    return c;
+}
+
+/*
+ * Make sure none of the entries in the chain at '*link' in hashmap 'm' are
+ * shared with a snapshot, up to but not including 'stop', or to the end of the
+ * chain if 'stop' is a NULL pointer.  Shared entries are copied, and the
+ * copies linked in where they were, so the chain stays whole even if this
+ * fails part way through.
+ *
+ * Return the link that points to 'stop', or a NULL pointer on failure.
+ */
+static struct hashmap_entry **hashmap_chain_own(
+        struct hashmap *m,
+        struct hashmap_entry **link,
+        const struct hashmap_entry *stop) {
+    struct hashmap_entry *e;
+    while (*link != stop) {
+        if (!(e = hashmap_entry_own(m, link))) {
+            return 0;
+        }
+        link = &e->next;
+    }
+    return link;
+}
+
+/*
+ * Make sure the bucket array of hashmap 'm' is its own to write to, taking a
+ * copy if a snapshot still has it.
+ *
+ * Return whether the copy could be made.
+ */
+static bool hashmap_buckets_own(struct hashmap *m) {
+    if (!m->shared) {
+        return true;
+    }
+    struct hashmap_entry **buckets = malloc(m->size * sizeof *buckets);
+    if (!buckets) {
+        return false;
+    }
+    memcpy(buckets, m->buckets, m->size * sizeof *buckets);
+    m->buckets = buckets;
+    m->shared = false;
+    return true;
+}
+
+/*
+ * Free the values held in 'buckets' of hashmap 'm', and the bucket array
+ * itself.
+ *
+ * Entry memory is left to be released in bulk with the slab, apart from any
+ * entries too large for the slab, which must be freed one at a time.
+ */
+static void hashmap_buckets_destroy(
+        const struct hashmap *m,
+        struct hashmap_entry **buckets,
+        const size_t size) {
+    struct hashmap_entry *curr, *next;
+    for (size_t i = 0; i < size; i++) {
+        curr = buckets[i];
+        while (curr) {
+            next = curr->next;
+            if (curr->value && m->free_value) {
+                m->free_value(curr->value);
+            }
+            if (hashmap_entry_size(m, curr->len) > SLAB_MAX_SIZE) {
+                free(curr);
+            }
+            curr = next;
+        }
+    }
+    free(buckets);
+}
+
+void hashmap_destroy(struct hashmap *m) {
+    while (m->snapshots) {
+        hashmap_snapshot_destroy(m->snapshots);
+    }
+    if (m->old_buckets) {
+        hashmap_buckets_destroy(m, m->old_buckets, m->old_size);
+    }
+    hashmap_buckets_destroy(m, m->buckets, m->size);
+    slab_destroy(m->slab);
+    free(m);
+}
+
+static inline unsigned long hash_bytes(
+        const struct hashmap *m,
+        const char *key,
+        const size_t len) {
+    return m->hash(key, len);
+}
+
+/*
+ * A key as hashmap 'm' stores it, with its hash.
+ *
+ * For a map with interned keys, the bytes stored are those of the handle
+ * itself, 'handle', and the hash is the one kept with the interned string, so
+ * keys are compared by pointer, and never hashed again.
+ */
+struct hashmap_key {
+    const char *k;
+    size_t len;
+    unsigned long hash;
+    const char *handle;
+};
+
+/*
+ * Set up 'key' for interned string 'h'.
+ */
+static inline void hashmap_key_interned(
+        struct hashmap_key *key,
+        const char *h) {
+    key->handle = h;
+    key->k = (const char *) &key->handle;
+    key->len = sizeof key->handle;
+    key->hash = intern_hash(h);
+}
+
+/*
+ * Set up 'key' for the 'len' byte key 'k' in hashmap 'm'.  For a map with
+ * interned keys, the string is looked up in the map's intern table, and
+ * added to it if 'add' is set.
+ *
+ * Return false if the key is not interned, and could not be or was not to be
+ * added, in which case the map cannot hold it.
+ */
+static inline bool hashmap_key_init(
+        const struct hashmap *m,
+        const char *k,
+        const size_t len,
+        const bool add,
+        struct hashmap_key *key) {
+    if (!m->intern) {
+        key->k = k;
+        key->len = len;
+        key->hash = hash_bytes(m, k, len);
+        return true;
+    }
+    const char *h = add ?
+        intern_add_len(m->intern, k, len) : intern_find_len(m->intern, k, len);
+    if (!h) {
+        return false;
+    }
+    hashmap_key_interned(key, h);
+    return true;
+}
+
+/*
+ * Return the key of entry 'e' in hashmap 'm', and set 'len' to its length.
+ * For a map with interned keys, this is the interned string.
+ */
+const char *hashmap_entry_key(
+        const struct hashmap *m,
+        const struct hashmap_entry *e,
+        size_t *len) {
+    if (m->intern) {
+        const char *h;
+        memcpy(&h, e->key, sizeof h);
+        *len = intern_len(h);
+        return h;
+    }
+    *len = e->len;
+    return e->key;
+}
+
+/*
+ * Return the index for 'hash' in an array of 'size' buckets, where 'size' is a
+ * power of two, so a mask does the job of a division.
+ */
+static inline size_t hash_index(const unsigned long hash, const size_t size) {
+    return hash & (size - 1);
+}
+
+/*
+ * Return the bucket that holds (or would hold) keys with hash 'hash' in
+ * hashmap 'm'.
+ *
+ * While a resize is in progress, keys whose old bucket has not been migrated
+ * yet are still found in the old bucket array.
+ */
+static struct hashmap_entry **hashmap_bucket(
+        const struct hashmap *m,
+        const unsigned long hash) {
+    if (m->old_buckets) {
+        size_t i = hash_index(hash, m->old_size);
+        if (i >= m->migrated) {
+            return &m->old_buckets[i];
+        }
+    }
+    return &m->buckets[hash_index(hash, m->size)];
+}
+
+/*
+ * Move up to 'steps' buckets from the old bucket array into the new one.
+ *
+ * Entries are relinked into their new buckets using their cached hashes, so
+ * nothing is allocated, copied or rehashed along the way, unless a snapshot
+ * can still see them, in which case they are copied first.  Once the
+ * last old bucket has been moved, the old array is released and the resize is
+ * complete.
+ */
+static void hashmap_migrate(struct hashmap *m, unsigned int steps) {
+    struct hashmap_entry *e, *next;
+    size_t i;
+    if (!m->old_buckets) {
+        return;
+    }
+    const double start = hashmap_clock();
+    while (m->old_buckets && steps--) {
+        if (m->shared_gen &&
+                !hashmap_chain_own(m, &m->old_buckets[m->migrated], 0)) {
+            break;
+        }
+        e = m->old_buckets[m->migrated];
+        m->old_buckets[m->migrated] = 0;
+        while (e) {
+            next = e->next;
+            i = hash_index(e->hash, m->size);
+            e->next = m->buckets[i];
+            m->buckets[i] = e;
+            e = next;
+        }
+        if (++m->migrated == m->old_size) {
+            free(m->old_buckets);
+            m->old_buckets = 0;
+            m->old_size = 0;
+            m->migrated = 0;
+        }
+    }
+    hashmap_count(m, resize_seconds, hashmap_clock() - start);
+}
+
+/*
+ * Begin resizing hashmap 'm' to 'size' buckets, which may be more or fewer
+ * than it has now.
+ *
+ * The new bucket array replaces the current one straight away, and the
+ * current one becomes the old array, to be drained a few buckets at a time by
+ * subsequent operations.  Any resize already in progress is finished first.
+ *
+ * Return whether the new bucket array could be allocated.
+ */
+static bool hashmap_resize(struct hashmap *m, const size_t size) {
+    hashmap_migrate(m, UINT_MAX);
+    if (m->old_buckets || !hashmap_buckets_own(m)) {
+        return false;
+    }
+    const double start = hashmap_clock();
+    struct hashmap_entry **buckets;
+    buckets = calloc(size, sizeof (struct hashmap_entry *));
+    if (!buckets) {
+        return false;
+    }
+    m->old_buckets = m->buckets;
+    m->old_size = m->size;
+    m->migrated = 0;
+    m->buckets = buckets;
+    m->size = size;
+    hashmap_set_limits(m);
+    m->resizes++;
+    hashmap_count(m, resize_seconds, hashmap_clock() - start);
+    return true;
+}
+
+/*
+ * Grow hashmap 'm' if need be so it can hold 'n' entries without growing
+ * again, and move every entry into place straight away.
+ *
+ * Return whether the map could be resized.
+ */
+static bool hashmap_presize(struct hashmap *m, const size_t n) {
+    const size_t size = hashmap_size_for(n, m->max_load);
+    if (size > m->size && !hashmap_resize(m, size)) {
+        return false;
+    }
+    hashmap_migrate(m, UINT_MAX);
+    return true;
+}
+
+/*
+ * Resize hashmap 'm' so it can hold 'n' entries without growing, and move
+ * every entry into place straight away, ready for a bulk load.
+ *
+ * The map will not shrink below that size afterwards.  A map that is already
+ * large enough is left alone.
+ *
+ * Return whether the map could be resized.
+ */
+bool hashmap_reserve(struct hashmap *m, size_t n) {
+    if (!m || !hashmap_presize(m, n)) {
+        return false;
+    }
+    const size_t size = hashmap_size_for(n, m->max_load);
+    if (size > m->min_size) {
+        m->min_size = size;
+        hashmap_set_limits(m);
+    }
+    return true;
+}
+
+/*
+ * Return whether entry 'e' holds the 'len' byte key 'k' with hash 'hash'.
+ *
+ * The cached hash and length are compared first, so memcmp() only runs on
+ * entries that are very likely to match.
+ */
+static inline bool hashmap_entry_match(
+        const struct hashmap_entry *e,
+        const unsigned long hash,
+        const char *k,
+        const size_t len) {
+    return e->hash == hash && e->len == len && memcmp(e->key, k, len) == 0;
+}
+
+/*
+ * Search the given list of entries for a key matching 'k' with hash 'hash'.
+ *
+ * Return a pointer to the matching entry, if found, or NULL otherwise.
+ */
+static struct hashmap_entry *hashmap_find(
+        struct hashmap_entry *e,
+        const unsigned long hash,
+        const char *k,
+        const size_t len) {
+    while (e) {
+        if (hashmap_entry_match(e, hash, k, len)) {
+            return e;
+        }
+        e = e->next;
+    }
+    return 0;
+}
+
+/*
+ * As for hashmap_find(), for a lookup on behalf of hashmap_get() and friends,
+ * counting the lookup and the entries it compares if hashmap 'm' keeps
+ * counters.
+ */
+static inline struct hashmap_entry *hashmap_lookup(
+        struct hashmap *m,
+        struct hashmap_entry *e,
+        const unsigned long hash,
+        const char *k,
+        const size_t len) {
+#ifdef HASHMAP_COUNTERS
+    unsigned long probes = 0;
+    while (e) {
+        probes++;
+        if (hashmap_entry_match(e, hash, k, len)) {
+            break;
+        }
+        e = e->next;
+    }
+    m->counters.lookups++;
+    if (e) {
+        m->counters.hits++;
+        m->counters.hit_probes += probes;
+    } else {
+        m->counters.miss_probes += probes;
+    }
+    return e;
+#else
+    (void) m;
+    return hashmap_find(e, hash, k, len);
+#endif
+}
+
+/*
+ * Return whether the 'len' byte key 'k' exists in hashmap 'm'.
+ */
+bool hashmap_exists_len(const struct hashmap *m, const void *k, size_t len) {
+    struct hashmap_key key;
+    if (!hashmap_key_init(m, k, len, false, &key)) {
+        return false;
+    }
+    return hashmap_find(*hashmap_bucket(m, key.hash), key.hash, key.k,
+            key.len) != 0;
+}
+
+bool hashmap_exists(const struct hashmap *m, const char *k) {
+    if (!k) {
+        return false;
+    }
+    return hashmap_exists_len(m, k, strlen(k));
+}
+
+/*
+ * Create a new entry for hashmap 'm' with the given key, and an empty value:
+ * a NULL pointer, a zero word, or inline bytes all set to zero.
+ *
+ * Return a NULL pointer if the entry cannot be created.
+ */
+static struct hashmap_entry *hashmap_entry_create(
+        struct hashmap *m,
+        const unsigned long hash,
+        const char *k,
+        const size_t len) {
+    struct hashmap_entry *e = slab_alloc(m->slab, hashmap_entry_size(m, len));
+    if (!e) {
+        return 0;
+    }
+
+    memcpy(e->key, k, len);
+    e->key[len] = '\0';
+    e->len = len;
+    e->hash = hash;
+    if (m->values == HASHMAP_VALUES_INLINE) {
+        e->value = (char *) e + hashmap_value_offset(len);
+        memset(e->value, 0, m->value_size);
+    } else {
+        e->value = 0;
+    }
+    e->next = 0;
+    return e;
+}
+
+/*
+ * Find the entry for the 'len' byte key 'k', whose hash has already been
+ * computed as 'hash', in hashmap 'm', creating it with an empty value if it
+ * does not exist, and set 'created' to say which.
+ *
+ * The entry returned is the map's own to write to: if a snapshot can see an
+ * existing entry, it is replaced with a copy first.  A new entry is pushed
+ * onto the front of its bucket's chain, so that the entries already in the
+ * chain, which a snapshot may share, are left as they are.
+ *
+ * Return a NULL pointer if the entry could not be created or copied.
+ */
+static struct hashmap_entry *hashmap_upsert(
+        struct hashmap *m,
+        const unsigned long hash,
+        const char *k,
+        const size_t len,
+        bool *created) {
+    hashmap_migrate(m, HASHMAP_MIGRATE_STEP);
+    if (!hashmap_buckets_own(m)) {
+        return 0;
+    }
+    struct hashmap_entry **bucket = hashmap_bucket(m, hash);
+    struct hashmap_entry *e = hashmap_find(*bucket, hash, k, len);
+    if (e) {
+        if (hashmap_shared(m, e->gen)) {
+            struct hashmap_entry **link = hashmap_chain_own(m, bucket, e);
+            if (!link || !(e = hashmap_entry_own(m, link))) {
+                return 0;
+            }
+        }
+        *created = false;
+        hashmap_count(m, updates, 1);
+        return e;
+    }
+
+    if (!(e = hashmap_entry_create(m, hash, k, len))) {
+        return 0;
+    }
+    e->gen = m->gen;
+    e->value_gen = m->gen;
+    e->next = *bucket;
+    *bucket = e;
+    m->count++;
+    *created = true;
+    hashmap_count(m, inserts, 1);
+
+    /*
+     * Did adding this entry take the load factor over the maximum?  If so,
+     * then start a resize.  Rather than moving every entry now, each later
+     * operation moves a few buckets, so no single call pays for the whole
+     * rehash.  grow_at is UINT_MAX once there is no more room to expand.
+     */
+    if (m->count > m->grow_at) {
+        size_t size = (size_t) m->size * m->growth;
+        hashmap_resize(m, size < HASHMAP_MAX_SIZE ? size : HASHMAP_MAX_SIZE);
+    }
+    return e;
+}
+
+/*
+ * Set the 'len' byte key 'k', whose hash has already been computed as 'hash',
+ * to value 'v' in hashmap 'm'.
+ */
+static bool hashmap_set_hashed(
+        struct hashmap *m,
+        const unsigned long hash,
+        const char *k,
+        const size_t len,
+        void *v) {
+    bool created;
+    struct hashmap_entry *e;
+    if (!k || !v || !(e = hashmap_upsert(m, hash, k, len, &created))) {
+        return false;
+    }
+    hashmap_entry_store(m, e, v);
+    e->value_gen = m->gen;
+    return true;
+}
+
+/*
+ * Set the 'len' byte key 'k' to value 'v' in hashmap 'm'.
+ *
+ * The key may contain any bytes, including NULs.  If an entry for the given
+ * key already exists, it takes the new value.  Otherwise, a new entry is
+ * created.
+ *
+ * For a map of pointer values, 'v' is stored as it is, and handed to the
+ * map's 'free_value' function (by default free()) when the map is destroyed,
+ * or the entry deleted.  A value that is replaced is not freed.  For word and
+ * inline values, the value is copied from the memory 'v' points to.  'v' may
+ * not be NULL.
+ *
+ * Return whether the entry was created successfully.
+ */
+bool hashmap_set_len(struct hashmap *m, const void *k, size_t len, void *v) {
+    struct hashmap_key key;
+    if (!k || !hashmap_key_init(m, k, len, true, &key)) {
+        return false;
+    }
+    return hashmap_set_hashed(m, key.hash, key.k, key.len, v);
+}
+
+/*
+ * Set NUL-terminated key 'k' to value 'v' in hashmap 'm'.
+ *
+ * As for hashmap_set_len(), with the length of 'k' taken from strlen().
+ */
+bool hashmap_set(struct hashmap *m, const char *k, void *v) {
+    if (!k) {
+        return false;
+    }
+    return hashmap_set_len(m, k, strlen(k), v);
 }
 
-static void hashmap_entry_destroy(struct hashmap_entry *e, bool keep_value) {
-    if (e->key) {
-        free(e->key);
+/*
+ * Find the 'len' byte key 'k' in hashmap 'm', adding it with an empty value
+ * if it is not there yet, and return a pointer to where its value is kept,
+ * hashing the key and searching its chain only once.
+ *
+ * For a map of pointer values, this is a pointer to the entry's value
+ * pointer, starting out NULL, which the caller fills in with alloc'd memory
+ * as for hashmap_set().  For word values, it points to the uintptr_t, and
+ * for inline values, to the value itself, starting out as zero.  The pointer
+ * stays valid until the key is next set or deleted.
+ *
+ * If 'created' is not NULL, it is set to whether the key was added.
+ *
+ * Return a NULL pointer if a new entry cannot be created.
+ */
+void *hashmap_get_or_insert_len(
+        struct hashmap *m,
+        const void *k,
+        size_t len,
+        bool *created) {
+    bool c;
+    struct hashmap_key key;
+    struct hashmap_entry *e;
+    if (!m || !k || !hashmap_key_init(m, k, len, true, &key) ||
+            !(e = hashmap_upsert(m, key.hash, key.k, key.len, &c))) {
+        return 0;
     }
-    if (e->value && !keep_value) {
-        free(e->value);
+    if (created) {
+        *created = c;
     }
-    free(e);
+    /*
+     * A value written through the pointer keeps the entry's 'value_gen', so
+     * if a snapshot might still see the old value, a new one is treated as
+     * shared too, and only freed once the snapshot is gone.
+     */
+    return m->values == HASHMAP_VALUES_INLINE ? e->value : &e->value;
 }
 
-static void hashmap_buckets_destroy(struct hashmap_entry **buckets, const size_t size, bool keep_values) {
-    struct hashmap_entry *curr, *next;
-    for (size_t i = 0; i < size; i++) {
-        if (buckets[i]) {
-            curr = buckets[i];
-            while (curr) {
-                next = curr->next;
-                hashmap_entry_destroy(curr, keep_values);
-                curr = next;
-            }
-            buckets[i] = 0;
-        }
+/*
+ * As for hashmap_get_or_insert_len(), with the length of NUL-terminated key
+ * 'k' taken from strlen().
+ */
+void *hashmap_get_or_insert(struct hashmap *m, const char *k, bool *created) {
+    if (!k) {
+        return 0;
     }
-    free(buckets);
+    return hashmap_get_or_insert_len(m, k, strlen(k), created);
 }
 
-void hashmap_destroy(struct hashmap *m) {
-    hashmap_buckets_destroy(m->buckets, m->size, false);
-    free(m);
+/*
+ * Give the empty hashmap 'm' a fresh array of 'size' buckets, dropping any
+ * resize still in progress, since there are no entries left to move.
+ *
+ * Return whether the new array could be allocated.
+ */
+static bool hashmap_rebucket_empty(struct hashmap *m, const size_t size) {
+    if (m->size == size && !m->old_buckets && !m->shared) {
+        return true;
+    }
+    struct hashmap_entry **buckets = calloc(size, sizeof *buckets);
+    if (!buckets) {
+        return false;
+    }
+    free(m->old_buckets);
+    m->old_buckets = 0;
+    m->old_size = 0;
+    m->migrated = 0;
+    if (!m->shared) {
+        free(m->buckets);
+    }
+    m->shared = false;
+    m->buckets = buckets;
+    m->size = size;
+    hashmap_set_limits(m);
+    return true;
+}
+
+/*
+ * Copy every entry of 'src' into the empty hashmap 'dst', which must use the
+ * same hash function and have at least as many buckets.
+ *
+ * Every key in 'src' is distinct, so entries are linked straight in at their
+ * cached hashes without searching for existing keys.  When both maps have the
+ * same number of buckets, each chain lands in the same bucket it came from,
+ * in the same order.
+ *
+ * Return whether every entry was copied.
+ */
+static bool hashmap_copy_into_empty(
+        struct hashmap *dst,
+        const struct hashmap *src) {
+    struct hashmap_entry *e, *c, **tail;
+    if (dst->size == src->size) {
+        for (size_t i = 0; i < src->size; i++) {
+            tail = &dst->buckets[i];
+            for (e = src->buckets[i]; e; e = e->next) {
+                if (!(c = hashmap_entry_clone(dst, e))) {
+                    return false;
+                }
+                c->value_gen = dst->gen;
+                *tail = c;
+                tail = &c->next;
+                dst->count++;
+            }
+        }
+        return true;
+    }
+    for (size_t i = 0; i < src->size; i++) {
+        for (e = src->buckets[i]; e; e = e->next) {
+            if (!(c = hashmap_entry_clone(dst, e))) {
+                return false;
+            }
+            c->value_gen = dst->gen;
+            tail = &dst->buckets[hash_index(c->hash, dst->size)];
+            c->next = *tail;
+            *tail = c;
+            dst->count++;
+        }
+    }
+    return true;
 }
 
 /*
@@ -60,249 +1038,605 @@ void hashmap_destroy(struct hashmap *m) {
  * Afterwards all the keys present in 'src' will be present in 'dst' with the
  * same values as in 'src'.  Any keys already present in 'dst' that are absent
  * in 'src' will be unaffected.
+ *
+ * 'dst' is sized once up front for everything it might end up holding, and
+ * if both maps use the same hash function (or the same intern table), the
+ * hashes cached in the entries of 'src' are reused rather than computed
+ * again.  If 'dst' is empty as well, entries are copied wholesale, chain by
+ * chain, with no lookups at all.
  */
 void hashmap_copy(struct hashmap *dst, struct hashmap *src) {
     if (!src || !dst) {
         return;
     }
+    hashmap_migrate(src, UINT_MAX);
+    const bool same_hash = dst->intern == src->intern &&
+        (dst->intern || dst->hash == src->hash);
+    if (dst->count == 0 && same_hash && dst->values == src->values &&
+            dst->value_size == src->value_size) {
+        size_t size = hashmap_size_for(src->count, dst->max_load);
+        if (size < src->size) {
+            size = src->size;
+        }
+        if (size < dst->size) {
+            size = dst->size;
+        }
+        if (hashmap_rebucket_empty(dst, size) &&
+                hashmap_copy_into_empty(dst, src)) {
+            return;
+        }
+    }
 
+    hashmap_presize(dst, (size_t) dst->count + src->count);
     struct hashmap_entry *e;
-    for (unsigned int i = 0; i < src->size; i++) {
-        e = src->buckets[i];
-        while (e) {
-            hashmap_set(dst, e->key, e->value);
-            e = e->next;
+    const char *k;
+    size_t len;
+    for (size_t i = 0; i < src->size; i++) {
+        for (e = src->buckets[i]; e; e = e->next) {
+            if (same_hash) {
+                hashmap_set_hashed(dst, e->hash, e->key, e->len,
+                        hashmap_entry_value(src, e));
+            } else {
+                k = hashmap_entry_key(src, e, &len);
+                hashmap_set_len(dst, k, len, hashmap_entry_value(src, e));
+            }
         }
     }
 }
 
-static inline unsigned long hash_bytes(const char *key) {
-    return hash_shimmy2(key);
+/*
+ * Return the value for the 'len' byte key 'k' in hashmap 'm', or for word and
+ * inline values, a pointer to it.
+ *
+ * If the key does not exist in the map, return a NULL pointer.
+ */
+void *hashmap_get_len(struct hashmap *m, const void *k, size_t len) {
+    hashmap_migrate(m, HASHMAP_MIGRATE_STEP);
+    struct hashmap_key key;
+    if (!hashmap_key_init(m, k, len, false, &key)) {
+        return 0;
+    }
+    struct hashmap_entry *e = hashmap_lookup(
+            m, *hashmap_bucket(m, key.hash), key.hash, key.k, key.len);
+    if (e) {
+        return hashmap_entry_value(m, e);
+    }
+    return 0;
 }
 
-static inline size_t hash_index(const char *key, const size_t size) {
-    return hash_bytes(key) % size;
+/*
+ * Return the value for NUL-terminated key 'k' in hashmap 'm'.
+ *
+ * If the key does not exist in the map, return a NULL pointer.
+ */
+void *hashmap_get(struct hashmap *m, const char *k) {
+    if (!k) {
+        return 0;
+    }
+    return hashmap_get_len(m, k, strlen(k));
 }
 
 /*
- * Search the given list of entries for a key matching 'k'.
+ * Remove the entry for the 'len' byte key 'k' with hash 'hash' from hashmap
+ * 'm'.  If 'out' is a NULL pointer, free its value, and otherwise copy the
+ * value to 'out' as hashmap_take_len() does.
  *
- * Return a pointer to the matching entry, if found, or NULL otherwise.
+ * Return whether the key was removed.
  */
-static struct hashmap_entry *hashmap_find(struct hashmap_entry *e, const char *k) {
-    while (e) {
-        if (strcmp(e->key, k) == 0) {
-            return e;
+static bool hashmap_remove(
+        struct hashmap *m,
+        const unsigned long hash,
+        const char *k,
+        const size_t len,
+        void *out) {
+    hashmap_migrate(m, HASHMAP_MIGRATE_STEP);
+    struct hashmap_entry **bucket = hashmap_bucket(m, hash);
+    struct hashmap_entry *e = hashmap_find(*bucket, hash, k, len);
+    if (!e || !hashmap_buckets_own(m)) {
+        return false;
+    }
+    bucket = hashmap_bucket(m, hash);
+
+    /*
+     * Copy any shared entries ahead of this one, so it can be unlinked.  If a
+     * snapshot can still see the entry or its value, put them aside rather
+     * than freeing them.
+     */
+    const bool entry_shared = hashmap_shared(m, e->gen);
+    const bool value_shared = m->free_value &&
+            (entry_shared || hashmap_shared(m, e->value_gen));
+    if (out && value_shared) {
+        return false;
+    }
+    struct hashmap_entry **link = hashmap_chain_own(m, bucket, e);
+    if (!link || ((entry_shared || value_shared) && !hashmap_retire(m,
+                    entry_shared ? e : 0, value_shared ? e->value : 0))) {
+        return false;
+    }
+    if (out) {
+        hashmap_entry_load(m, e, out);
+    }
+    *link = e->next;
+    if (!entry_shared) {
+        if (value_shared || out) {
+            e->value = 0;
         }
-        e = e->next;
+        hashmap_entry_destroy(m, e);
     }
-    return 0;
+    m->count--;
+    hashmap_count(m, deletes, 1);
+
+    /* Shrink once the load falls below the minimum. */
+    if (m->count < m->shrink_at) {
+        size_t size = m->size / m->growth;
+        hashmap_resize(m, size > m->min_size ? size : m->min_size);
+    }
+    return true;
 }
 
-bool hashmap_exists(const struct hashmap *m, const char *k) {
-    size_t i = hash_index(k, m->size);
-    struct hashmap_entry *e = m->buckets[i];
-    while (e) {
-        if (strcmp(e->key, k) == 0) {
-            return true;
-        }
-        e = e->next;
+/*
+ * Delete the entry for the 'len' byte key 'k' from hashmap 'm'.
+ *
+ * If the key exists in the map, delete its entry and return true.  Otherwise,
+ * do nothing and return false.
+ */
+bool hashmap_delete_len(struct hashmap *m, const void *k, size_t len) {
+    struct hashmap_key key;
+    if (!m || !k || !hashmap_key_init(m, k, len, false, &key)) {
+        return false;
     }
-    return false;
+    return hashmap_remove(m, key.hash, key.k, key.len, 0);
 }
 
 /*
- * Create a new hashmap entry with the given key and value.
+ * Remove the entry for the 'len' byte key 'k' from hashmap 'm', handing its
+ * value to the caller instead of freeing it, in a single lookup.
  *
- * Return a NULL pointer if the entry cannot be created.
+ * The value is copied to 'out' in the same form hashmap_set() takes it: for
+ * a map of pointer values, 'out' points to a void pointer that receives the
+ * value, and for word and inline values, to memory for the value itself.
+ *
+ * A pointer value that a snapshot of the map can still see is not the map's
+ * to hand over, so while such a snapshot is open, the key is left alone.
+ *
+ * Return whether the key was removed.  If it was not, 'out' is unchanged.
  */
-static struct hashmap_entry *hashmap_entry_create(const char *k, void *v) {
-    if (!v) {
-        return 0;
+bool hashmap_take_len(
+        struct hashmap *m,
+        const void *k,
+        size_t len,
+        void *out) {
+    struct hashmap_key key;
+    if (!m || !k || !out || !hashmap_key_init(m, k, len, false, &key)) {
+        return false;
     }
-    struct hashmap_entry *e = malloc(sizeof *e);
-    if (!e) {
-        return 0;
+    return hashmap_remove(m, key.hash, key.k, key.len, out);
+}
+
+/*
+ * As for hashmap_take_len(), with the length of NUL-terminated key 'k' taken
+ * from strlen().
+ */
+bool hashmap_take(struct hashmap *m, const char *k, void *out) {
+    if (!m || !k) {
+        return false;
     }
+    return hashmap_take_len(m, k, strlen(k), out);
+}
 
-    e->key = malloc(strlen(k) + 1);
-    if (!e->key) {
-        return 0;
+/*
+ * Delete the entry for NUL-terminated key 'k' from hashmap 'm'.
+ *
+ * As for hashmap_delete_len(), with the length of 'k' taken from strlen().
+ */
+bool hashmap_delete(struct hashmap *m, const char *k) {
+    if (!m || !k) {
+        return false;
     }
-    strcpy(e->key, k);
-    e->value = v;
-    e->next = 0;
-    return e;
+    return hashmap_delete_len(m, k, strlen(k));
+}
+
+/*
+ * Return the lengths of the 'n' keys in 'k': 'lens' itself if the caller
+ * supplied it, or else 'buf' filled in from strlen().
+ */
+static const size_t *hashmap_batch_lens(
+        const char *const *k,
+        const size_t *lens,
+        const size_t n,
+        size_t *buf) {
+    if (lens) {
+        return lens;
+    }
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = strlen(k[i]);
+    }
+    return buf;
 }
 
 /*
- * Set key 'k' to value 'v' in list of entries 'e'.
+ * Set keys[i] to values[i] in hashmap 'm', for each of the 'n' keys.
+ *
+ * If 'lens' is not NULL, keys[i] is lens[i] bytes long.  Otherwise each key
+ * is NUL-terminated.  The keys are hashed a batch at a time with
+ * hash_batch(), unless the map's keys are interned, in which case each key
+ * is interned in turn instead.
  *
- * If an entry for the given key already exists in the list, it takes the new
- * value, and the data pointed to by the old value is freed.  Otherwise, a new
- * entry is appended to the list.
+ * Return the number of keys that were set successfully.
+ */
+size_t hashmap_set_many_len(
+        struct hashmap *m,
+        const void *const *keys,
+        const size_t *lens,
+        void *const *values,
+        size_t n) {
+    const char *const *k = (const char *const *) keys;
+    unsigned long hashes[HASHMAP_BATCH];
+    size_t buf[HASHMAP_BATCH];
+    const size_t *len;
+    size_t done = 0;
+    for (size_t i = 0; i < n; i += HASHMAP_BATCH) {
+        const size_t batch = n - i < HASHMAP_BATCH ? n - i : HASHMAP_BATCH;
+        len = hashmap_batch_lens(&k[i], lens ? &lens[i] : 0, batch, buf);
+        if (m->intern) {
+            for (size_t j = 0; j < batch; j++) {
+                done += hashmap_set_len(m, k[i + j], len[j], values[i + j]);
+            }
+            continue;
+        }
+        hash_batch(m->hash, &k[i], len, batch, hashes);
+        for (size_t j = 0; j < batch; j++) {
+            done += hashmap_set_hashed(
+                    m, hashes[j], k[i + j], len[j], values[i + j]);
+        }
+    }
+    return done;
+}
+
+/*
+ * As for hashmap_set_many_len(), for 'n' NUL-terminated keys.
+ */
+size_t hashmap_set_many(
+        struct hashmap *m,
+        const char *const *keys,
+        void *const *values,
+        size_t n) {
+    return hashmap_set_many_len(m, (const void *const *) keys, 0, values, n);
+}
+
+/*
+ * Look up each of the 'n' keys in hashmap 'm', writing the value for keys[i]
+ * to out[i], or a NULL pointer if keys[i] is not in the map.
  *
- * 'v' must point to alloc'd memory.  When the list of entry is destroyed, the
- * data pointed to by 'v' is freed also.
+ * If 'lens' is not NULL, keys[i] is lens[i] bytes long.  Otherwise each key
+ * is NUL-terminated.
  *
- * Return the first element of the resulting list, or a NULL pointer if the
- * operation fails.
+ * The keys are looked up a batch at a time, in stages: hash every key in the
+ * batch, prefetch every bucket slot, load the slots and prefetch the head
+ * entry of every chain, prefetch the second entry wherever the head is not a
+ * match, and only then walk the chains.  Each key's lookup is a chain of
+ * dependent loads, but the keys in a batch are independent of one another, so
+ * their cache misses overlap instead of being taken one after the other.  On
+ * maps much larger than the cache, this is two to three times faster than
+ * calling hashmap_get() in a loop (see bench/bench_get_many.c).
  *
- * If a valid pointer is passed in for 'created', it will be set to indicate
- * whether a new entry was created.
+ * For a map with interned keys, the keys are simply looked up in turn.
  */
-static struct hashmap_entry *hashmap_set_entry(
-        struct hashmap_entry *e,
-        const char *k,
-        void *v,
-        bool *created) {
-    if (created) {
-        *created = false;
+void hashmap_get_many_len(
+        struct hashmap *m,
+        const void *const *keys,
+        const size_t *lens,
+        size_t n,
+        void **out) {
+    const char *const *k = (const char *const *) keys;
+    unsigned long hashes[HASHMAP_BATCH];
+    struct hashmap_entry **slots[HASHMAP_BATCH];
+    struct hashmap_entry *heads[HASHMAP_BATCH];
+    size_t buf[HASHMAP_BATCH];
+    const size_t *len;
+    struct hashmap_entry *e;
+    for (size_t i = 0; i < n; i += HASHMAP_BATCH) {
+        const size_t batch = n - i < HASHMAP_BATCH ? n - i : HASHMAP_BATCH;
+        hashmap_migrate(m, HASHMAP_MIGRATE_STEP);
+        len = hashmap_batch_lens(&k[i], lens ? &lens[i] : 0, batch, buf);
+        if (m->intern) {
+            for (size_t j = 0; j < batch; j++) {
+                out[i + j] = hashmap_get_len(m, k[i + j], len[j]);
+            }
+            continue;
+        }
+        hash_batch(m->hash, &k[i], len, batch, hashes);
+        for (size_t j = 0; j < batch; j++) {
+            slots[j] = hashmap_bucket(m, hashes[j]);
+            hashmap_prefetch(slots[j]);
+        }
+        for (size_t j = 0; j < batch; j++) {
+            heads[j] = *slots[j];
+            if (heads[j]) {
+                hashmap_prefetch(heads[j]);
+            }
+        }
+        for (size_t j = 0; j < batch; j++) {
+            e = heads[j];
+            if (e && e->hash != hashes[j] && e->next) {
+                hashmap_prefetch(e->next);
+            }
+        }
+        for (size_t j = 0; j < batch; j++) {
+            e = hashmap_lookup(m, heads[j], hashes[j], k[i + j], len[j]);
+            out[i + j] = e ? hashmap_entry_value(m, e) : 0;
+        }
     }
-    if (!k || !v) {
+}
+
+/*
+ * As for hashmap_get_many_len(), for 'n' NUL-terminated keys.
+ */
+void hashmap_get_many(
+        struct hashmap *m,
+        const char *const *keys,
+        size_t n,
+        void **out) {
+    hashmap_get_many_len(m, (const void *const *) keys, 0, n, out);
+}
+
+/*
+ * Take a snapshot of hashmap 'm': a read-only view of its contents as they
+ * are now, which later changes to the map will not affect.
+ *
+ * Taking a snapshot copies nothing.  The map copies bucket array and entries
+ * lazily, as it writes to them (see struct hashmap_snapshot), so each open
+ * snapshot costs memory in proportion to the writes made since it was taken.
+ * Any resize still in progress is finished first.
+ *
+ * Return a NULL pointer if the snapshot cannot be allocated.
+ */
+struct hashmap_snapshot *hashmap_snapshot(struct hashmap *m) {
+    if (!m) {
+        return 0;
+    }
+    struct hashmap_snapshot *s = malloc(sizeof *s);
+    if (!s) {
         return 0;
     }
-    struct hashmap_entry *head = e;
-    struct hashmap_entry *tail = 0;
+    hashmap_migrate(m, UINT_MAX);
+    if (m->old_buckets) {
+        free(s);
+        return 0;
+    }
+    s->map = m;
+    s->gen = m->gen++;
+    s->size = m->size;
+    s->count = m->count;
+    s->buckets = m->buckets;
+    s->next = m->snapshots;
+    m->snapshots = s;
+    m->shared = true;
+    m->shared_gen = m->gen;
+    return s;
+}
 
-    if (!e) {
-        /* Empty list, create and return a new entry. */
-        head = hashmap_entry_create(k, v);
-        if (head && created) {
-            *created = true;
-        }
-        return head;
+/*
+ * Destroy snapshot 's', and free whatever its map was keeping on its behalf.
+ */
+void hashmap_snapshot_destroy(struct hashmap_snapshot *s) {
+    if (!s) {
+        return;
     }
+    struct hashmap *m = s->map;
+    struct hashmap_snapshot **link = &m->snapshots;
+    while (*link != s) {
+        link = &(*link)->next;
+    }
+    *link = s->next;
 
-    while (e) {
-        if (strcmp(e->key, k) == 0) {
-            /* Key exists, update value. */
-            e->value = v;
-            return head;
+    bool buckets_used = m->buckets == s->buckets;
+    bool map_shared = false;
+    unsigned int oldest = UINT_MAX;
+    m->shared_gen = 0;
+    for (struct hashmap_snapshot *t = m->snapshots; t; t = t->next) {
+        buckets_used |= t->buckets == s->buckets;
+        map_shared |= t->buckets == m->buckets;
+        if (t->gen < oldest) {
+            oldest = t->gen;
         }
-        tail = e;
-        e = e->next;
+        if (t->gen >= m->shared_gen) {
+            m->shared_gen = t->gen + 1;
+        }
+    }
+    if (!buckets_used) {
+        free(s->buckets);
     }
+    m->shared = m->shared && map_shared;
+    hashmap_release(m, oldest);
+    free(s);
+}
 
-    /* Key does not exist, append new entry. */
-    e = hashmap_entry_create(k, v);
-    if (!e) {
+/*
+ * Return the value for the 'len' byte key 'k' in snapshot 's'.
+ *
+ * If the key was not in the map when the snapshot was taken, return a NULL
+ * pointer.
+ */
+void *hashmap_snapshot_get_len(
+        const struct hashmap_snapshot *s,
+        const void *k,
+        size_t len) {
+    struct hashmap_key key;
+    if (!hashmap_key_init(s->map, k, len, false, &key)) {
         return 0;
     }
-    tail->next = e;
-    if (created) {
-        *created = true;
+    struct hashmap_entry *e = hashmap_find(
+            s->buckets[hash_index(key.hash, s->size)], key.hash, key.k,
+            key.len);
+    if (e) {
+        return hashmap_entry_value(s->map, e);
+    }
+    return 0;
+}
+
+void *hashmap_snapshot_get(const struct hashmap_snapshot *s, const char *k) {
+    if (!k) {
+        return 0;
     }
-    return head;
+    return hashmap_snapshot_get_len(s, k, strlen(k));
 }
 
 /*
- * Set key 'k' to value 'v' in hashmap 'm'.
- *
- * If an entry for the given key already exists, it takes the new value.
- * Otherwise, a new entry is created.
- *
- * 'v' must point to alloc'd memory.  When the map is destroyed, the data
- * pointed to by 'v' will be freed also.
- *
- * Return whether the entry was created successfully.
+ * Return whether the 'len' byte key 'k' was in the map when snapshot 's' was
+ * taken.
  */
-bool hashmap_set(struct hashmap *m, const char *k, void *v) {
-    size_t i = hash_index(k, m->size);
-    bool created = false;
-    struct hashmap_entry *e = hashmap_set_entry(m->buckets[i], k, v, &created);
-    if (!e) {
+bool hashmap_snapshot_exists_len(
+        const struct hashmap_snapshot *s,
+        const void *k,
+        size_t len) {
+    return hashmap_snapshot_get_len(s, k, len) != 0;
+}
+
+bool hashmap_snapshot_exists(const struct hashmap_snapshot *s, const char *k) {
+    if (!k) {
         return false;
     }
-    m->buckets[i] = e;
-    if (created) {
-        m->count++;
+    return hashmap_snapshot_exists_len(s, k, strlen(k));
+}
+
+/*
+ * Return the number of bytes the slab sets aside for an allocation of 'size'
+ * bytes.
+ */
+static inline size_t hashmap_alloc_size(const size_t size) {
+    if (size > SLAB_MAX_SIZE) {
+        return size;
     }
+    return (size + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+}
 
-    /*
-     * Did adding this entry bring the overall load factor up to the maximum?
-     * Do we still have room to expand?  If so, then resize it.
-     */
-    if (m->count / m->size >= HASHMAP_MAX_LOAD &&
-            m->size * HASHMAP_SCALE_FACTOR <= HASHMAP_MAX_SIZE) {
-        /*
-         * Multiply the current size by the scaling factor, prepare a new
-         * bucket array of that size, copy the existing entries into the new
-         * bucket array, and then point the hashmap at the new bucket array and
-         * destroy the old one.
-         */
-        const size_t size = m->size * HASHMAP_SCALE_FACTOR;
-        struct hashmap_entry **buckets;
-        struct hashmap_entry *new;
-        buckets = calloc(size, sizeof (struct hashmap_entry *));
-
-        for (unsigned int b = 0; b < m->size; b++) {
-            e = m->buckets[b];
-            while (e) {
-                i = hash_index(e->key, size);
-                new = hashmap_set_entry(buckets[i], e->key, e->value, 0);
-                if (!new) {
-                    /*
-                     * Something has gone terribly wrong, abort the resize
-                     * operation.
-                     */
-                    hashmap_buckets_destroy(buckets, size, true);
-                    return true;
-                }
-                buckets[i] = new;
-                e = e->next;
-            }
+/*
+ * Add the chains in 'buckets' of hashmap 'm' to 'st', from bucket 'from' up
+ * to 'size', adding up in 'hit' the number of entries compared to reach each
+ * entry in its chain.
+ */
+static void hashmap_stats_buckets(
+        const struct hashmap *m,
+        struct hashmap_entry *const *buckets,
+        const size_t from,
+        const size_t size,
+        struct hashmap_stats *st,
+        size_t *hit) {
+    for (size_t i = from; i < size; i++) {
+        size_t len = 0;
+        for (const struct hashmap_entry *e = buckets[i]; e; e = e->next) {
+            len++;
+            st->entry_bytes += hashmap_alloc_size(hashmap_entry_size(m,
+                        e->len));
+            st->key_bytes += e->len + 1;
         }
-
-        struct hashmap_entry **old_buckets;
-        old_buckets = m->buckets;
-        m->buckets = buckets;
-        hashmap_buckets_destroy(old_buckets, m->size, true);
-        m->size = size;
+        st->chains[len < HASHMAP_STATS_CHAINS ?
+            len : HASHMAP_STATS_CHAINS - 1]++;
+        if (len > st->max_chain) {
+            st->max_chain = len;
+        }
+        *hit += len * (len + 1) / 2;
+        st->buckets++;
     }
-    return true;
 }
 
 /*
- * Return the value for key 'k' in hashmap 'm'.
+ * Fill in 'st' with statistics on hashmap 'm' (see struct hashmap_stats).
  *
- * If the key does not exist in the map, return a NULL pointer.
+ * This walks every bucket and entry, so it takes time in proportion to the
+ * size of the map, and is meant for occasional inspection, not the fast path.
  */
-void *hashmap_get(struct hashmap *m, const char *k) {
-    size_t i = hash_index(k, m->size);
-    struct hashmap_entry *e = hashmap_find(m->buckets[i], k);
-    if (e) {
-        return e->value;
+void hashmap_stats(const struct hashmap *m, struct hashmap_stats *st) {
+    memset(st, 0, sizeof *st);
+    if (!m) {
+        return;
+    }
+    size_t hit = 0;
+    hashmap_stats_buckets(m, m->buckets, 0, m->size, st, &hit);
+    if (m->old_buckets) {
+        hashmap_stats_buckets(m, m->old_buckets, m->migrated, m->old_size,
+                st, &hit);
+    }
+    st->count = m->count;
+    st->empty_ratio = (double) st->chains[0] / st->buckets;
+    st->hit_probes = m->count ? (double) hit / m->count : 0;
+    st->miss_probes = (double) m->count / st->buckets;
+    st->resizes = m->resizes;
+    st->bucket_bytes = ((size_t) m->size + m->old_size) *
+        sizeof (struct hashmap_entry *);
+#ifdef HASHMAP_COUNTERS
+    st->counted = true;
+#endif
+    st->counters = m->counters;
+}
+
+/*
+ * Return the entry for interned string 'h' in the chain starting at 'e', or
+ * a NULL pointer if there is none, comparing keys by pointer alone.
+ */
+static inline struct hashmap_entry *hashmap_find_interned(
+        struct hashmap_entry *e,
+        const char *h) {
+    const unsigned long hash = intern_hash(h);
+    const char *k;
+    for (; e; e = e->next) {
+        memcpy(&k, e->key, sizeof k);
+        if (k == h && e->hash == hash) {
+            return e;
+        }
     }
     return 0;
 }
 
 /*
- * Delete the entry for 'k' from hashmap 'm'.
+ * Return the value for interned string 'h' in hashmap 'm', as for
+ * hashmap_get().  'h' must be a handle from the map's own intern table.
  *
- * If the key exists in the map, delete its entry and return true.  Otherwise,
- * do nothing and return false.
+ * The key is neither hashed nor compared byte by byte: its hash comes with
+ * the handle, and entries are matched on the handle's address.
  */
-bool hashmap_delete(struct hashmap *m, const char *k) {
-    if (!m || !k) {
+void *hashmap_get_interned(struct hashmap *m, const char *h) {
+    if (!m || !m->intern || !h) {
+        return 0;
+    }
+    hashmap_migrate(m, HASHMAP_MIGRATE_STEP);
+    struct hashmap_entry *e = hashmap_find_interned(
+            *hashmap_bucket(m, intern_hash(h)), h);
+    hashmap_count(m, lookups, 1);
+    hashmap_count(m, hits, e != 0);
+    return e ? hashmap_entry_value(m, e) : 0;
+}
+
+bool hashmap_exists_interned(const struct hashmap *m, const char *h) {
+    if (!m || !m->intern || !h) {
         return false;
     }
-    size_t i = hash_index(k, m->size);
-    struct hashmap_entry *curr = m->buckets[i];
-    struct hashmap_entry *prev = 0;
-    while (curr) {
-        if (strcmp(curr->key, k) == 0) {
-            if (prev) {
-                prev->next = curr->next;
-            } else {
-                m->buckets[i] = curr->next;
-            }
-            hashmap_entry_destroy(curr, false);
-            m->count--;
-            return true;
-        }
-        prev = curr;
-        curr = curr->next;
+    return hashmap_find_interned(*hashmap_bucket(m, intern_hash(h)), h) != 0;
+}
+
+/*
+ * Set interned string 'h' to value 'v' in hashmap 'm', as for hashmap_set().
+ * 'h' must be a handle from the map's own intern table.
+ */
+bool hashmap_set_interned(struct hashmap *m, const char *h, void *v) {
+    if (!m || !m->intern || !h) {
+        return false;
+    }
+    struct hashmap_key key;
+    hashmap_key_interned(&key, h);
+    return hashmap_set_hashed(m, key.hash, key.k, key.len, v);
+}
+
+/*
+ * Delete interned string 'h' from hashmap 'm', as for hashmap_delete().
+ * 'h' must be a handle from the map's own intern table.
+ */
+bool hashmap_delete_interned(struct hashmap *m, const char *h) {
+    if (!m || !m->intern || !h) {
+        return false;
     }
-    return false;
+    struct hashmap_key key;
+    hashmap_key_interned(&key, h);
+    return hashmap_remove(m, key.hash, key.k, key.len, 0);
 }
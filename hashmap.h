@@ -1,21 +1,263 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
 #include <stdbool.h>
+#include <stddef.h>
+#include "./hash.h"
 
+/*
+ * The 'len' bytes of the key are stored inline at the end of the entry,
+ * followed by a NUL, so each entry is a single allocation from the map's slab.
+ * For a map with interned keys, the bytes stored are the handle's own.
+ * For a map of HASHMAP_VALUES_INLINE, the value follows the key, aligned for
+ * any type, and 'value' points to it.
+ *
+ * 'gen' is the map generation in which the entry was allocated, and
+ * 'value_gen' the one in which it took its current value.  Snapshots use them
+ * to tell which entries and values they may still be sharing with the map.
+ */
 struct hashmap_entry {
     struct hashmap_entry *next;
-    char *key;
+    unsigned long hash;
     void *value;
+    size_t len;
+    unsigned int gen;
+    unsigned int value_gen;
+    char key[];
 };
 
+struct hashmap_snapshot;
+struct hashmap_retired;
+struct intern;
+
+/*
+ * How a hashmap stores its values.
+ *
+ * HASHMAP_VALUES_POINTER, the default, keeps the pointer it is given, and
+ * hands it to a destructor when its entry is deleted or the map destroyed.
+ * A value that is replaced by setting its key again is left to the caller.
+ *
+ * HASHMAP_VALUES_WORD keeps a uintptr_t in the entry's 'value' field, and
+ * HASHMAP_VALUES_INLINE keeps a fixed number of bytes in the entry itself, so
+ * neither needs an allocation of its own for each value.  For these, setting
+ * a key copies the value from the pointer given, and getting one returns a
+ * pointer to the map's copy, which stays valid until the key is next set or
+ * deleted.  A word value may be zero.
+ */
+enum hashmap_values {
+    HASHMAP_VALUES_POINTER,
+    HASHMAP_VALUES_WORD,
+    HASHMAP_VALUES_INLINE,
+};
+
+/*
+ * A function that frees value 'v' once its entry is deleted or its map
+ * destroyed.
+ */
+typedef void (*hashmap_free_func)(void *v);
+
+/*
+ * Counts of what a hashmap has been asked to do, kept only if HASHMAP_COUNTERS
+ * is defined when building hashmap.c, so that they cost nothing otherwise.
+ * Every map has room for them either way, so code that includes this header
+ * agrees on the layout of struct hashmap whatever it was built with.
+ *
+ * 'lookups' counts calls to hashmap_get() and keys looked up by
+ * hashmap_get_many(), of which 'hits' were found.  'hit_probes' and
+ * 'miss_probes' are the number of entries they compared along the way.
+ * 'inserts' and 'updates' count keys set that were new or already there, and
+ * 'deletes' keys removed.  'resize_seconds' is the time spent allocating new
+ * bucket arrays and moving entries into them.
+ */
+struct hashmap_counters {
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long hit_probes;
+    unsigned long miss_probes;
+    unsigned long inserts;
+    unsigned long updates;
+    unsigned long deletes;
+    double resize_seconds;
+};
+
+/*
+ * While a resize is in progress, 'old_buckets' holds the previous bucket array
+ * of 'old_size' buckets.  Buckets below 'migrated' have already been moved
+ * into 'buckets'; the rest are still waiting in 'old_buckets'.
+ *
+ * Bucket counts are always powers of two.  The map grows by a factor of
+ * 'growth' once 'count' exceeds 'grow_at', and shrinks by the same factor
+ * once it falls below 'shrink_at', though never below 'min_size' buckets.
+ *
+ * Each snapshot taken starts a new generation 'gen'.  Entries from before
+ * 'shared_gen' may be visible to an open snapshot, and 'shared' is set while
+ * 'buckets' itself still belongs to one.  Entries and values the map no
+ * longer uses, but a snapshot might, wait on the 'retired' list.
+ */
 struct hashmap {
+    hash_func hash;
+    unsigned int size;
+    unsigned int count;
+    struct hashmap_entry **buckets;
+    unsigned int old_size;
+    unsigned int migrated;
+    struct hashmap_entry **old_buckets;
+    struct slab *slab;
+    double max_load;
+    double min_load;
+    unsigned int growth;
+    unsigned int min_size;
+    unsigned int grow_at;
+    unsigned int shrink_at;
+    unsigned int gen;
+    unsigned int shared_gen;
+    bool shared;
+    struct hashmap_snapshot *snapshots;
+    struct hashmap_retired *retired;
+    enum hashmap_values values;
+    size_t value_size;
+    hashmap_free_func free_value;
+    unsigned int resizes;
+    struct intern *intern;
+    struct hashmap_counters counters;
+};
+
+/*
+ * A read-only view of a hashmap as it was when the snapshot was taken.
+ *
+ * The snapshot shares its buckets and entries with the map.  When the map
+ * next writes to the bucket array, it takes a copy of its own, and an entry
+ * that a snapshot can see is copied, along with the entries ahead of it in
+ * its chain, before it is changed or unlinked.  Entries the map lets go of,
+ * and the values of deleted entries, are freed once no snapshot can see them
+ * any more.
+ *
+ * Snapshots belong to their map, and must not outlive it.
+ */
+struct hashmap_snapshot {
+    struct hashmap *map;
+    unsigned int gen;
     unsigned int size;
     unsigned int count;
     struct hashmap_entry **buckets;
+    struct hashmap_snapshot *next;
+};
+
+/*
+ * Sizing policy for a new hashmap.  Fill in the defaults with
+ * hashmap_options_init() and then change whichever fields you need.
+ *
+ * 'capacity' is the number of entries to size the map for up front.  The map
+ * grows once the average number of entries per bucket exceeds 'max_load', and
+ * shrinks once it falls below 'min_load'; a 'min_load' of zero means it never
+ * shrinks.  'growth' is the factor to grow or shrink by, rounded up to a
+ * power of two.  'hash' is as for hashmap_create_with_hash().
+ *
+ * 'values' says how values are stored (see enum hashmap_values), and
+ * 'value_size' is the number of bytes in each inline value.  'free_value' is
+ * called on each pointer value the map lets go of, and defaults to free(); if
+ * it is a NULL pointer, the map leaves its values alone.  Word and inline
+ * values are never freed.
+ *
+ * If 'intern' is set, the map's keys are interned in that table (see
+ * intern.h), which must outlive the map.  Entries then hold the handle in
+ * place of a copy of the key, so every distinct key is stored once however
+ * many maps use it, and the hashmap_*_interned() functions look keys up by
+ * handle with no hashing and a pointer compare.  Keys are hashed with the
+ * table's hash function, not 'hash'.
+ */
+struct hashmap_options {
+    hash_func hash;
+    size_t capacity;
+    double max_load;
+    double min_load;
+    unsigned int growth;
+    enum hashmap_values values;
+    size_t value_size;
+    hashmap_free_func free_value;
+    struct intern *intern;
 };
 
+/*
+ * How a hashmap's entries are spread over its buckets, as filled in by
+ * hashmap_stats(), for choosing capacities and hash functions.
+ *
+ * 'chains[i]' is the number of buckets holding i entries, with the last
+ * element counting every longer chain as well.  While a resize is in
+ * progress, the old buckets still to be moved count as buckets too.
+ * 'hit_probes' is the average number of entries compared when looking up a
+ * key that is in the map, and 'miss_probes' the average for a key that is
+ * not, both worked out from the chain lengths.
+ *
+ * 'resizes' counts the bucket arrays the map has moved to.  The byte counts
+ * cover the bucket arrays, and the entries as allocated, including the keys
+ * inside them, which 'key_bytes' also counts on their own.  The strings
+ * behind interned keys belong to their table, and are not counted.
+ *
+ * 'counters' holds the map's counters if it keeps them, as 'counted' says,
+ * and is all zero if not.
+ */
+#define HASHMAP_STATS_CHAINS 8
+
+struct hashmap_stats {
+    size_t count;
+    size_t buckets;
+    size_t chains[HASHMAP_STATS_CHAINS];
+    size_t max_chain;
+    double empty_ratio;
+    double hit_probes;
+    double miss_probes;
+    unsigned int resizes;
+    size_t bucket_bytes;
+    size_t entry_bytes;
+    size_t key_bytes;
+    bool counted;
+    struct hashmap_counters counters;
+};
+
+void hashmap_options_init(struct hashmap_options *);
 struct hashmap *hashmap_create();
+struct hashmap *hashmap_create_with_hash(hash_func);
+struct hashmap *hashmap_create_with_options(const struct hashmap_options *);
+bool hashmap_reserve(struct hashmap *, size_t);
 void hashmap_destroy(struct hashmap *);
 void hashmap_copy(struct hashmap *dst, struct hashmap *src);
 bool hashmap_set(struct hashmap *, const char *, void *);
 void *hashmap_get(struct hashmap *, const char *);
 bool hashmap_delete(struct hashmap *, const char *);
 bool hashmap_exists(const struct hashmap *, const char *);
+bool hashmap_set_len(struct hashmap *, const void *, size_t, void *);
+void *hashmap_get_len(struct hashmap *, const void *, size_t);
+bool hashmap_delete_len(struct hashmap *, const void *, size_t);
+bool hashmap_exists_len(const struct hashmap *, const void *, size_t);
+void *hashmap_get_or_insert(struct hashmap *, const char *, bool *);
+void *hashmap_get_or_insert_len(struct hashmap *, const void *, size_t,
+        bool *);
+bool hashmap_take(struct hashmap *, const char *, void *);
+bool hashmap_take_len(struct hashmap *, const void *, size_t, void *);
+void *hashmap_entry_value(const struct hashmap *,
+        const struct hashmap_entry *);
+const char *hashmap_entry_key(const struct hashmap *,
+        const struct hashmap_entry *, size_t *);
+void hashmap_stats(const struct hashmap *, struct hashmap_stats *);
+void *hashmap_get_interned(struct hashmap *, const char *);
+bool hashmap_exists_interned(const struct hashmap *, const char *);
+bool hashmap_set_interned(struct hashmap *, const char *, void *);
+bool hashmap_delete_interned(struct hashmap *, const char *);
+size_t hashmap_set_many(struct hashmap *, const char *const *, void *const *,
+        size_t);
+size_t hashmap_set_many_len(struct hashmap *, const void *const *,
+        const size_t *, void *const *, size_t);
+void hashmap_get_many(struct hashmap *, const char *const *, size_t, void **);
+void hashmap_get_many_len(struct hashmap *, const void *const *,
+        const size_t *, size_t, void **);
+struct hashmap_snapshot *hashmap_snapshot(struct hashmap *);
+void hashmap_snapshot_destroy(struct hashmap_snapshot *);
+void *hashmap_snapshot_get(const struct hashmap_snapshot *, const char *);
+bool hashmap_snapshot_exists(const struct hashmap_snapshot *, const char *);
+void *hashmap_snapshot_get_len(const struct hashmap_snapshot *, const void *,
+        size_t);
+bool hashmap_snapshot_exists_len(const struct hashmap_snapshot *,
+        const void *, size_t);
+
+#endif
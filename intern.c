@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <string.h>
+#include "./intern.h"
+#include "./slab.h"
+
+#define INTERN_INIT_SIZE 64
+
+/*
+ * Create an intern table that hashes its strings with 'hash', or with
+ * hash_xx64_len() if 'hash' is a NULL pointer.
+ *
+ * Return a NULL pointer if the table cannot be allocated.
+ */
+struct intern *intern_create_with_hash(hash_func hash) {
+    struct intern *t = malloc(sizeof *t);
+    if (!t) {
+        return 0;
+    }
+    t->hash = hash ? hash : hash_xx64_len;
+    t->size = INTERN_INIT_SIZE;
+    t->count = 0;
+    t->buckets = calloc(t->size, sizeof *t->buckets);
+    t->slab = slab_create();
+    if (!t->buckets || !t->slab) {
+        free(t->buckets);
+        slab_destroy(t->slab);
+        free(t);
+        return 0;
+    }
+    return t;
+}
+
+struct intern *intern_create() {
+    return intern_create_with_hash(0);
+}
+
+/*
+ * Destroy table 't' and every string in it.  Handles from the table must not
+ * be used afterwards.
+ */
+void intern_destroy(struct intern *t) {
+    if (!t) {
+        return;
+    }
+    for (size_t i = 0; i < t->size; i++) {
+        struct intern_string *s = t->buckets[i], *next;
+        for (; s; s = next) {
+            next = s->next;
+            if (offsetof(struct intern_string, str) + s->len + 1 >
+                    SLAB_MAX_SIZE) {
+                free(s);
+            }
+        }
+    }
+    free(t->buckets);
+    slab_destroy(t->slab);
+    free(t);
+}
+
+/*
+ * Return the string in table 't' matching the 'len' bytes at 'k' with hash
+ * 'hash', or a NULL pointer if there is none.
+ */
+static struct intern_string *intern_lookup(
+        const struct intern *t,
+        const unsigned long hash,
+        const char *k,
+        const size_t len) {
+    struct intern_string *s = t->buckets[hash & (t->size - 1)];
+    for (; s; s = s->next) {
+        if (s->hash == hash && s->len == len && memcmp(s->str, k, len) == 0) {
+            return s;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Double the number of buckets in table 't', relinking every string at its
+ * cached hash.  The strings themselves do not move, so handles stay valid.
+ */
+static void intern_grow(struct intern *t) {
+    const size_t size = t->size * 2;
+    struct intern_string **buckets = calloc(size, sizeof *buckets);
+    if (!buckets) {
+        return;
+    }
+    for (size_t i = 0; i < t->size; i++) {
+        struct intern_string *s = t->buckets[i], *next;
+        for (; s; s = next) {
+            next = s->next;
+            s->next = buckets[s->hash & (size - 1)];
+            buckets[s->hash & (size - 1)] = s;
+        }
+    }
+    free(t->buckets);
+    t->buckets = buckets;
+    t->size = size;
+}
+
+/*
+ * Return the handle for the 'len' byte string 'k' in table 't', adding a
+ * copy of it to the table if it is not there yet.
+ *
+ * The string may contain any bytes, including NULs.
+ *
+ * Return a NULL pointer if the string cannot be added.
+ */
+const char *intern_add_len(struct intern *t, const void *k, size_t len) {
+    if (!t || !k) {
+        return 0;
+    }
+    const unsigned long hash = t->hash(k, len);
+    struct intern_string *s = intern_lookup(t, hash, k, len);
+    if (s) {
+        return s->str;
+    }
+    s = slab_alloc(t->slab, offsetof(struct intern_string, str) + len + 1);
+    if (!s) {
+        return 0;
+    }
+    s->hash = hash;
+    s->len = len;
+    memcpy(s->str, k, len);
+    s->str[len] = '\0';
+    s->next = t->buckets[hash & (t->size - 1)];
+    t->buckets[hash & (t->size - 1)] = s;
+    if (++t->count > t->size) {
+        intern_grow(t);
+    }
+    return s->str;
+}
+
+const char *intern_add(struct intern *t, const char *k) {
+    if (!k) {
+        return 0;
+    }
+    return intern_add_len(t, k, strlen(k));
+}
+
+/*
+ * Return the handle for the 'len' byte string 'k' in table 't', or a NULL
+ * pointer if it has not been added.
+ */
+const char *intern_find_len(
+        const struct intern *t,
+        const void *k,
+        size_t len) {
+    if (!t || !k) {
+        return 0;
+    }
+    struct intern_string *s = intern_lookup(t, t->hash(k, len), k, len);
+    return s ? s->str : 0;
+}
+
+const char *intern_find(const struct intern *t, const char *k) {
+    if (!k) {
+        return 0;
+    }
+    return intern_find_len(t, k, strlen(k));
+}
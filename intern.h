@@ -0,0 +1,62 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include "./hash.h"
+
+/*
+ * A table of interned strings: each distinct string is stored once, and
+ * adding it again returns the same pointer, so two interned strings are equal
+ * exactly when their pointers are.
+ *
+ * A handle returned by intern_add() is a NUL-terminated copy of the string,
+ * which stays valid until the table is destroyed.  It sits at the end of a
+ * struct intern_string, which also keeps its length and hash.
+ */
+struct intern_string {
+    struct intern_string *next;
+    unsigned long hash;
+    size_t len;
+    char str[];
+};
+
+struct intern {
+    hash_func hash;
+    size_t size;
+    size_t count;
+    struct intern_string **buckets;
+    struct slab *slab;
+};
+
+struct intern *intern_create();
+struct intern *intern_create_with_hash(hash_func);
+void intern_destroy(struct intern *);
+const char *intern_add(struct intern *, const char *);
+const char *intern_add_len(struct intern *, const void *, size_t);
+const char *intern_find(const struct intern *, const char *);
+const char *intern_find_len(const struct intern *, const void *, size_t);
+
+/*
+ * Return the record for interned string 'h'.
+ */
+static inline const struct intern_string *intern_string(const char *h) {
+    return (const struct intern_string *)
+        (h - offsetof(struct intern_string, str));
+}
+
+/*
+ * Return the length of interned string 'h', without a call to strlen().
+ */
+static inline size_t intern_len(const char *h) {
+    return intern_string(h)->len;
+}
+
+/*
+ * Return the hash of interned string 'h', as computed by its table's hash
+ * function when it was added.
+ */
+static inline unsigned long intern_hash(const char *h) {
+    return intern_string(h)->hash;
+}
+
+#endif
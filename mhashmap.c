@@ -0,0 +1,337 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "./mhashmap.h"
+#include "./hash.h"
+#include "./intern.h"
+
+#define MHASHMAP_ALIGN 8
+
+/*
+ * Return 'n' rounded up to a multiple of MHASHMAP_ALIGN.
+ */
+static inline size_t mhashmap_pad(const size_t n) {
+    return (n + MHASHMAP_ALIGN - 1) & ~(size_t) (MHASHMAP_ALIGN - 1);
+}
+
+/*
+ * Return the offset of the value within a record with a 'key_len' byte key.
+ */
+static inline size_t mhashmap_value_offset(const size_t key_len) {
+    return mhashmap_pad(offsetof(struct mhashmap_record, key) + key_len + 1);
+}
+
+/*
+ * Return the number of bytes taken by a record with a 'key_len' byte key and
+ * a 'value_len' byte value.
+ */
+static inline size_t mhashmap_record_size(
+        const size_t key_len,
+        const size_t value_len) {
+    return mhashmap_value_offset(key_len) + mhashmap_pad(value_len);
+}
+
+/*
+ * State shared by the two passes over a hashmap that write out a file.
+ *
+ * The first pass adds up the size of each bucket's records in 'offsets', and
+ * the second writes each record at its bucket's offset in 'base' and moves
+ * the offset along.
+ */
+struct mhashmap_writer {
+    const struct hashmap *map;
+    mhashmap_value_size value_size;
+    bool rehash;
+    size_t nbuckets;
+    uint64_t *offsets;
+    char *base;
+    bool ok;
+};
+
+static inline size_t mhashmap_bucket(
+        const struct mhashmap_writer *w,
+        const struct hashmap_entry *e,
+        uint64_t *hash) {
+    size_t len;
+    const char *k = hashmap_entry_key(w->map, e, &len);
+    *hash = w->rehash ? hash_xx64_len(k, len) : e->hash;
+    return (size_t) (*hash & (w->nbuckets - 1));
+}
+
+static void mhashmap_measure(
+        struct mhashmap_writer *w,
+        const struct hashmap_entry *e) {
+    uint64_t hash;
+    size_t len;
+    hashmap_entry_key(w->map, e, &len);
+    const size_t size = w->value_size(hashmap_entry_value(w->map, e));
+    if (len > UINT32_MAX || size > UINT32_MAX) {
+        w->ok = false;
+        return;
+    }
+    w->offsets[mhashmap_bucket(w, e, &hash) + 1] +=
+            mhashmap_record_size(len, size);
+}
+
+static void mhashmap_place(
+        struct mhashmap_writer *w,
+        const struct hashmap_entry *e) {
+    uint64_t hash;
+    size_t len;
+    const char *k = hashmap_entry_key(w->map, e, &len);
+    const size_t b = mhashmap_bucket(w, e, &hash);
+    const void *v = hashmap_entry_value(w->map, e);
+    struct mhashmap_record *r = (void *) (w->base + w->offsets[b]);
+    r->hash = hash;
+    r->key_len = (uint32_t) len;
+    r->value_len = (uint32_t) w->value_size(v);
+    memcpy(r->key, k, len);
+    memcpy((char *) r + mhashmap_value_offset(len), v, r->value_len);
+    w->offsets[b] += mhashmap_record_size(r->key_len, r->value_len);
+}
+
+/*
+ * Call 'fn' on every entry in hashmap 'm', including any that are still
+ * waiting to be moved out of the old bucket array.
+ */
+static void mhashmap_each(
+        const struct hashmap *m,
+        struct mhashmap_writer *w,
+        void (*fn)(struct mhashmap_writer *, const struct hashmap_entry *)) {
+    const struct hashmap_entry *e;
+    if (m->old_buckets) {
+        for (size_t i = m->migrated; i < m->old_size; i++) {
+            for (e = m->old_buckets[i]; e; e = e->next) {
+                fn(w, e);
+            }
+        }
+    }
+    for (size_t i = 0; i < m->size; i++) {
+        for (e = m->buckets[i]; e; e = e->next) {
+            fn(w, e);
+        }
+    }
+}
+
+/*
+ * Write the contents of hashmap 'm' to a new file at 'path', replacing any
+ * file that is already there.
+ *
+ * 'value_size' gives the number of bytes in each value; the bytes themselves
+ * are copied from the value pointer, as hashmap_get() would return it.  There
+ * is a bucket for every key, rounded up to a power of two.
+ *
+ * The file is built in full under a temporary name next to 'path', and only
+ * renamed into place once it is complete, so a process that already has the
+ * old file open is not affected.
+ *
+ * Return whether the file was written.  Keys and values must each be under
+ * 4GB.
+ */
+bool mhashmap_write(
+        const struct hashmap *m,
+        const char *path,
+        mhashmap_value_size value_size) {
+    if (!m || !path || !value_size) {
+        return false;
+    }
+    struct mhashmap_writer w;
+    w.map = m;
+    w.value_size = value_size;
+    w.rehash = (m->intern ? m->intern->hash : m->hash) != hash_xx64_len;
+    w.nbuckets = 1;
+    while (w.nbuckets < m->count) {
+        w.nbuckets <<= 1;
+    }
+    w.ok = true;
+    w.offsets = calloc(w.nbuckets + 1, sizeof *w.offsets);
+    if (!w.offsets) {
+        return false;
+    }
+
+    /* Work out where each bucket's records start. */
+    mhashmap_each(m, &w, mhashmap_measure);
+    w.offsets[0] = sizeof (struct mhashmap_header) +
+        (w.nbuckets + 1) * sizeof *w.offsets;
+    for (size_t i = 1; i <= w.nbuckets; i++) {
+        w.offsets[i] += w.offsets[i - 1];
+    }
+    const size_t size = w.offsets[w.nbuckets];
+
+    char *tmp = malloc(strlen(path) + sizeof ".tmp");
+    int fd = -1;
+    w.base = MAP_FAILED;
+    if (w.ok && tmp) {
+        strcpy(tmp, path);
+        strcat(tmp, ".tmp");
+        fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd >= 0 && ftruncate(fd, size) == 0) {
+        w.base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (w.base == MAP_FAILED) {
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        free(tmp);
+        free(w.offsets);
+        return false;
+    }
+
+    struct mhashmap_header *h = (void *) w.base;
+    memcpy(h->magic, MHASHMAP_MAGIC, sizeof h->magic);
+    h->version = MHASHMAP_VERSION;
+    h->byte_order = MHASHMAP_BYTE_ORDER;
+    h->count = m->count;
+    h->nbuckets = w.nbuckets;
+    h->size = size;
+    memcpy(h + 1, w.offsets, (w.nbuckets + 1) * sizeof *w.offsets);
+
+    /* Fill in the records, leaving each bucket's offset at the next one. */
+    mhashmap_each(m, &w, mhashmap_place);
+
+    w.ok = munmap(w.base, size) == 0;
+    w.ok = close(fd) == 0 && w.ok;
+    w.ok = w.ok && rename(tmp, path) == 0;
+    if (!w.ok) {
+        unlink(tmp);
+    }
+    free(tmp);
+    free(w.offsets);
+    return w.ok;
+}
+
+/*
+ * Return whether the 'size' bytes at 'base' start with a header and bucket
+ * table this code can read.
+ *
+ * Only the header and the ends of the bucket table are checked, so opening
+ * a file costs the same whatever its size.  The records themselves are
+ * trusted.
+ */
+static bool mhashmap_valid(const char *base, const size_t size) {
+    const struct mhashmap_header *h = (const void *) base;
+    if (size < sizeof *h ||
+            memcmp(h->magic, MHASHMAP_MAGIC, sizeof h->magic) != 0 ||
+            h->version != MHASHMAP_VERSION ||
+            h->byte_order != MHASHMAP_BYTE_ORDER ||
+            h->size != size ||
+            h->nbuckets == 0 || (h->nbuckets & (h->nbuckets - 1)) ||
+            h->nbuckets >= (size - sizeof *h) / sizeof (uint64_t)) {
+        return false;
+    }
+    const uint64_t *offsets = (const void *) (h + 1);
+    const size_t end = sizeof *h + (h->nbuckets + 1) * sizeof *offsets;
+    return offsets[0] == end && offsets[h->nbuckets] <= size;
+}
+
+/*
+ * Map the file at 'path', written by mhashmap_write(), into memory.
+ *
+ * Nothing is read up front beyond the header: the pages of the file are read
+ * in by the kernel as lookups touch them, and shared with every other process
+ * that maps the same file.
+ *
+ * Return a NULL pointer if the file cannot be opened or mapped, or is not a
+ * file this code can read.
+ */
+struct mhashmap *mhashmap_open(const char *path) {
+    if (!path) {
+        return 0;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    struct mhashmap *f = malloc(sizeof *f);
+    void *base = MAP_FAILED;
+    if (f && fstat(fd, &st) == 0 &&
+            (size_t) st.st_size >= sizeof (struct mhashmap_header)) {
+        base = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED) {
+        free(f);
+        return 0;
+    }
+    if (!mhashmap_valid(base, st.st_size)) {
+        munmap(base, st.st_size);
+        free(f);
+        return 0;
+    }
+
+    const struct mhashmap_header *h = base;
+    f->base = base;
+    f->size = st.st_size;
+    f->count = h->count;
+    f->nbuckets = h->nbuckets;
+    f->offsets = (const void *) (h + 1);
+    return f;
+}
+
+void mhashmap_close(struct mhashmap *f) {
+    if (!f) {
+        return;
+    }
+    munmap((void *) f->base, f->size);
+    free(f);
+}
+
+/*
+ * Return a pointer to the value for the 'len' byte key 'k' in mapped file
+ * 'f', and if 'size' is not NULL, set it to the number of bytes in the value.
+ *
+ * The value points into the mapping, and is valid until the file is closed.
+ * Values start on an 8 byte boundary.
+ *
+ * If the key does not exist in the file, return a NULL pointer.
+ */
+const void *mhashmap_get_len(
+        const struct mhashmap *f,
+        const void *k,
+        size_t len,
+        size_t *size) {
+    const uint64_t hash = hash_xx64_len(k, len);
+    const size_t b = (size_t) (hash & (f->nbuckets - 1));
+    const struct mhashmap_record *r;
+    for (size_t at = f->offsets[b]; at < f->offsets[b + 1];
+            at += mhashmap_record_size(r->key_len, r->value_len)) {
+        r = (const void *) (f->base + at);
+        if (r->hash == hash && r->key_len == len &&
+                memcmp(r->key, k, len) == 0) {
+            if (size) {
+                *size = r->value_len;
+            }
+            return (const char *) r + mhashmap_value_offset(len);
+        }
+    }
+    return 0;
+}
+
+const void *mhashmap_get(
+        const struct mhashmap *f,
+        const char *k,
+        size_t *size) {
+    if (!k) {
+        return 0;
+    }
+    return mhashmap_get_len(f, k, strlen(k), size);
+}
+
+bool mhashmap_exists_len(const struct mhashmap *f, const void *k, size_t len) {
+    return mhashmap_get_len(f, k, len, 0) != 0;
+}
+
+bool mhashmap_exists(const struct mhashmap *f, const char *k) {
+    if (!k) {
+        return false;
+    }
+    return mhashmap_exists_len(f, k, strlen(k));
+}
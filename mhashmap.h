@@ -0,0 +1,62 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "./hashmap.h"
+
+/*
+ * A frozen hashmap in a file, served straight out of a read-only memory
+ * mapping.
+ *
+ * The file starts with a header, followed by a table of 'nbuckets' + 1 file
+ * offsets.  The records of bucket i lie back to back between offsets i and
+ * i + 1, so a bucket's chain is one contiguous run of the file, and nothing
+ * needs to be followed or fixed up after loading.  Each record is the key's
+ * hash, the key and value lengths, the key with a NUL after it, and the
+ * value, with the value and the record both padded to 8 bytes.
+ *
+ * Keys are always hashed with hash_xx64_len(), whatever hash the hashmap
+ * written out used.  Numbers are stored in the byte order of the machine that
+ * wrote the file, and opening it on a machine of the other order fails.
+ */
+#define MHASHMAP_MAGIC "HMAPFILE"
+#define MHASHMAP_VERSION 1
+#define MHASHMAP_BYTE_ORDER 0x01020304
+
+struct mhashmap_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t count;
+    uint64_t nbuckets;
+    uint64_t size;
+};
+
+struct mhashmap_record {
+    uint64_t hash;
+    uint32_t key_len;
+    uint32_t value_len;
+    char key[];
+};
+
+struct mhashmap {
+    const char *base;
+    size_t size;
+    size_t count;
+    size_t nbuckets;
+    const uint64_t *offsets;
+};
+
+/*
+ * A function returning the number of bytes in value 'v', for writing out.
+ */
+typedef size_t (*mhashmap_value_size)(const void *v);
+
+bool mhashmap_write(const struct hashmap *, const char *path,
+        mhashmap_value_size);
+struct mhashmap *mhashmap_open(const char *path);
+void mhashmap_close(struct mhashmap *);
+const void *mhashmap_get(const struct mhashmap *, const char *, size_t *);
+bool mhashmap_exists(const struct mhashmap *, const char *);
+const void *mhashmap_get_len(const struct mhashmap *, const void *, size_t,
+        size_t *);
+bool mhashmap_exists_len(const struct mhashmap *, const void *, size_t);
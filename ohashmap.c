@@ -0,0 +1,309 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "./ohashmap.h"
+#include "./hash.h"
+
+#define OHASHMAP_INIT_SIZE 32
+#define OHASHMAP_MAX_SIZE (1u << 31)
+/* Grow when the table would become more than 7/8 full. */
+#define OHASHMAP_MAX_LOAD_NUM 7
+#define OHASHMAP_MAX_LOAD_DEN 8
+/* Initial size in bytes of the key arena. */
+#define OHASHMAP_ARENA_INIT 256
+
+/*
+ * Allocate the slot arrays for a map of 'size' slots, which must be a power of
+ * two.  Return whether the allocation succeeded.
+ */
+static bool ohashmap_alloc(struct ohashmap *m, const size_t size) {
+    m->hashes = calloc(size, sizeof *m->hashes);
+    m->keys = malloc(size * sizeof *m->keys);
+    m->values = malloc(size * sizeof *m->values);
+    if (!m->hashes || !m->keys || !m->values) {
+        free(m->hashes);
+        free(m->keys);
+        free(m->values);
+        return false;
+    }
+    m->size = size;
+    return true;
+}
+
+struct ohashmap *ohashmap_create() {
+    struct ohashmap *m = malloc(sizeof *m);
+    if (!m) {
+        return 0;
+    }
+    m->count = 0;
+    m->arena = 0;
+    m->arena_size = 0;
+    m->arena_used = 0;
+    m->arena_dead = 0;
+    if (!ohashmap_alloc(m, OHASHMAP_INIT_SIZE)) {
+        free(m);
+        return 0;
+    }
+    return m;
+}
+
+void ohashmap_destroy(struct ohashmap *m) {
+    for (size_t i = 0; i < m->size; i++) {
+        if (m->hashes[i]) {
+            free(m->values[i]);
+        }
+    }
+    free(m->hashes);
+    free(m->keys);
+    free(m->values);
+    free(m->arena);
+    free(m);
+}
+
+/*
+ * Return the hash for key 'k'.  Zero is reserved to mark empty slots, so a key
+ * that hashes to zero is stored with a hash of one instead.
+ */
+static inline unsigned long ohashmap_hash(const char *k) {
+    unsigned long h = hash_shimmy2(k);
+    return h ? h : 1;
+}
+
+/*
+ * Return the home slot for hash 'h' in a table with index mask 'mask'.
+ *
+ * The hash is spread with a Fibonacci multiply first, because the low bits
+ * alone are too regular to mask off directly.
+ */
+static inline size_t ohashmap_home(const unsigned long h, const size_t mask) {
+    return (size_t) ((h * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+/*
+ * Return how far the slot at 'i' is from the home slot of its occupant.
+ */
+static inline size_t ohashmap_distance(
+        const struct ohashmap *m,
+        const size_t i) {
+    const size_t mask = m->size - 1;
+    return (i - ohashmap_home(m->hashes[i], mask)) & mask;
+}
+
+/*
+ * Return the slot index holding key 'k' with hash 'h', or -1 if it is absent.
+ *
+ * Robin Hood ordering means we can stop as soon as we pass a slot whose
+ * occupant is closer to home than we would be.
+ */
+static long ohashmap_find(
+        const struct ohashmap *m,
+        const char *k,
+        const unsigned long h) {
+    const size_t mask = m->size - 1;
+    size_t i = ohashmap_home(h, mask);
+    for (size_t dist = 0; m->hashes[i]; dist++) {
+        if (ohashmap_distance(m, i) < dist) {
+            break;
+        }
+        if (m->hashes[i] == h && strcmp(&m->arena[m->keys[i]], k) == 0) {
+            return (long) i;
+        }
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+/*
+ * Place an entry that is known not to be in the map yet, displacing richer
+ * occupants along the way.
+ */
+static void ohashmap_place(
+        struct ohashmap *m,
+        unsigned long h,
+        size_t k,
+        void *v) {
+    const size_t mask = m->size - 1;
+    size_t i = ohashmap_home(h, mask);
+    size_t dist = 0;
+    while (m->hashes[i]) {
+        size_t d = ohashmap_distance(m, i);
+        if (d < dist) {
+            unsigned long th = m->hashes[i];
+            size_t tk = m->keys[i];
+            void *tv = m->values[i];
+            m->hashes[i] = h;
+            m->keys[i] = k;
+            m->values[i] = v;
+            h = th;
+            k = tk;
+            v = tv;
+            dist = d;
+        }
+        i = (i + 1) & mask;
+        dist++;
+    }
+    m->hashes[i] = h;
+    m->keys[i] = k;
+    m->values[i] = v;
+}
+
+/*
+ * Move every entry into a new set of slot arrays of 'size' slots.
+ *
+ * Key offsets are moved rather than the keys copied, and the stored hashes are
+ * reused, so no key is hashed or copied again.
+ */
+static bool ohashmap_resize(struct ohashmap *m, const size_t size) {
+    struct ohashmap old = *m;
+    if (!ohashmap_alloc(m, size)) {
+        *m = old;
+        return false;
+    }
+    for (size_t i = 0; i < old.size; i++) {
+        if (old.hashes[i]) {
+            ohashmap_place(m, old.hashes[i], old.keys[i], old.values[i]);
+        }
+    }
+    free(old.hashes);
+    free(old.keys);
+    free(old.values);
+    return true;
+}
+
+/*
+ * Make room for 'len' more bytes at the end of the key arena.
+ *
+ * When the arena is full, the live keys are copied into a new arena at least
+ * twice their size plus 'len', leaving the dead bytes of deleted keys behind,
+ * and each slot's offset is updated.  Return whether there is room.
+ */
+static bool ohashmap_arena_reserve(struct ohashmap *m, const size_t len) {
+    if (m->arena_size - m->arena_used >= len) {
+        return true;
+    }
+    const size_t live = m->arena_used - m->arena_dead;
+    size_t size = m->arena_size ? m->arena_size : OHASHMAP_ARENA_INIT;
+    while (size < 2 * (live + len)) {
+        size *= 2;
+    }
+    char *arena = malloc(size);
+    if (!arena) {
+        return false;
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < m->size; i++) {
+        if (m->hashes[i]) {
+            const char *key = &m->arena[m->keys[i]];
+            const size_t n = strlen(key) + 1;
+            memcpy(&arena[used], key, n);
+            m->keys[i] = used;
+            used += n;
+        }
+    }
+    free(m->arena);
+    m->arena = arena;
+    m->arena_size = size;
+    m->arena_used = used;
+    m->arena_dead = 0;
+    return true;
+}
+
+bool ohashmap_exists(const struct ohashmap *m, const char *k) {
+    return ohashmap_find(m, k, ohashmap_hash(k)) >= 0;
+}
+
+/*
+ * Set key 'k' to value 'v' in hashmap 'm'.
+ *
+ * If an entry for the given key already exists, it takes the new value and
+ * the data pointed to by the old value is freed.  Otherwise, a new entry is
+ * created.
+ *
+ * 'v' must point to alloc'd memory.  When the map is destroyed, the data
+ * pointed to by 'v' will be freed also.
+ *
+ * Return whether the entry was set successfully.
+ */
+bool ohashmap_set(struct ohashmap *m, const char *k, void *v) {
+    if (!m || !k || !v) {
+        return false;
+    }
+    const unsigned long h = ohashmap_hash(k);
+    long i = ohashmap_find(m, k, h);
+    if (i >= 0) {
+        if (m->values[i] != v) {
+            free(m->values[i]);
+        }
+        m->values[i] = v;
+        return true;
+    }
+
+    if ((size_t) (m->count + 1) * OHASHMAP_MAX_LOAD_DEN >
+            (size_t) m->size * OHASHMAP_MAX_LOAD_NUM) {
+        if (m->size >= OHASHMAP_MAX_SIZE ||
+                !ohashmap_resize(m, (size_t) m->size * 2)) {
+            if (m->count + 1 >= m->size) {
+                return false;
+            }
+        }
+    }
+
+    const size_t len = strlen(k) + 1;
+    if (!ohashmap_arena_reserve(m, len)) {
+        return false;
+    }
+    const size_t key = m->arena_used;
+    memcpy(&m->arena[key], k, len);
+    m->arena_used += len;
+    ohashmap_place(m, h, key, v);
+    m->count++;
+    return true;
+}
+
+/*
+ * Return the value for key 'k' in hashmap 'm'.
+ *
+ * If the key does not exist in the map, return a NULL pointer.
+ */
+void *ohashmap_get(const struct ohashmap *m, const char *k) {
+    long i = ohashmap_find(m, k, ohashmap_hash(k));
+    if (i < 0) {
+        return 0;
+    }
+    return m->values[i];
+}
+
+/*
+ * Delete the entry for 'k' from hashmap 'm'.
+ *
+ * Following entries are shifted back one slot until we reach an empty slot or
+ * an entry that is already in its home slot, so no tombstones are needed.
+ *
+ * Return whether an entry was deleted.
+ */
+bool ohashmap_delete(struct ohashmap *m, const char *k) {
+    if (!m || !k) {
+        return false;
+    }
+    long found = ohashmap_find(m, k, ohashmap_hash(k));
+    if (found < 0) {
+        return false;
+    }
+    const size_t mask = m->size - 1;
+    size_t i = (size_t) found;
+    m->arena_dead += strlen(&m->arena[m->keys[i]]) + 1;
+    free(m->values[i]);
+
+    size_t next = (i + 1) & mask;
+    while (m->hashes[next] && ohashmap_distance(m, next) > 0) {
+        m->hashes[i] = m->hashes[next];
+        m->keys[i] = m->keys[next];
+        m->values[i] = m->values[next];
+        i = next;
+        next = (next + 1) & mask;
+    }
+    m->hashes[i] = 0;
+    m->count--;
+    return true;
+}
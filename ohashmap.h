@@ -0,0 +1,34 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * An open-addressing hashmap using Robin Hood linear probing.
+ *
+ * Hashes, key offsets and values are kept in three parallel flat arrays, so a
+ * lookup walks contiguous memory instead of chasing entry pointers.  A stored
+ * hash of zero marks an empty slot.
+ *
+ * The keys themselves are packed one after another, NUL-terminated, into a
+ * single arena, and each slot holds its key's offset into the arena rather
+ * than a pointer to a separate allocation.  Deleting a key leaves its bytes
+ * dead in the arena until it next grows, when the live keys are compacted
+ * into the new one.
+ */
+struct ohashmap {
+    unsigned int size;
+    unsigned int count;
+    unsigned long *hashes;
+    size_t *keys;
+    void **values;
+    char *arena;
+    size_t arena_size;
+    size_t arena_used;
+    size_t arena_dead;
+};
+
+struct ohashmap *ohashmap_create();
+void ohashmap_destroy(struct ohashmap *);
+bool ohashmap_set(struct ohashmap *, const char *, void *);
+void *ohashmap_get(const struct ohashmap *, const char *);
+bool ohashmap_delete(struct ohashmap *, const char *);
+bool ohashmap_exists(const struct ohashmap *, const char *);
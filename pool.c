@@ -0,0 +1,164 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "./pool.h"
+
+/*
+ * Workers sleep on 'work' until 'job' moves on from the last job they ran,
+ * then claim tasks from 'next' until there are none left.  The last worker
+ * to finish wakes the thread in pool_run() through 'done'.
+ */
+struct pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    pthread_mutex_t run;
+    unsigned long job;
+    bool stop;
+    void (*fn)(void *, int);
+    void *arg;
+    int tasks;
+    atomic_int next;
+    int busy;
+    int threads;
+    pthread_t workers[];
+};
+
+/*
+ * Run tasks of the current job until none are left unclaimed.
+ */
+static void pool_work(struct pool *pool) {
+    int task;
+    while ((task = atomic_fetch_add(&pool->next, 1)) < pool->tasks) {
+        pool->fn(pool->arg, task);
+    }
+}
+
+static void *pool_worker(void *p) {
+    struct pool *pool = p;
+    unsigned long job = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->job == job) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+        pool_work(pool);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+/*
+ * Stop the first 'n' workers of 'pool', wait for them to exit and free the
+ * pool.
+ */
+static void pool_stop(struct pool *pool, int n) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < n; i++) {
+        pthread_join(pool->workers[i], 0);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+    pthread_mutex_destroy(&pool->run);
+    free(pool);
+}
+
+/*
+ * Create a pool that runs jobs on 'threads' threads, starting 'threads - 1'
+ * workers.  Return a pointer to the pool, or NULL if 'threads' is less than
+ * one or the workers cannot be started.
+ */
+struct pool *pool_create(int threads) {
+    if (threads < 1) {
+        return 0;
+    }
+    struct pool *pool = malloc(sizeof *pool +
+            (threads - 1) * sizeof pool->workers[0]);
+    if (!pool) {
+        return 0;
+    }
+    pthread_mutex_init(&pool->lock, 0);
+    pthread_cond_init(&pool->work, 0);
+    pthread_cond_init(&pool->done, 0);
+    pthread_mutex_init(&pool->run, 0);
+    pool->job = 0;
+    pool->stop = false;
+    pool->fn = 0;
+    pool->arg = 0;
+    pool->tasks = 0;
+    atomic_init(&pool->next, 0);
+    pool->busy = 0;
+    pool->threads = threads;
+    for (int i = 0; i < threads - 1; i++) {
+        if (pthread_create(&pool->workers[i], 0, pool_worker, pool)) {
+            pool_stop(pool, i);
+            return 0;
+        }
+    }
+    return pool;
+}
+
+/*
+ * Stop the workers and free the pool.  No job may be running on it.
+ */
+void pool_destroy(struct pool *pool) {
+    if (pool) {
+        pool_stop(pool, pool->threads - 1);
+    }
+}
+
+/*
+ * Return the number of threads that run a job on 'pool', counting the
+ * calling thread.
+ */
+int pool_size(const struct pool *pool) {
+    return pool ? pool->threads : 1;
+}
+
+/*
+ * Run fn(arg, task) for each 'task' from zero up to 'tasks', spread across
+ * the pool's threads, and return once every task has finished.  Tasks may
+ * run in any order and at the same time as each other.
+ */
+void pool_run(struct pool *pool, void (*fn)(void *arg, int task), void *arg,
+        int tasks) {
+    if (!pool || pool->threads == 1 || tasks <= 1) {
+        for (int i = 0; i < tasks; i++) {
+            fn(arg, i);
+        }
+        return;
+    }
+    pthread_mutex_lock(&pool->run);
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->tasks = tasks;
+    atomic_store(&pool->next, 0);
+    pool->busy = pool->threads - 1;
+    pool->job++;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    pool_work(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->run);
+}
@@ -0,0 +1,25 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*
+ * A reusable pool of worker threads for data-parallel jobs.
+ *
+ * A job is a number of tasks, numbered from zero, and a function to run
+ * each of them.  pool_run() hands the tasks out to the workers and to the
+ * calling thread, a task at a time, and returns once they are all done.  The
+ * workers stay alive between jobs, waiting for the next one, until the pool
+ * is destroyed.
+ *
+ * A pool of 'threads' threads runs jobs on the calling thread and
+ * 'threads - 1' workers.  A NULL pool runs every job on the calling thread.
+ * Jobs given to the same pool from several threads run one after another.
+ */
+struct pool;
+
+struct pool *pool_create(int threads);
+void pool_destroy(struct pool *pool);
+int pool_size(const struct pool *pool);
+void pool_run(struct pool *pool, void (*fn)(void *arg, int task), void *arg,
+        int tasks);
+
+#endif
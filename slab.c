@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include "./slab.h"
+
+#define SLAB_BLOCK_SIZE 65536
+
+/*
+ * Blocks are chained together so they can all be released at once.  The
+ * header is padded out to SLAB_ALIGN so the objects that follow it stay
+ * aligned.
+ */
+struct slab_block {
+    struct slab_block *next;
+};
+
+#define SLAB_HEADER_SIZE \
+    ((sizeof (struct slab_block) + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN)
+
+struct slab *slab_create() {
+    struct slab *s = malloc(sizeof *s);
+    if (!s) {
+        return 0;
+    }
+    s->blocks = 0;
+    s->cursor = 0;
+    s->avail = 0;
+    for (size_t i = 0; i < SLAB_CLASSES; i++) {
+        s->free[i] = 0;
+    }
+    return s;
+}
+
+/*
+ * Release every block owned by slab 's', and the slab itself.
+ *
+ * Objects allocated from the slab do not need to be freed individually first,
+ * except for those larger than SLAB_MAX_SIZE.
+ */
+void slab_destroy(struct slab *s) {
+    if (!s) {
+        return;
+    }
+    struct slab_block *b = s->blocks;
+    struct slab_block *next;
+    while (b) {
+        next = b->next;
+        free(b);
+        b = next;
+    }
+    free(s);
+}
+
+/*
+ * Return the index of the size class for objects of 'size' bytes.
+ */
+static inline size_t slab_class(const size_t size) {
+    return size ? (size - 1) / SLAB_ALIGN : 0;
+}
+
+/*
+ * Allocate an object of 'size' bytes from slab 's'.
+ *
+ * Return a pointer aligned to SLAB_ALIGN bytes, or NULL on failure.
+ */
+void *slab_alloc(struct slab *s, const size_t size) {
+    if (size > SLAB_MAX_SIZE) {
+        return malloc(size);
+    }
+    const size_t c = slab_class(size);
+    void *p = s->free[c];
+    if (p) {
+        s->free[c] = *(void **) p;
+        return p;
+    }
+
+    const size_t bytes = (c + 1) * SLAB_ALIGN;
+    if (s->avail < bytes) {
+        /*
+         * The tail of the current block is too small for this class.  It is
+         * always a whole number of SLAB_ALIGN units, so put it on the free
+         * list of the class it does fit, then start a new block.
+         */
+        if (s->avail) {
+            const size_t tc = slab_class(s->avail);
+            *(void **) s->cursor = s->free[tc];
+            s->free[tc] = s->cursor;
+        }
+        struct slab_block *b = malloc(SLAB_BLOCK_SIZE);
+        if (!b) {
+            return 0;
+        }
+        b->next = s->blocks;
+        s->blocks = b;
+        s->cursor = (char *) b + SLAB_HEADER_SIZE;
+        s->avail = SLAB_BLOCK_SIZE - SLAB_HEADER_SIZE;
+    }
+    p = s->cursor;
+    s->cursor += bytes;
+    s->avail -= bytes;
+    return p;
+}
+
+/*
+ * Return object 'p', which was allocated with 'size' bytes, to slab 's'.
+ */
+void slab_free(struct slab *s, void *p, const size_t size) {
+    if (!p) {
+        return;
+    }
+    if (size > SLAB_MAX_SIZE) {
+        free(p);
+        return;
+    }
+    const size_t c = slab_class(size);
+    *(void **) p = s->free[c];
+    s->free[c] = p;
+}
@@ -0,0 +1,27 @@
+#include <stddef.h>
+
+/*
+ * A size-class allocator for many small objects belonging to one owner.
+ *
+ * Objects are carved out of large blocks, and freed objects are kept on a
+ * free list for their size class so later allocations can reuse them.  Every
+ * block is released at once when the slab is destroyed.  Objects larger than
+ * SLAB_MAX_SIZE bypass the slab and go straight to malloc()/free().
+ */
+#define SLAB_ALIGN 16
+#define SLAB_CLASSES 16
+#define SLAB_MAX_SIZE (SLAB_ALIGN * SLAB_CLASSES)
+
+struct slab_block;
+
+struct slab {
+    struct slab_block *blocks;
+    char *cursor;
+    size_t avail;
+    void *free[SLAB_CLASSES];
+};
+
+struct slab *slab_create();
+void slab_destroy(struct slab *);
+void *slab_alloc(struct slab *, const size_t size);
+void slab_free(struct slab *, void *p, const size_t size);
@@ -1,11 +1,158 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <limits.h>
 #include <ctype.h>
 #include <errno.h>
+#include <pthread.h>
 #include "slisti.h"
+#include "vec.h"
+#include "pool.h"
+
+/*
+ * Cells are carved out of blocks of SLISTI_BLOCK_SIZE bytes, aligned to their
+ * size, so that the block a cell belongs to can be found from its address.
+ * The first cell-sized slot of each block holds its header.
+ *
+ * Each thread carves cells from a block of its own, in address order, so a
+ * list built in one go lies contiguously in memory, and taking a cell is a
+ * pointer bump with no locking.  A block counts its live cells, and is freed
+ * as soon as that reaches zero.  Every cell in a block is counted as live
+ * from the start, plus one for the thread carving it, so carving needs no
+ * atomics; the thread lets go of its count when it moves on to a new block.
+ *
+ * Cells freed one at a time, by a delete, are kept in a small per-thread
+ * cache for slisti_create() to reuse, but only if they come from the block
+ * the thread is carving.  That block is held by the thread anyway, so the
+ * cache never keeps an otherwise empty block alive; the cached cells go back
+ * with the thread's own count when it moves on.  Other cells, and whole
+ * lists, go straight back to their blocks, with one atomic update per run of
+ * cells from the same block.
+ */
+#define SLISTI_BLOCK_SIZE 65536
+#define SLISTI_BLOCK_CELLS (SLISTI_BLOCK_SIZE / sizeof (struct slisti) - 1)
+#define SLISTI_CACHE_SIZE 64
+
+struct slisti_block {
+    atomic_long live;
+};
+
+struct slisti_cache {
+    struct slisti_block *block;
+    struct slisti *next;
+    struct slisti *end;
+    struct slisti *free;
+    int nfree;
+};
+
+static _Thread_local struct slisti_cache slisti_cache;
+static pthread_key_t slisti_key;
+static pthread_once_t slisti_once = PTHREAD_ONCE_INIT;
+
+static void slisti_cache_flush(struct slisti_cache *c);
+
+/*
+ * Give back the calling thread's cells and block when it exits.
+ */
+static void slisti_thread_exit(void *p) {
+    slisti_cache_flush(p);
+}
+
+static void slisti_cells_init(void) {
+    pthread_key_create(&slisti_key, slisti_thread_exit);
+}
+
+static inline struct slisti_block *slisti_block(const struct slisti *cell) {
+    return (struct slisti_block *)
+        ((uintptr_t) cell & ~(uintptr_t) (SLISTI_BLOCK_SIZE - 1));
+}
+
+/*
+ * Drop 'n' live cells from block 'b', and free it if none are left.
+ */
+static void slisti_block_release(struct slisti_block *b, const long n) {
+    if(atomic_fetch_sub_explicit(&b->live, n, memory_order_acq_rel) == n) {
+        free(b);
+    }
+}
+
+/*
+ * Start carving cells for cache 'c' from a new block, letting go of the one
+ * it has used up.  Return false on failure.
+ */
+static bool slisti_cache_refill(struct slisti_cache *c) {
+    struct slisti_block *b = aligned_alloc(SLISTI_BLOCK_SIZE,
+            SLISTI_BLOCK_SIZE);
+    if(!b) {
+        return false;
+    }
+    atomic_init(&b->live, SLISTI_BLOCK_CELLS + 1);
+    if(c->block) {
+        slisti_block_release(c->block, c->nfree + 1);
+        c->free = 0;
+        c->nfree = 0;
+    } else {
+        pthread_once(&slisti_once, slisti_cells_init);
+        pthread_setspecific(slisti_key, c);
+    }
+    c->block = b;
+    c->next = (struct slisti *) b + 1;
+    c->end = c->next + SLISTI_BLOCK_CELLS;
+    return true;
+}
+
+/*
+ * Give back the cells cached by 'c', and the rest of the block it is carving.
+ */
+static void slisti_cache_flush(struct slisti_cache *c) {
+    if(c->block) {
+        slisti_block_release(c->block, c->nfree + (c->end - c->next) + 1);
+    }
+    c->free = 0;
+    c->nfree = 0;
+    c->block = 0;
+    c->next = 0;
+    c->end = 0;
+}
+
+/*
+ * Return the next fresh cell from the calling thread's block, or NULL on
+ * failure.
+ */
+static inline struct slisti *slisti_carve(void) {
+    struct slisti_cache *c = &slisti_cache;
+    if(c->next == c->end && !slisti_cache_refill(c)) {
+        return 0;
+    }
+    return c->next++;
+}
+
+/*
+ * Free a single cell, keeping it for reuse if it comes from the block the
+ * thread is carving and the thread's cache has room.
+ */
+static void slisti_free(struct slisti *cell) {
+    struct slisti_cache *c = &slisti_cache;
+    if(slisti_block(cell) == c->block && c->nfree < SLISTI_CACHE_SIZE) {
+        cell->next = c->free;
+        c->free = cell;
+        c->nfree++;
+        return;
+    }
+    slisti_block_release(slisti_block(cell), 1);
+}
+
+/*
+ * Give back the calling thread's cached cells and the unused part of its
+ * current block.  Threads do this by themselves when they exit; a thread that
+ * is done with lists for a while can call it to let go of its memory sooner.
+ */
+void slisti_cells_flush(void) {
+    slisti_cache_flush(&slisti_cache);
+}
 
 /*
  * Return the number of elements in the list.
@@ -27,8 +174,14 @@ int slisti_length(const struct slisti *list) {
  * to the new cell, or NULL on failure.
  */
 struct slisti *slisti_create(const int value) {
-    struct slisti *cell;
-    cell = malloc(sizeof *cell);
+    struct slisti_cache *c = &slisti_cache;
+    struct slisti *cell = c->free;
+    if(cell) {
+        c->free = cell->next;
+        c->nfree--;
+    } else {
+        cell = slisti_carve();
+    }
     if(cell) {
         cell->next = 0;
         cell->value = value;
@@ -36,43 +189,133 @@ struct slisti *slisti_create(const int value) {
     return cell;
 }
 
+/*
+ * Add a new cell with the given value to the end of 'list', keeping its tail
+ * and length up to date.  Return a pointer to the new cell, or NULL on
+ * failure.
+ */
+static struct slisti *slisti_push(struct slisti_list *list, const int value) {
+    struct slisti *cell = slisti_carve();
+    if(!cell) {
+        return 0;
+    }
+    cell->next = 0;
+    cell->value = value;
+    if(list->tail) {
+        list->tail->next = cell;
+    } else {
+        list->head = cell;
+    }
+    list->tail = cell;
+    list->length++;
+    return cell;
+}
+
+/*
+ * Return the cells of 'list' built by one of the slisti_build_*() functions
+ * below, or destroy them and return NULL if 'ok' is false.
+ */
+static struct slisti *slisti_built(struct slisti_list *list, bool ok) {
+    if(!ok) {
+        slisti_destroy(list->head);
+        return 0;
+    }
+    return list->head;
+}
+
+/*
+ * As slisti_built(), but for a list handle allocated by slisti_list_create().
+ */
+static struct slisti_list *slisti_list_built(
+        struct slisti_list *list,
+        bool ok) {
+    if(!ok) {
+        slisti_list_destroy(list);
+        return 0;
+    }
+    return list;
+}
+
+/*
+ * Add 'num' new cells to the end of 'list', in runs carved from the calling
+ * thread's block.  Return the first of them, or NULL on failure (or if 'num'
+ * is zero), in which case some cells may have been added.  The new cells'
+ * values are left for the caller to fill in.
+ */
+static struct slisti *slisti_run(struct slisti_list *list, int num) {
+    struct slisti_cache *c = &slisti_cache;
+    struct slisti *first = 0;
+    while(num > 0) {
+        if(c->next == c->end && !slisti_cache_refill(c)) {
+            return 0;
+        }
+        int n = c->end - c->next < num ? c->end - c->next : num;
+        struct slisti *cell = c->next;
+        c->next += n;
+        for(int i = 0; i < n - 1; i++) {
+            cell[i].next = &cell[i + 1];
+        }
+        cell[n - 1].next = 0;
+        if(list->tail) {
+            list->tail->next = cell;
+        } else {
+            list->head = cell;
+        }
+        if(!first) {
+            first = cell;
+        }
+        list->tail = &cell[n - 1];
+        list->length += n;
+        num -= n;
+    }
+    return first;
+}
+
+static bool slisti_build_array(
+        struct slisti_list *list,
+        const int input[],
+        const int num) {
+    struct slisti *cell = slisti_run(list, num);
+    if(!cell) {
+        return num <= 0;
+    }
+    for(int i = 0; i < num; i++, cell = cell->next) {
+        cell->value = input[i];
+    }
+    return true;
+}
+
 /*
  * Create a new list with values from the first 'num' elements of 'input'.
  *
  * Return a pointer to the first cell of the new list, or NULL on failure.
  */
 struct slisti *slisti_from_array(const int input[], const int num) {
-    struct slisti *head = 0;
-    struct slisti *tail = 0;
-    struct slisti *cell = 0;
-    for(int i = 0; i < num; i++) {
-        cell = slisti_create(input[i]);
-        if(!head) {
-            head = cell;
-        }
-        if(tail) {
-            tail->next = cell;
-        }
-        tail = cell;
-    }
-    return head;
+    struct slisti_list list = {0, 0, 0};
+    return slisti_built(&list, slisti_build_array(&list, input, num));
 }
 
 /*
  * Unallocate all cells in the given slisti.
+ *
+ * Consecutive cells from the same block are given back to it together, so a
+ * list built in one go goes back a block at a time.
  */
 void slisti_destroy(struct slisti *list) {
-    if(!list) {
-        return;
+    struct slisti_block *block = 0;
+    long n = 0;
+    for(; list; list = list->next) {
+        if(slisti_block(list) != block) {
+            if(block) {
+                slisti_block_release(block, n);
+            }
+            block = slisti_block(list);
+            n = 0;
+        }
+        n++;
     }
-    struct slisti *next = list->next;
-    free(list);
-    list = 0;
-    while(next) {
-        list = next;
-        next = list->next;
-        free(list);
-        list = 0;
+    if(block) {
+        slisti_block_release(block, n);
     }
 }
 
@@ -103,16 +346,12 @@ struct slisti *slisti_append(struct slisti *list, int value) {
  * Return a NULL pointer if the requested position does not exist in the list.
  */
 struct slisti *slisti_get(struct slisti *list, int pos) {
-    int len = slisti_length(list);
     if(pos < 0) {
-        pos += len;
+        pos += slisti_length(list);
         if(pos < 0) {
             return 0;
         }
     }
-    if(pos >= len) {
-        return 0;
-    }
     for(int i = 0; list; list = list->next, i++) {
         if(i == pos) {
             return list;
@@ -218,7 +457,7 @@ struct slisti *slisti_delete(struct slisti *list, int pos) {
             } else {
                 list = cell->next;
             }
-            free(cell);
+            slisti_free(cell);
             return list;
         }
         prev = cell;
@@ -226,6 +465,19 @@ struct slisti *slisti_delete(struct slisti *list, int pos) {
     return list;
 }
 
+static bool slisti_build_slice(
+        struct slisti_list *list,
+        const struct slisti *source,
+        const int start,
+        const int end) {
+    for(int i = 0; i < end && source; i++, source = source->next) {
+        if(i >= start && !slisti_push(list, source->value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /*
  * Extract a slice from the given list.
  *
@@ -243,32 +495,32 @@ struct slisti *slisti_slice(const struct slisti *source, int start, int end) {
     if(!source){
         return 0;
     }
-    int length = slisti_length(source);
-    if(start < 0) {
-        start += length;
-    }
-    if(end < 0) {
-        end += length;
+    if(start < 0 || end < 0) {
+        int length = slisti_length(source);
+        if(start < 0) {
+            start += length;
+        }
+        if(end < 0) {
+            end += length;
+        }
     }
     if(end <= start) {
         return 0;
     }
-    struct slisti *head = 0;
-    struct slisti *tail = 0;
-    struct slisti *cell = 0;
-    for(int i = 0; i < end && source; i++, source = source->next) {
-        if(i >= start) {
-            cell = slisti_create(source->value);
-            if(!head) {
-                head = cell;
-            }
-            if(tail) {
-                tail->next = cell;
-            }
-            tail = cell;
+    struct slisti_list list = {0, 0, 0};
+    return slisti_built(&list, slisti_build_slice(&list, source, start, end));
+}
+
+static bool slisti_build_map(
+        struct slisti_list *list,
+        const struct slisti *source,
+        int (*fn)(int)) {
+    for(; source; source = source->next) {
+        if(!slisti_push(list, fn(source->value))) {
+            return false;
         }
     }
-    return head;
+    return true;
 }
 
 /*
@@ -278,24 +530,23 @@ struct slisti *slisti_slice(const struct slisti *source, int start, int end) {
  * element from the source list, and returns the desired integer to be added to
  * the destination list.
  *
- * Return a pointer to the first cell of the new slisti.
+ * Return a pointer to the first cell of the new slisti, or NULL on failure.
  */
 struct slisti *slisti_map(const struct slisti *source, int (*fn)(int)) {
-    struct slisti *head = 0;
-    struct slisti *tail = 0;
-    struct slisti *cell = 0;
-    while(source) {
-        cell = slisti_create(fn(source->value));
-        if(!head) {
-            head = cell;
-        }
-        if(tail) {
-            tail->next = cell;
+    struct slisti_list list = {0, 0, 0};
+    return slisti_built(&list, slisti_build_map(&list, source, fn));
+}
+
+static bool slisti_build_filter(
+        struct slisti_list *list,
+        const struct slisti *source,
+        bool (*fn)(int)) {
+    for(; source; source = source->next) {
+        if(fn(source->value) && !slisti_push(list, source->value)) {
+            return false;
         }
-        tail = cell;
-        source = source->next;
     }
-    return head;
+    return true;
 }
 
 /*
@@ -305,26 +556,11 @@ struct slisti *slisti_map(const struct slisti *source, int (*fn)(int)) {
  * element from the source list, and returns a boolean to indicate whether that
  * element ought to be included in the result list.
  *
- * Return a pointer to the first cell of the new slisti.
+ * Return a pointer to the first cell of the new slisti, or NULL on failure.
  */
 struct slisti *slisti_filter(const struct slisti *source, bool (*fn)(int)) {
-    struct slisti *head = 0;
-    struct slisti *tail = 0;
-    struct slisti *cell = 0;
-    while(source) {
-        if(fn(source->value)) {
-            cell = slisti_create(source->value);
-            if(!head) {
-                head = cell;
-            }
-            if(tail) {
-                tail->next = cell;
-            }
-            tail = cell;
-        }
-        source = source->next;
-    }
-    return head;
+    struct slisti_list list = {0, 0, 0};
+    return slisti_built(&list, slisti_build_filter(&list, source, fn));
 }
 
 /*
@@ -344,12 +580,84 @@ int slisti_reduce(const struct slisti *source, int (*fn)(int, int)) {
 }
 
 /*
- * Return the given list formatted as compact JSON.
- *
- * The result is a newly malloc'd string.  It is the caller's responsibility to
- * free the string.
+ * The built-in operations below run as SIMD kernels (see vec.h), on runs of
+ * up to SLISTI_RUN values at a time copied out of the cells into an array.
  */
-char *slisti_to_json(const struct slisti *list) {
+#define SLISTI_RUN 256
+
+/*
+ * Copy the values of up to SLISTI_RUN cells, starting at '*source', to 'buf'
+ * and move '*source' past them.  Return how many values were copied.
+ */
+static size_t slisti_gather(const struct slisti **source, int buf[]) {
+    const struct slisti *cell = *source;
+    size_t n = 0;
+    for(; cell && n < SLISTI_RUN; cell = cell->next) {
+        buf[n++] = cell->value;
+    }
+    *source = cell;
+    return n;
+}
+
+/*
+ * Return the sum of the elements in 'list'.  The sum is kept in a long long,
+ * so it cannot overflow.
+ */
+long long slisti_sum(const struct slisti *list) {
+    int buf[SLISTI_RUN];
+    long long sum = 0;
+    while(list) {
+        const size_t n = slisti_gather(&list, buf);
+        sum += vec_sum(buf, n);
+    }
+    return sum;
+}
+
+/*
+ * Return the least element in 'list', or INT_MAX if the list is empty.
+ */
+int slisti_min(const struct slisti *list) {
+    int buf[SLISTI_RUN];
+    int min = INT_MAX;
+    while(list) {
+        const size_t n = slisti_gather(&list, buf);
+        const int value = vec_min(buf, n);
+        min = value < min ? value : min;
+    }
+    return min;
+}
+
+/*
+ * Return the greatest element in 'list', or INT_MIN if the list is empty.
+ */
+int slisti_max(const struct slisti *list) {
+    int buf[SLISTI_RUN];
+    int max = INT_MIN;
+    while(list) {
+        const size_t n = slisti_gather(&list, buf);
+        const int value = vec_max(buf, n);
+        max = value > max ? value : max;
+    }
+    return max;
+}
+
+/*
+ * Return the number of elements in 'list' equal to 'value'.
+ */
+int slisti_count(const struct slisti *list, int value) {
+    int buf[SLISTI_RUN];
+    int count = 0;
+    while(list) {
+        const size_t n = slisti_gather(&list, buf);
+        count += vec_count(buf, n, value);
+    }
+    return count;
+}
+
+/*
+ * Return the 'length' cells starting at 'list' formatted as compact JSON.
+ */
+static char *slisti_json(const struct slisti *list, const int length) {
     /*
      * Get number of bytes needed to write the longest int value.  Assume it's
      * not more than 64 bytes.
@@ -357,7 +665,6 @@ char *slisti_to_json(const struct slisti *list) {
     int LEN = 64;
     char buf[LEN];
     int int_size = snprintf(buf, LEN, "%d", INT_MIN);
-    int length = slisti_length(list);
 
     /*
      * All integers in the list, plus comma delimiters, plus surrounding square
@@ -379,25 +686,31 @@ char *slisti_to_json(const struct slisti *list) {
 }
 
 /*
- * Return a pointer to a new list built from nul-terminated JSON ASCII text.
+ * Return the given list formatted as compact JSON.
  *
- * The JSON text must decode to a single flat list of integers.  If the JSON
- * text does not represent a list, or if the list is empty, or if any of the
- * list's elements cannot be converted to an int, return a NULL pointer.
+ * The result is a newly malloc'd string.  It is the caller's responsibility to
+ * free the string.
  */
-struct slisti *slisti_from_json(const char *json) {
+char *slisti_to_json(const struct slisti *list) {
+    return slisti_json(list, slisti_length(list));
+}
+
+static bool slisti_build_json(struct slisti_list *list, const char *json) {
     /* Skip whitespace */
     while(isspace(*json)) {
         json++;
     }
 
     if(*(json++) != '[') {
-        return 0;
+        return false;
+    }
+    while(isspace(*json)) {
+        json++;
+    }
+    if(*json == ']') {
+        return true;
     }
 
-    struct slisti *head = 0;
-    struct slisti *tail = 0;
-    struct slisti *cell = 0;
     char *pos = 0;
     long int value;
     while(*json != '\0') {
@@ -407,24 +720,819 @@ struct slisti *slisti_from_json(const char *json) {
             break;
         }
         json = pos;
-        cell = slisti_create((int) value);
-        if(!head) {
-            head = cell;
-        }
-        if(tail) {
-            tail->next = cell;
+        if(!slisti_push(list, (int) value)) {
+            break;
         }
-        tail = cell;
 
         while(isspace(*json)) {
             json++;
         }
         if(*json == ']') {
-            return head;
+            return true;
         } else if(*(json++) != ',') {
             break;
         }
     }
-    slisti_destroy(head);
-    return 0;
+    return false;
+}
+
+/*
+ * Return a pointer to a new list built from nul-terminated JSON ASCII text.
+ *
+ * The JSON text must decode to a single flat list of integers.  If the JSON
+ * text does not represent a list, or if the list is empty, or if any of the
+ * list's elements cannot be converted to an int, return a NULL pointer.
+ */
+struct slisti *slisti_from_json(const char *json) {
+    struct slisti_list list = {0, 0, 0};
+    return slisti_built(&list, slisti_build_json(&list, json));
+}
+
+/*
+ * Create a new, empty list handle.  Return a pointer to the handle, or NULL on
+ * failure.
+ */
+struct slisti_list *slisti_list_create(void) {
+    struct slisti_list *list = malloc(sizeof *list);
+    if(list) {
+        list->head = 0;
+        list->tail = 0;
+        list->length = 0;
+    }
+    return list;
+}
+
+/*
+ * Unallocate the given list handle and all of its cells.
+ */
+void slisti_list_destroy(struct slisti_list *list) {
+    if(!list) {
+        return;
+    }
+    slisti_destroy(list->head);
+    free(list);
+}
+
+/*
+ * Create a new list handle with values from the first 'num' elements of
+ * 'input'.  Return a pointer to the handle, or NULL on failure.
+ */
+struct slisti_list *slisti_list_from_array(const int input[], const int num) {
+    struct slisti_list *list = slisti_list_create();
+    return list ?
+        slisti_list_built(list, slisti_build_array(list, input, num)) : 0;
+}
+
+/*
+ * Return the number of elements in the list, without walking it.
+ */
+int slisti_list_length(const struct slisti_list *list) {
+    return list ? list->length : 0;
+}
+
+/*
+ * Append an integer to the end of the list as a new cell, without walking it.
+ * Return a pointer to the new cell created, or NULL on failure.
+ */
+struct slisti *slisti_list_append(struct slisti_list *list, int value) {
+    return list ? slisti_push(list, value) : 0;
+}
+
+/*
+ * Get the cell in 'list' at the given position, counted as for slisti_get().
+ * The last cell is found without walking the list.
+ *
+ * Return a NULL pointer if the requested position does not exist in the list.
+ */
+struct slisti *slisti_list_get(struct slisti_list *list, int pos) {
+    if(!list) {
+        return 0;
+    }
+    if(pos < 0) {
+        pos += list->length;
+    }
+    if(pos < 0 || pos >= list->length) {
+        return 0;
+    }
+    if(pos == list->length - 1) {
+        return list->tail;
+    }
+    return slisti_get(list->head, pos);
+}
+
+/*
+ * Return a pointer to the first cell in 'list' that contains 'value', or NULL
+ * if no such cell can be found.
+ */
+struct slisti *slisti_list_find(struct slisti_list *list, int value) {
+    return list ? slisti_find(list->head, value) : 0;
+}
+
+/*
+ * Insert an integer as a new cell into the list at the given position,
+ * counted and clamped as for slisti_insert().  Inserting at the end does not
+ * walk the list.
+ *
+ * Return a pointer to the new cell, or NULL on failure.
+ */
+struct slisti *slisti_list_insert(
+        struct slisti_list *list,
+        int pos,
+        int value) {
+    if(!list) {
+        return 0;
+    }
+    if(pos < 0) {
+        pos += list->length;
+        if(pos < 0) {
+            pos = 0;
+        }
+    }
+    if(pos >= list->length) {
+        return slisti_push(list, value);
+    }
+    struct slisti *new = slisti_create(value);
+    if(!new) {
+        return 0;
+    }
+    if(pos == 0) {
+        new->next = list->head;
+        list->head = new;
+    } else {
+        struct slisti *prev = slisti_get(list->head, pos - 1);
+        new->next = prev->next;
+        prev->next = new;
+    }
+    list->length++;
+    return new;
+}
+
+/*
+ * Delete the cell at the given position from the list, counted as for
+ * slisti_delete(), and free it.
+ *
+ * Return whether a cell was deleted.  If the requested position does not
+ * exist in the list, do nothing.
+ */
+bool slisti_list_delete(struct slisti_list *list, int pos) {
+    if(!list) {
+        return false;
+    }
+    if(pos < 0) {
+        pos += list->length;
+    }
+    if(pos < 0 || pos >= list->length) {
+        return false;
+    }
+    struct slisti *prev = pos ? slisti_get(list->head, pos - 1) : 0;
+    struct slisti *cell = prev ? prev->next : list->head;
+    if(prev) {
+        prev->next = cell->next;
+    } else {
+        list->head = cell->next;
+    }
+    if(list->tail == cell) {
+        list->tail = prev;
+    }
+    slisti_free(cell);
+    list->length--;
+    return true;
+}
+
+/*
+ * Extract a slice from the given list, with positions counted as for
+ * slisti_slice().
+ *
+ * Return a new list handle, which is empty if the requested range does not
+ * include any cells, or NULL on failure.
+ */
+struct slisti_list *slisti_list_slice(
+        const struct slisti_list *source,
+        int start,
+        int end) {
+    if(!source) {
+        return 0;
+    }
+    if(start < 0) {
+        start += source->length;
+    }
+    if(end < 0) {
+        end += source->length;
+    }
+    struct slisti_list *list = slisti_list_create();
+    if(!list || end <= start) {
+        return list;
+    }
+    return slisti_list_built(list,
+            slisti_build_slice(list, source->head, start, end));
+}
+
+/*
+ * Create a new list handle by applying a map function to each element in
+ * source, as for slisti_map().  Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_map(
+        const struct slisti_list *source,
+        int (*fn)(int)) {
+    struct slisti_list *list = source ? slisti_list_create() : 0;
+    return list ?
+        slisti_list_built(list, slisti_build_map(list, source->head, fn)) : 0;
+}
+
+/*
+ * Create a new list handle by applying a filter function to each element in
+ * source, as for slisti_filter().  Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_filter(
+        const struct slisti_list *source,
+        bool (*fn)(int)) {
+    struct slisti_list *list = source ? slisti_list_create() : 0;
+    return list ?
+        slisti_list_built(list, slisti_build_filter(list, source->head, fn)) :
+        0;
+}
+
+/*
+ * Return an integer by applying a reduce function to each element in source,
+ * as for slisti_reduce().
+ */
+int slisti_list_reduce(const struct slisti_list *source, int (*fn)(int, int)) {
+    return slisti_reduce(source ? source->head : 0, fn);
+}
+
+/*
+ * Return the given list formatted as compact JSON, as for slisti_to_json().
+ */
+char *slisti_list_to_json(const struct slisti_list *list) {
+    return list ? slisti_json(list->head, list->length) : slisti_to_json(0);
+}
+
+/*
+ * Return a new list handle built from nul-terminated JSON ASCII text, as for
+ * slisti_from_json(), except that an empty JSON list gives an empty list.
+ * Return a NULL pointer if the text is not a valid list of ints.
+ */
+struct slisti_list *slisti_list_from_json(const char *json) {
+    struct slisti_list *list = slisti_list_create();
+    return list ? slisti_list_built(list, slisti_build_json(list, json)) : 0;
+}
+
+static bool slisti_build_vec(
+        struct slisti_list *list,
+        const struct slisti *source,
+        const enum vec_op op,
+        const int a,
+        const int b) {
+    int buf[SLISTI_RUN];
+    while(source) {
+        size_t n = slisti_gather(&source, buf);
+        n = vec_apply(op, buf, buf, n, a, b);
+        struct slisti *cell = slisti_run(list, (int) n);
+        if(!cell && n) {
+            return false;
+        }
+        for(size_t i = 0; i < n; i++, cell = cell->next) {
+            cell->value = buf[i];
+        }
+    }
+    return true;
+}
+
+static struct slisti_list *slisti_list_vec(
+        const struct slisti_list *source,
+        const enum vec_op op,
+        const int a,
+        const int b) {
+    struct slisti_list *list = source ? slisti_list_create() : 0;
+    return list ?
+        slisti_list_built(list, slisti_build_vec(list, source->head, op, a, b))
+        : 0;
+}
+
+/*
+ * Create a new list handle with 'k' added to each element in source.
+ * Arithmetic wraps around on overflow.  Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_add(const struct slisti_list *source, int k) {
+    return slisti_list_vec(source, VEC_ADD, k, 0);
+}
+
+/*
+ * Create a new list handle with each element in source multiplied by 'k'.
+ * Arithmetic wraps around on overflow.  Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_mul(const struct slisti_list *source, int k) {
+    return slisti_list_vec(source, VEC_MUL, k, 0);
+}
+
+/*
+ * Create a new list handle with each element in source raised to 'lo' and
+ * then lowered to 'hi'.  Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_clamp(
+        const struct slisti_list *source,
+        int lo,
+        int hi) {
+    return slisti_list_vec(source, VEC_CLAMP, lo, hi);
+}
+
+/*
+ * Create a new list handle with the elements in source that are less than
+ * 'k', in order.  Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_filter_lt(
+        const struct slisti_list *source,
+        int k) {
+    return slisti_list_vec(source, VEC_LT, k, 0);
+}
+
+/*
+ * Create a new list handle with the elements in source that are greater than
+ * 'k', in order.  Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_filter_gt(
+        const struct slisti_list *source,
+        int k) {
+    return slisti_list_vec(source, VEC_GT, k, 0);
+}
+
+/*
+ * Create a new list handle with the elements in source that are equal to
+ * 'k'.  Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_filter_eq(
+        const struct slisti_list *source,
+        int k) {
+    return slisti_list_vec(source, VEC_EQ, k, 0);
+}
+
+/*
+ * Create a new list handle with the elements in source from 'lo' to 'hi'
+ * inclusive, in order.  Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_filter_range(
+        const struct slisti_list *source,
+        int lo,
+        int hi) {
+    return slisti_list_vec(source, VEC_RANGE, lo, hi);
+}
+
+/*
+ * The parallel functions below split a list into segments of consecutive
+ * cells, run a task for each segment on a pool, and join the results in
+ * order.  Finding where the segments start takes one walk along the list,
+ * which only follows the next pointers.  There are up to SLISTI_SEGMENTS
+ * segments for each thread of the pool, so that a thread which finishes
+ * early can take on another, but none shorter than SLISTI_SEGMENT_MIN cells.
+ * A list too short to split, or a pool of one thread, is processed on the
+ * calling thread without splitting it.
+ */
+#define SLISTI_SEGMENTS 4
+#define SLISTI_SEGMENT_MIN 4096
+
+struct slisti_segment {
+    const struct slisti *head;
+    int length;
+    struct slisti_list out;
+    int state;
+    bool ok;
+};
+
+struct slisti_job {
+    struct slisti_segment *segments;
+    int (*map)(int);
+    bool (*filter)(int);
+    int (*reduce)(int, int);
+    int identity;
+};
+
+/*
+ * Return the number of segments to split 'source' into for 'pool'.
+ */
+static int slisti_segment_count(
+        const struct slisti_list *source,
+        const struct pool *pool) {
+    const int threads = pool_size(pool);
+    const int most = source->length / SLISTI_SEGMENT_MIN;
+    const int n = threads > 1 ? threads * SLISTI_SEGMENTS : 1;
+    return n < most ? n : most;
+}
+
+/*
+ * Split 'source' into 'num' segments of nearly equal length.  Return an
+ * array of the segments, or NULL on failure.
+ */
+static struct slisti_segment *slisti_split(
+        const struct slisti_list *source,
+        const int num) {
+    struct slisti_segment *segments = calloc(num, sizeof *segments);
+    if(!segments) {
+        return 0;
+    }
+    const struct slisti *cell = source->head;
+    for(int i = 0; i < num; i++) {
+        segments[i].head = cell;
+        segments[i].length = source->length / num +
+            (i < source->length % num);
+        for(int j = 0; j < segments[i].length; j++) {
+            cell = cell->next;
+        }
+    }
+    return segments;
+}
+
+static void slisti_map_task(void *arg, int task) {
+    struct slisti_job *job = arg;
+    struct slisti_segment *s = &job->segments[task];
+    struct slisti *cell = slisti_run(&s->out, s->length);
+    s->ok = cell != 0;
+    const struct slisti *source = s->head;
+    for(; cell; cell = cell->next, source = source->next) {
+        cell->value = job->map(source->value);
+    }
+}
+
+static void slisti_filter_task(void *arg, int task) {
+    struct slisti_job *job = arg;
+    struct slisti_segment *s = &job->segments[task];
+    const struct slisti *source = s->head;
+    s->ok = true;
+    for(int i = 0; i < s->length; i++, source = source->next) {
+        const int value = source->value;
+        if(job->filter(value) && !slisti_push(&s->out, value)) {
+            s->ok = false;
+            return;
+        }
+    }
+}
+
+static void slisti_reduce_task(void *arg, int task) {
+    struct slisti_job *job = arg;
+    struct slisti_segment *s = &job->segments[task];
+    const struct slisti *source = s->head;
+    s->state = job->identity;
+    for(int i = 0; i < s->length; i++, source = source->next) {
+        s->state = job->reduce(s->state, source->value);
+    }
+}
+
+/*
+ * Join the output lists of the 'num' segments in order, in a new list
+ * handle, and free the segments.  If any segment failed, destroy all of the
+ * output lists and return NULL.
+ */
+static struct slisti_list *slisti_join(
+        struct slisti_segment *segments,
+        const int num) {
+    bool ok = true;
+    for(int i = 0; i < num; i++) {
+        ok = ok && segments[i].ok;
+    }
+    struct slisti_list *list = ok ? slisti_list_create() : 0;
+    for(int i = 0; i < num; i++) {
+        struct slisti_list *out = &segments[i].out;
+        if(!list) {
+            slisti_destroy(out->head);
+        } else if(out->head) {
+            if(list->tail) {
+                list->tail->next = out->head;
+            } else {
+                list->head = out->head;
+            }
+            list->tail = out->tail;
+            list->length += out->length;
+        }
+    }
+    free(segments);
+    return list;
+}
+
+/*
+ * Create a new list handle by applying a map function to each element in
+ * source, as for slisti_list_map(), with the work spread across the threads
+ * of 'pool'.  'fn' is called from several threads at once.
+ *
+ * Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_pmap(
+        const struct slisti_list *source,
+        int (*fn)(int),
+        struct pool *pool) {
+    if(!source) {
+        return 0;
+    }
+    const int num = slisti_segment_count(source, pool);
+    if(num <= 1) {
+        return slisti_list_map(source, fn);
+    }
+    struct slisti_job job = {slisti_split(source, num), fn, 0, 0, 0};
+    if(!job.segments) {
+        return 0;
+    }
+    pool_run(pool, slisti_map_task, &job, num);
+    return slisti_join(job.segments, num);
+}
+
+/*
+ * Create a new list handle by applying a filter function to each element in
+ * source, as for slisti_list_filter(), with the work spread across the
+ * threads of 'pool'.  'fn' is called from several threads at once.
+ *
+ * Return a NULL pointer on failure.
+ */
+struct slisti_list *slisti_list_pfilter(
+        const struct slisti_list *source,
+        bool (*fn)(int),
+        struct pool *pool) {
+    if(!source) {
+        return 0;
+    }
+    const int num = slisti_segment_count(source, pool);
+    if(num <= 1) {
+        return slisti_list_filter(source, fn);
+    }
+    struct slisti_job job = {slisti_split(source, num), 0, fn, 0, 0};
+    if(!job.segments) {
+        return 0;
+    }
+    pool_run(pool, slisti_filter_task, &job, num);
+    return slisti_join(job.segments, num);
+}
+
+/*
+ * Return an integer by applying a reduce function to each element in source,
+ * with the work spread across the threads of 'pool'.  'fn' is called from
+ * several threads at once.
+ *
+ * Each segment of the list is reduced separately, starting from 'identity',
+ * and the results for the segments are then reduced in order, again starting
+ * from 'identity'.  So 'fn' must be associative, and 'identity' must leave
+ * any value unchanged, for the result to be the same as for a single pass:
+ * for example, addition with 0, or taking the maximum with INT_MIN.  'fn'
+ * need not be commutative.
+ *
+ * Return 'identity' if the list is empty, or if the work cannot be split up
+ * for lack of memory.
+ */
+int slisti_list_preduce(
+        const struct slisti_list *source,
+        int (*fn)(int, int),
+        int identity,
+        struct pool *pool) {
+    if(!source) {
+        return identity;
+    }
+    const int num = slisti_segment_count(source, pool);
+    if(num <= 1) {
+        int state = identity;
+        for(const struct slisti *cell = source->head; cell;
+                cell = cell->next) {
+            state = fn(state, cell->value);
+        }
+        return state;
+    }
+    struct slisti_job job = {slisti_split(source, num), 0, 0, fn, identity};
+    if(!job.segments) {
+        return identity;
+    }
+    pool_run(pool, slisti_reduce_task, &job, num);
+    int state = identity;
+    for(int i = 0; i < num; i++) {
+        state = fn(state, job.segments[i].state);
+    }
+    free(job.segments);
+    return state;
+}
+
+/*
+ * Start a pipeline over the cells from 'source' onwards, in the storage at
+ * 'pipe'.  Return 'pipe', or NULL if it is NULL.
+ */
+struct slisti_pipe *slisti_pipe_init(
+        struct slisti_pipe *pipe,
+        const struct slisti *source) {
+    if(pipe) {
+        pipe->cell = source;
+        pipe->nstages = 0;
+    }
+    return pipe;
+}
+
+/*
+ * Add a stage of the given kind to the end of 'pipe'.  Return the new stage,
+ * or NULL if 'pipe' is NULL or has no room for it.
+ */
+static struct slisti_stage *slisti_pipe_add(
+        struct slisti_pipe *pipe,
+        const enum slisti_stage_kind kind) {
+    if(!pipe || pipe->nstages == SLISTI_PIPE_STAGES) {
+        return 0;
+    }
+    struct slisti_stage *stage = &pipe->stages[pipe->nstages++];
+    stage->kind = kind;
+    stage->map = 0;
+    stage->filter = 0;
+    stage->count = 0;
+    stage->seen = 0;
+    return stage;
+}
+
+/*
+ * Add a stage that replaces each value with the result of 'fn'.  Return
+ * 'pipe', or NULL on failure.
+ */
+struct slisti_pipe *slisti_pipe_map(struct slisti_pipe *pipe, int (*fn)(int)) {
+    struct slisti_stage *stage = slisti_pipe_add(pipe, SLISTI_STAGE_MAP);
+    if(!stage) {
+        return 0;
+    }
+    stage->map = fn;
+    return pipe;
+}
+
+/*
+ * Add a stage that passes on only the values for which 'fn' returns true.
+ * Return 'pipe', or NULL on failure.
+ */
+struct slisti_pipe *slisti_pipe_filter(
+        struct slisti_pipe *pipe,
+        bool (*fn)(int)) {
+    struct slisti_stage *stage = slisti_pipe_add(pipe, SLISTI_STAGE_FILTER);
+    if(!stage) {
+        return 0;
+    }
+    stage->filter = fn;
+    return pipe;
+}
+
+/*
+ * Add a stage that drops the first 'num' values that reach it.  Return
+ * 'pipe', or NULL on failure.
+ */
+struct slisti_pipe *slisti_pipe_skip(struct slisti_pipe *pipe, int num) {
+    struct slisti_stage *stage = slisti_pipe_add(pipe, SLISTI_STAGE_SKIP);
+    if(!stage) {
+        return 0;
+    }
+    stage->count = num > 0 ? num : 0;
+    return pipe;
+}
+
+/*
+ * Add a stage that passes on the first 'num' values that reach it, and then
+ * ends the pipeline.  Return 'pipe', or NULL on failure.
+ */
+struct slisti_pipe *slisti_pipe_take(struct slisti_pipe *pipe, int num) {
+    struct slisti_stage *stage = slisti_pipe_add(pipe, SLISTI_STAGE_TAKE);
+    if(!stage) {
+        return 0;
+    }
+    stage->count = num;
+    if(num <= 0) {
+        pipe->cell = 0;
+    }
+    return pipe;
+}
+
+/*
+ * Add stages that pass on the values that reach them from position 'start'
+ * up to (but not including) position 'end', counted from zero.  Unlike
+ * slisti_slice(), the positions cannot be negative, since the pipeline does
+ * not know how many values are still to come.
+ *
+ * Return 'pipe', or NULL on failure or if either position is negative.
+ */
+struct slisti_pipe *slisti_pipe_slice(
+        struct slisti_pipe *pipe,
+        int start,
+        int end) {
+    if(start < 0 || end < 0) {
+        return 0;
+    }
+    return slisti_pipe_take(slisti_pipe_skip(pipe, start), end - start);
+}
+
+/*
+ * Pull the next value through 'pipe' into 'value'.  Return false once there
+ * are no more values, or if 'pipe' is NULL.
+ */
+bool slisti_pipe_next(struct slisti_pipe *pipe, int *value) {
+    if(!pipe) {
+        return false;
+    }
+    while(pipe->cell) {
+        int v = pipe->cell->value;
+        pipe->cell = pipe->cell->next;
+        bool pass = true;
+        for(int i = 0; pass && i < pipe->nstages; i++) {
+            struct slisti_stage *stage = &pipe->stages[i];
+            switch(stage->kind) {
+                case SLISTI_STAGE_MAP:
+                    v = stage->map(v);
+                    break;
+                case SLISTI_STAGE_FILTER:
+                    pass = stage->filter(v);
+                    break;
+                case SLISTI_STAGE_SKIP:
+                    pass = stage->seen == stage->count;
+                    stage->seen += !pass;
+                    break;
+                case SLISTI_STAGE_TAKE:
+                    /* Nothing gets past this stage after this value */
+                    if(++stage->seen == stage->count) {
+                        pipe->cell = 0;
+                    }
+                    break;
+            }
+        }
+        if(pass) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Return an integer by applying a reduce function to each value out of
+ * 'pipe', as for slisti_reduce().
+ */
+int slisti_pipe_reduce(struct slisti_pipe *pipe, int (*fn)(int, int)) {
+    int state = 0;
+    int value;
+    while(slisti_pipe_next(pipe, &value)) {
+        state = fn(state, value);
+    }
+    return state;
+}
+
+/*
+ * Collect the values out of 'pipe' into a new list handle.  Return the
+ * handle, which is empty if no values come out, or NULL on failure.
+ */
+struct slisti_list *slisti_pipe_collect(struct slisti_pipe *pipe) {
+    struct slisti_list *list = pipe ? slisti_list_create() : 0;
+    if(!list) {
+        return 0;
+    }
+    int value;
+    while(slisti_pipe_next(pipe, &value)) {
+        if(!slisti_push(list, value)) {
+            slisti_list_destroy(list);
+            return 0;
+        }
+    }
+    return list;
+}
+
+/*
+ * Write up to 'max' values out of 'pipe' to 'output', and stop there.
+ * Return the number of values written, or -1 if 'pipe' is NULL.
+ */
+int slisti_pipe_to_array(struct slisti_pipe *pipe, int output[], int max) {
+    if(!pipe) {
+        return -1;
+    }
+    int n = 0;
+    while(n < max && slisti_pipe_next(pipe, &output[n])) {
+        n++;
+    }
+    return n;
+}
+
+/*
+ * Return the values out of 'pipe' formatted as compact JSON, as for
+ * slisti_to_json().  The result is a newly malloc'd string, which grows as
+ * the values come out.  Return a NULL pointer on failure.
+ */
+char *slisti_pipe_to_json(struct slisti_pipe *pipe) {
+    char buf[64];
+    const size_t int_size = snprintf(buf, sizeof buf, "%d", INT_MIN);
+    size_t size = 64;
+    char *result = pipe ? malloc(size) : 0;
+    if(!result) {
+        return 0;
+    }
+    size_t pos = 0;
+    result[pos++] = '[';
+    int value;
+    while(slisti_pipe_next(pipe, &value)) {
+        /* Room for this value, its comma, and the closing bracket and NUL */
+        if(size - pos < int_size + 3) {
+            char *bigger = realloc(result, size * 2);
+            if(!bigger) {
+                free(result);
+                return 0;
+            }
+            result = bigger;
+            size *= 2;
+        }
+        pos += snprintf(&result[pos], size - pos, "%d,", value);
+    }
+    if(pos > 1) {
+        pos--;
+    }
+    result[pos++] = ']';
+    result[pos] = '\0';
+    return result;
 }
@@ -1,10 +1,72 @@
 #include <stdbool.h>
 
+struct pool;
+
+/*
+ * A cell of a singly-linked integer list.
+ *
+ * Cells are carved from blocks shared by all lists (see slisti.c), not
+ * allocated with malloc(), so they must only be freed with slisti_destroy()
+ * or by deleting them from their list.
+ */
 struct slisti {
     struct slisti *next;
     int value;
 };
 
+/*
+ * A handle on a list of slisti cells, which keeps track of the last cell and
+ * the number of cells, so that appending, the length and the last element
+ * take constant time.  'head' is an ordinary list, which the slisti_*()
+ * functions that do not change a list can be given directly.  The
+ * slisti_list_*() functions keep the handle up to date; to change the cells
+ * any other way, build a new handle.
+ */
+struct slisti_list {
+    struct slisti *head;
+    struct slisti *tail;
+    int length;
+};
+
+/*
+ * A lazy pipeline of stages over the values of a list.
+ *
+ * A pipeline starts from a list with slisti_pipe_init(), and each
+ * slisti_pipe_*() stage function adds a stage to it: map, filter, skip, take
+ * or slice.  Nothing is done until a terminal function (reduce, collect,
+ * to_array or to_json) pulls the values through, one at a time, in a single
+ * walk along the list.  No intermediate lists are built, and a pipeline is a
+ * plain struct that can live on the stack, so only the terminal's result is
+ * allocated.  The walk stops as soon as a take stage has all of its values.
+ *
+ * The stage functions return the pipeline, so that calls can be nested, or
+ * NULL if the pipeline already has SLISTI_PIPE_STAGES stages.  Every stage
+ * and terminal function given a NULL pipeline fails in turn.  Running a
+ * terminal uses up the pipeline; to run it again, build it again.
+ */
+#define SLISTI_PIPE_STAGES 16
+
+enum slisti_stage_kind {
+    SLISTI_STAGE_MAP,
+    SLISTI_STAGE_FILTER,
+    SLISTI_STAGE_SKIP,
+    SLISTI_STAGE_TAKE
+};
+
+struct slisti_stage {
+    enum slisti_stage_kind kind;
+    int (*map)(int);
+    bool (*filter)(int);
+    int count;
+    int seen;
+};
+
+struct slisti_pipe {
+    const struct slisti *cell;
+    int nstages;
+    struct slisti_stage stages[SLISTI_PIPE_STAGES];
+};
+
 int slisti_length(const struct slisti *list);
 void slisti_destroy(struct slisti *list);
 struct slisti *slisti_create(const int value);
@@ -18,5 +80,64 @@ struct slisti *slisti_delete(struct slisti *list, int pos);
 struct slisti *slisti_map(const struct slisti *list, int (*fn)(int));
 struct slisti *slisti_filter(const struct slisti *list, bool (*fn)(int));
 int slisti_reduce(const struct slisti *list, int (*fn)(int, int));
+long long slisti_sum(const struct slisti *list);
+int slisti_min(const struct slisti *list);
+int slisti_max(const struct slisti *list);
+int slisti_count(const struct slisti *list, int value);
 char *slisti_to_json(const struct slisti *list);
 struct slisti *slisti_from_json(const char *json);
+void slisti_cells_flush(void);
+
+struct slisti_list *slisti_list_create(void);
+struct slisti_list *slisti_list_from_array(const int input[], int num);
+void slisti_list_destroy(struct slisti_list *list);
+int slisti_list_length(const struct slisti_list *list);
+struct slisti *slisti_list_append(struct slisti_list *list, int value);
+struct slisti *slisti_list_get(struct slisti_list *list, int pos);
+struct slisti *slisti_list_find(struct slisti_list *list, int value);
+struct slisti *slisti_list_insert(struct slisti_list *list, int pos,
+        int value);
+bool slisti_list_delete(struct slisti_list *list, int pos);
+struct slisti_list *slisti_list_slice(const struct slisti_list *source,
+        int start, int end);
+struct slisti_list *slisti_list_map(const struct slisti_list *list,
+        int (*fn)(int));
+struct slisti_list *slisti_list_filter(const struct slisti_list *list,
+        bool (*fn)(int));
+int slisti_list_reduce(const struct slisti_list *list, int (*fn)(int, int));
+char *slisti_list_to_json(const struct slisti_list *list);
+struct slisti_list *slisti_list_from_json(const char *json);
+struct slisti_list *slisti_list_add(const struct slisti_list *source, int k);
+struct slisti_list *slisti_list_mul(const struct slisti_list *source, int k);
+struct slisti_list *slisti_list_clamp(const struct slisti_list *source,
+        int lo, int hi);
+struct slisti_list *slisti_list_filter_lt(const struct slisti_list *source,
+        int k);
+struct slisti_list *slisti_list_filter_gt(const struct slisti_list *source,
+        int k);
+struct slisti_list *slisti_list_filter_eq(const struct slisti_list *source,
+        int k);
+struct slisti_list *slisti_list_filter_range(
+        const struct slisti_list *source, int lo, int hi);
+struct slisti_list *slisti_list_pmap(const struct slisti_list *source,
+        int (*fn)(int), struct pool *pool);
+struct slisti_list *slisti_list_pfilter(const struct slisti_list *source,
+        bool (*fn)(int), struct pool *pool);
+int slisti_list_preduce(const struct slisti_list *source, int (*fn)(int, int),
+        int identity, struct pool *pool);
+
+struct slisti_pipe *slisti_pipe_init(struct slisti_pipe *pipe,
+        const struct slisti *source);
+struct slisti_pipe *slisti_pipe_map(struct slisti_pipe *pipe,
+        int (*fn)(int));
+struct slisti_pipe *slisti_pipe_filter(struct slisti_pipe *pipe,
+        bool (*fn)(int));
+struct slisti_pipe *slisti_pipe_skip(struct slisti_pipe *pipe, int num);
+struct slisti_pipe *slisti_pipe_take(struct slisti_pipe *pipe, int num);
+struct slisti_pipe *slisti_pipe_slice(struct slisti_pipe *pipe, int start,
+        int end);
+bool slisti_pipe_next(struct slisti_pipe *pipe, int *value);
+int slisti_pipe_reduce(struct slisti_pipe *pipe, int (*fn)(int, int));
+struct slisti_list *slisti_pipe_collect(struct slisti_pipe *pipe);
+int slisti_pipe_to_array(struct slisti_pipe *pipe, int output[], int max);
+char *slisti_pipe_to_json(struct slisti_pipe *pipe);
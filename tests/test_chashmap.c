@@ -0,0 +1,209 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "./util.h"
+#include "../chashmap.h"
+#include "../epoch.h"
+
+#define KEYSIZE 16
+#define THREADS 8
+#define PER_THREAD 5000
+
+static int *int_value(const int i) {
+    int *v = malloc(sizeof *v);
+    *v = i;
+    return v;
+}
+
+START_TEST(test_chashmap_create) {
+    struct chashmap *m = chashmap_create();
+    ck_assert_ptr_nonnull(m);
+    ck_assert_uint_eq(chashmap_count(m), 0);
+    struct chashmap_table *t = atomic_load(&m->table);
+    ck_assert_uint_ge(t->size, CHASHMAP_STRIPES);
+    ck_assert_ptr_null(atomic_load(&t->next));
+    chashmap_destroy(m);
+
+    /* A NULL hash function gets the default */
+    m = chashmap_create_with_hash(0);
+    ck_assert_ptr_nonnull(m);
+    ck_assert(m->hash == hash_xx64_len);
+    ck_assert(chashmap_set(m, "a", int_value(1)));
+    ck_assert_int_eq(*((int *) chashmap_get(m, "a")), 1);
+    chashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_chashmap_set_get) {
+    struct chashmap *m = chashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    /* NULL key or value */
+    int zero = 0;
+    ck_assert(!chashmap_set(m, 0, &zero));
+    ck_assert(!chashmap_set(m, "a", 0));
+    ck_assert_ptr_null(chashmap_get(m, 0));
+
+    ck_assert_ptr_null(chashmap_get(m, "a"));
+    ck_assert(chashmap_set(m, "a", int_value(0)));
+    ck_assert_int_eq(*((int *) chashmap_get(m, "a")), 0);
+    ck_assert_uint_eq(chashmap_count(m), 1);
+
+    /* Overwrite value for existing key */
+    ck_assert(chashmap_set(m, "a", int_value(1)));
+    ck_assert_int_eq(*((int *) chashmap_get(m, "a")), 1);
+    ck_assert_uint_eq(chashmap_count(m), 1);
+
+    /* Empty and binary keys */
+    ck_assert(chashmap_set(m, "", int_value(2)));
+    ck_assert(chashmap_set_len(m, "a\0b", 3, int_value(3)));
+    ck_assert_int_eq(*((int *) chashmap_get(m, "")), 2);
+    ck_assert_int_eq(*((int *) chashmap_get_len(m, "a\0b", 3)), 3);
+    ck_assert_int_eq(*((int *) chashmap_get(m, "a")), 1);
+    ck_assert_uint_eq(chashmap_count(m), 3);
+
+    chashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_chashmap_delete) {
+    struct chashmap *m = chashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    ck_assert(!chashmap_delete(m, "absent"));
+    chashmap_set(m, "a", int_value(0));
+    chashmap_set(m, "b", int_value(1));
+    ck_assert(chashmap_exists(m, "a"));
+    ck_assert(chashmap_delete(m, "a"));
+    ck_assert(!chashmap_exists(m, "a"));
+    ck_assert(!chashmap_delete(m, "a"));
+    ck_assert(chashmap_exists(m, "b"));
+    ck_assert_uint_eq(chashmap_count(m), 1);
+
+    chashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_chashmap_resize) {
+    struct chashmap *m = chashmap_create();
+    ck_assert_ptr_nonnull(m);
+    size_t size = atomic_load(&m->table)->size;
+
+    char k[KEYSIZE];
+    for (int i = 0; i < 20000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(chashmap_set(m, k, int_value(i)));
+    }
+    ck_assert_uint_gt(atomic_load(&m->table)->size, size);
+    ck_assert_uint_eq(chashmap_count(m), 20000);
+    for (int i = 0; i < 20000; i += 2) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(chashmap_delete(m, k));
+    }
+    for (int i = 0; i < 20000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        if (i % 2) {
+            ck_assert_int_eq(*((int *) chashmap_get(m, k)), i);
+        } else {
+            ck_assert(!chashmap_exists(m, k));
+        }
+    }
+    chashmap_destroy(m);
+    epoch_reclaim();
+}
+END_TEST
+
+struct worker {
+    struct chashmap *m;
+    int id;
+    size_t misses;
+};
+
+/*
+ * Insert this worker's own keys, overwriting each once, while reading back
+ * the keys of every worker.  Keys of other workers may not be there yet, but
+ * any value that is found must be the right one.
+ */
+static void *worker_run(void *p) {
+    struct worker *w = p;
+    char k[KEYSIZE];
+    for (int i = 0; i < PER_THREAD; i++) {
+        int key = w->id * PER_THREAD + i;
+        snprintf(k, KEYSIZE, "%d", key);
+        chashmap_set(w->m, k, int_value(-key));
+        chashmap_set(w->m, k, int_value(key));
+
+        snprintf(k, KEYSIZE, "%d", (key * 7919) % (THREADS * PER_THREAD));
+        epoch_enter();
+        int *v = chashmap_get(w->m, k);
+        if (v && *v != atoi(k) && *v != -atoi(k)) {
+            w->misses++;
+        }
+        epoch_leave();
+    }
+    return 0;
+}
+
+START_TEST(test_chashmap_threads) {
+    struct chashmap *m = chashmap_create();
+    ck_assert_ptr_nonnull(m);
+    pthread_t threads[THREADS];
+    struct worker workers[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        workers[i] = (struct worker) {m, i, 0};
+        ck_assert_int_eq(
+                pthread_create(&threads[i], 0, worker_run, &workers[i]), 0);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], 0);
+        ck_assert_uint_eq(workers[i].misses, 0);
+    }
+
+    ck_assert_uint_eq(chashmap_count(m), THREADS * PER_THREAD);
+    char k[KEYSIZE];
+    for (int i = 0; i < THREADS * PER_THREAD; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert_int_eq(*((int *) chashmap_get(m, k)), i);
+    }
+    chashmap_destroy(m);
+}
+END_TEST
+
+Suite *chashmap_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Concurrent hashmap");
+    tc = tcase_create("Create/destroy");
+    tcase_add_test(tc, test_chashmap_create);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Set/get/delete");
+    tcase_add_test(tc, test_chashmap_set_get);
+    tcase_add_test(tc, test_chashmap_delete);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Resize");
+    tcase_add_test(tc, test_chashmap_resize);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Threads");
+    tcase_add_test(tc, test_chashmap_threads);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = chashmap_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,83 @@
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "./util.h"
+#include "../epoch.h"
+
+START_TEST(test_epoch_advance) {
+    /* With no reader inside a critical section, the epoch moves freely. */
+    ck_assert(epoch_reclaim());
+    ck_assert(epoch_reclaim());
+
+    /* Our own critical section holds it back after one step. */
+    epoch_enter();
+    epoch_enter();
+    epoch_reclaim();
+    ck_assert(!epoch_reclaim());
+    epoch_leave();
+    ck_assert(!epoch_reclaim());
+    epoch_leave();
+    ck_assert(epoch_reclaim());
+}
+END_TEST
+
+static void *reader_run(void *p) {
+    pthread_barrier_t *barrier = p;
+    epoch_enter();
+    pthread_barrier_wait(&barrier[0]);
+    pthread_barrier_wait(&barrier[1]);
+    epoch_leave();
+    return 0;
+}
+
+START_TEST(test_epoch_reader) {
+    /* A reader in another thread holds the epoch back until it leaves. */
+    pthread_barrier_t barrier[2];
+    pthread_barrier_init(&barrier[0], 0, 2);
+    pthread_barrier_init(&barrier[1], 0, 2);
+    pthread_t reader;
+    ck_assert_int_eq(pthread_create(&reader, 0, reader_run, barrier), 0);
+    pthread_barrier_wait(&barrier[0]);
+
+    epoch_retire(malloc(16));
+    epoch_reclaim();
+    ck_assert(!epoch_reclaim());
+
+    pthread_barrier_wait(&barrier[1]);
+    pthread_join(reader, 0);
+    ck_assert(epoch_reclaim());
+    ck_assert(epoch_reclaim());
+
+    /* Retiring NULL is a no-op. */
+    epoch_retire(0);
+    pthread_barrier_destroy(&barrier[0]);
+    pthread_barrier_destroy(&barrier[1]);
+}
+END_TEST
+
+Suite *epoch_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Epoch reclamation");
+    tc = tcase_create("Epochs");
+    tcase_add_test(tc, test_epoch_advance);
+    tcase_add_test(tc, test_epoch_reader);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = epoch_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
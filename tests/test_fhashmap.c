@@ -0,0 +1,172 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "./util.h"
+#include "../fhashmap.h"
+#include "../intern.h"
+
+#define KEYSIZE 16
+
+static char *string_value(const char *s) {
+    char *v = malloc(strlen(s) + 1);
+    strcpy(v, s);
+    return v;
+}
+
+static unsigned long hash_constant(const char *k, const size_t len) {
+    (void) k;
+    (void) len;
+    return 7;
+}
+
+START_TEST(test_fhashmap_empty) {
+    struct fhashmap *f = hashmap_freeze(hashmap_create());
+    ck_assert_ptr_nonnull(f);
+    ck_assert_uint_eq(f->count, 0);
+    ck_assert(!fhashmap_exists(f, "a"));
+    ck_assert(!fhashmap_exists(f, ""));
+    ck_assert_ptr_null(fhashmap_get(f, 0));
+    fhashmap_destroy(f);
+
+    ck_assert_ptr_null(hashmap_freeze(0));
+}
+END_TEST
+
+START_TEST(test_fhashmap_get) {
+    struct hashmap *m = hashmap_create();
+    char k[KEYSIZE];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, string_value(k));
+    }
+    hashmap_set(m, "", string_value("empty"));
+    hashmap_set_len(m, "a\0b", 3, string_value("binary"));
+    struct fhashmap *f = hashmap_freeze(m);
+    ck_assert_ptr_nonnull(f);
+    ck_assert_uint_eq(f->count, 5002);
+
+    for (int i = 0; i < 5000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert_str_eq((const char *) fhashmap_get(f, k), k);
+    }
+    ck_assert_str_eq((const char *) fhashmap_get(f, ""), "empty");
+    ck_assert_str_eq((const char *) fhashmap_get_len(f, "a\0b", 3), "binary");
+    ck_assert(!fhashmap_exists(f, "a"));
+    ck_assert(!fhashmap_exists(f, "5000"));
+    ck_assert(!fhashmap_exists(f, "-1"));
+    ck_assert(!fhashmap_exists_len(f, "a\0c", 3));
+    ck_assert(!fhashmap_exists_len(f, "a\0b", 2));
+
+    /* Every slot is used, by a different key. */
+    for (size_t i = 0; i < f->count; i++) {
+        const struct fhashmap_slot *s = &f->slots[i];
+        ck_assert_ptr_nonnull(s->value);
+        ck_assert_ptr_eq(fhashmap_get_len(f, s->key, s->len), s->value);
+    }
+    fhashmap_destroy(f);
+}
+END_TEST
+
+START_TEST(test_fhashmap_hashes) {
+    /*
+     * Maps hashed with xx64 or otherwise, part way through a resize, and
+     * with interned keys.
+     */
+    struct intern *t = intern_create_with_hash(hash_wy_len);
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.intern = t;
+    struct hashmap *maps[] = {
+        hashmap_create_with_hash(hash_xx64_len),
+        hashmap_create_with_hash(hash_wy_len),
+        hashmap_create_with_hash(hash_constant),
+        hashmap_create_with_options(&o),
+    };
+    char k[KEYSIZE];
+    for (size_t j = 0; j < 4; j++) {
+        for (int i = 0; i < 1025; i++) {
+            snprintf(k, KEYSIZE, "key:%d", i);
+            hashmap_set(maps[j], k, string_value(k));
+        }
+    }
+    ck_assert_ptr_nonnull(maps[1]->old_buckets);
+
+    for (size_t j = 0; j < 4; j++) {
+        struct fhashmap *f = hashmap_freeze(maps[j]);
+        ck_assert_ptr_nonnull(f);
+        ck_assert_uint_eq(f->count, 1025);
+        for (int i = 0; i < 1025; i++) {
+            snprintf(k, KEYSIZE, "key:%d", i);
+            ck_assert_str_eq((const char *) fhashmap_get(f, k), k);
+        }
+        ck_assert(!fhashmap_exists(f, "key:1025"));
+        fhashmap_destroy(f);
+    }
+    intern_destroy(t);
+}
+END_TEST
+
+START_TEST(test_fhashmap_values) {
+    /* Word and inline values come across as they were kept. */
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.values = HASHMAP_VALUES_WORD;
+    struct hashmap *words = hashmap_create_with_options(&o);
+    o.values = HASHMAP_VALUES_INLINE;
+    o.value_size = 3 * sizeof (double);
+    struct hashmap *inlines = hashmap_create_with_options(&o);
+    char k[KEYSIZE];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        uintptr_t w = (uintptr_t) i;
+        double d[3] = {i, i * 2, i * 3};
+        hashmap_set(words, k, &w);
+        hashmap_set(inlines, k, d);
+    }
+    struct fhashmap *fw = hashmap_freeze(words);
+    struct fhashmap *fi = hashmap_freeze(inlines);
+    ck_assert_ptr_nonnull(fw);
+    ck_assert_ptr_nonnull(fi);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert_uint_eq(*(const uintptr_t *) fhashmap_get(fw, k), i);
+        const double *d = fhashmap_get(fi, k);
+        ck_assert_uint_eq((uintptr_t) d % _Alignof (max_align_t), 0);
+        ck_assert(d[0] == i && d[1] == i * 2 && d[2] == i * 3);
+    }
+    ck_assert_ptr_null(fhashmap_get(fw, "1000"));
+    ck_assert_ptr_null(fhashmap_get(fi, "1000"));
+    fhashmap_destroy(fw);
+    fhashmap_destroy(fi);
+}
+END_TEST
+
+Suite *fhashmap_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Frozen hashmap");
+    tc = tcase_create("Freeze");
+    tcase_add_test(tc, test_fhashmap_empty);
+    tcase_add_test(tc, test_fhashmap_get);
+    tcase_add_test(tc, test_fhashmap_hashes);
+    tcase_add_test(tc, test_fhashmap_values);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = fhashmap_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
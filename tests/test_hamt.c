@@ -0,0 +1,248 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "./util.h"
+#include "../hamt.h"
+
+#define KEYSIZE 16
+
+static int *int_value(const int i) {
+    int *v = malloc(sizeof *v);
+    *v = i;
+    return v;
+}
+
+/*
+ * A hash that sends every key to the same place, so that they all end up in
+ * one collision node at the bottom of the trie.
+ */
+static unsigned long hash_constant(const char *k, const size_t len) {
+    (void) k;
+    (void) len;
+    return 0x5A5A5A5A;
+}
+
+START_TEST(test_hamt_create) {
+    struct hamt *t = hamt_create();
+    ck_assert_ptr_nonnull(t);
+    ck_assert_uint_eq(t->count, 0);
+    ck_assert_ptr_null(t->root);
+    ck_assert(t->hash == hash_xx64_len);
+    ck_assert_ptr_null(hamt_get(t, "a"));
+    ck_assert(!hamt_exists(t, "a"));
+    hamt_destroy(t);
+
+    t = hamt_create_with_hash(hash_wy_len);
+    ck_assert(t->hash == hash_wy_len);
+    hamt_destroy(t);
+}
+END_TEST
+
+START_TEST(test_hamt_set_get) {
+    struct hamt *t0 = hamt_create();
+    ck_assert_ptr_nonnull(t0);
+
+    /* NULL key or value */
+    int *v = int_value(0);
+    ck_assert_ptr_null(hamt_set(t0, 0, v));
+    ck_assert_ptr_null(hamt_set(t0, "a", 0));
+    free(v);
+
+    struct hamt *t1 = hamt_set(t0, "a", int_value(1));
+    ck_assert_ptr_nonnull(t1);
+    struct hamt *t2 = hamt_set(t1, "a", int_value(2));
+    ck_assert_ptr_nonnull(t2);
+    struct hamt *t3 = hamt_set_len(t2, "a\0b", 3, int_value(3));
+    ck_assert_ptr_nonnull(t3);
+
+    /* Every version keeps its own contents. */
+    ck_assert_uint_eq(t0->count, 0);
+    ck_assert_uint_eq(t1->count, 1);
+    ck_assert_uint_eq(t2->count, 1);
+    ck_assert_uint_eq(t3->count, 2);
+    ck_assert_ptr_null(hamt_get(t0, "a"));
+    ck_assert_int_eq(*((int *) hamt_get(t1, "a")), 1);
+    ck_assert_int_eq(*((int *) hamt_get(t2, "a")), 2);
+    ck_assert_int_eq(*((int *) hamt_get(t3, "a")), 2);
+    ck_assert(!hamt_exists_len(t2, "a\0b", 3));
+    ck_assert_int_eq(*((int *) hamt_get_len(t3, "a\0b", 3)), 3);
+
+    /* Setting the value a key already has changes nothing. */
+    struct hamt *t4 = hamt_set(t3, "a", hamt_get(t3, "a"));
+    ck_assert_ptr_eq(t4->root, t3->root);
+
+    /* Versions can go in any order. */
+    hamt_destroy(t2);
+    hamt_destroy(t0);
+    hamt_destroy(t4);
+    ck_assert_int_eq(*((int *) hamt_get(t1, "a")), 1);
+    ck_assert_int_eq(*((int *) hamt_get(t3, "a")), 2);
+    hamt_destroy(t3);
+    hamt_destroy(t1);
+}
+END_TEST
+
+START_TEST(test_hamt_delete) {
+    struct hamt *t0 = hamt_create();
+    struct hamt *t1 = hamt_set(t0, "a", int_value(1));
+    struct hamt *t2 = hamt_set(t1, "b", int_value(2));
+
+    struct hamt *t3 = hamt_delete(t2, "a");
+    ck_assert_ptr_nonnull(t3);
+    ck_assert_uint_eq(t3->count, 1);
+    ck_assert(!hamt_exists(t3, "a"));
+    ck_assert(hamt_exists(t3, "b"));
+    ck_assert(hamt_exists(t2, "a"));
+
+    /* Deleting a missing key gives an identical version. */
+    struct hamt *t4 = hamt_delete(t3, "a");
+    ck_assert_ptr_nonnull(t4);
+    ck_assert_ptr_eq(t4->root, t3->root);
+    ck_assert_uint_eq(t4->count, 1);
+
+    struct hamt *t5 = hamt_delete(t4, "b");
+    ck_assert_uint_eq(t5->count, 0);
+    ck_assert_ptr_null(t5->root);
+    ck_assert_ptr_null(hamt_delete(t5, 0));
+
+    hamt_destroy(t0);
+    hamt_destroy(t1);
+    hamt_destroy(t2);
+    hamt_destroy(t3);
+    hamt_destroy(t4);
+    hamt_destroy(t5);
+}
+END_TEST
+
+/*
+ * Build up a map one key at a time, keeping every version, then delete the
+ * keys again, and check that each version still holds exactly the keys it
+ * should.
+ */
+static void check_versions(struct hamt *t, const int n) {
+    struct hamt **versions = malloc((2 * n + 1) * sizeof *versions);
+    char k[KEYSIZE];
+    versions[0] = t;
+    for (int i = 0; i < n; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        versions[i + 1] = hamt_set(versions[i], k, int_value(i));
+        ck_assert_ptr_nonnull(versions[i + 1]);
+    }
+    for (int i = 0; i < n; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        versions[n + i + 1] = hamt_delete(versions[n + i], k);
+        ck_assert_ptr_nonnull(versions[n + i + 1]);
+    }
+
+    for (int v = 0; v <= 2 * n; v += 1 + v / 8) {
+        const int low = v > n ? v - n : 0;
+        const int high = v > n ? n : v;
+        ck_assert_uint_eq(versions[v]->count, high - low);
+        for (int i = 0; i < n; i++) {
+            snprintf(k, KEYSIZE, "%d", i);
+            int *value = hamt_get(versions[v], k);
+            if (i >= low && i < high) {
+                ck_assert_ptr_nonnull(value);
+                ck_assert_int_eq(*value, i);
+            } else {
+                ck_assert_ptr_null(value);
+            }
+        }
+    }
+    ck_assert_ptr_null(versions[2 * n]->root);
+
+    /* Drop every other version first, then the rest. */
+    for (int v = 0; v <= 2 * n; v += 2) {
+        hamt_destroy(versions[v]);
+    }
+    for (int v = 1; v <= 2 * n; v += 2) {
+        hamt_destroy(versions[v]);
+    }
+    free(versions);
+}
+
+START_TEST(test_hamt_versions) {
+    check_versions(hamt_create(), 2000);
+}
+END_TEST
+
+START_TEST(test_hamt_collisions) {
+    check_versions(hamt_create_with_hash(hash_constant), 100);
+}
+END_TEST
+
+START_TEST(test_hamt_sharing) {
+    struct hamt *t = hamt_create();
+    char k[KEYSIZE];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        struct hamt *next = hamt_set(t, k, int_value(i));
+        hamt_destroy(t);
+        t = next;
+    }
+
+    /* Only the path to the changed key is new; every other slot is shared. */
+    struct hamt *u = hamt_set(t, "42", int_value(-42));
+    const unsigned long hash = t->hash("42", 2);
+    const struct hamt_node *a = t->root;
+    const struct hamt_node *b = u->root;
+    for (unsigned int shift = 0; ; shift += 5) {
+        ck_assert_ptr_ne(a, b);
+        ck_assert_uint_eq(a->bitmap, b->bitmap);
+        unsigned int shared = 0, diff = 0;
+        for (unsigned int i = 0; i < a->size; i++) {
+            if (a->slots[i] == b->slots[i]) {
+                shared++;
+            } else {
+                diff = i;
+            }
+        }
+        ck_assert_uint_eq(shared, a->size - 1);
+        if (a->leafmap & (1u << ((hash >> shift) & 31))) {
+            break;
+        }
+        a = a->slots[diff];
+        b = b->slots[diff];
+    }
+    ck_assert_int_eq(*((int *) hamt_get(t, "42")), 42);
+    ck_assert_int_eq(*((int *) hamt_get(u, "42")), -42);
+    hamt_destroy(t);
+    hamt_destroy(u);
+}
+END_TEST
+
+Suite *hamt_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("HAMT");
+    tc = tcase_create("Create/destroy");
+    tcase_add_test(tc, test_hamt_create);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Set/get/delete");
+    tcase_add_test(tc, test_hamt_set_get);
+    tcase_add_test(tc, test_hamt_delete);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Versions");
+    tcase_add_test(tc, test_hamt_versions);
+    tcase_add_test(tc, test_hamt_collisions);
+    tcase_add_test(tc, test_hamt_sharing);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = hamt_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
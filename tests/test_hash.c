@@ -1,5 +1,7 @@
 #include <check.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include "./util.h"
 #include "../hash.h"
 
@@ -22,6 +24,155 @@ START_TEST(test_hash_shimmy2_variance) {
 }
 END_TEST
 
+/*
+ * Reference values from the canonical XXH64 implementation, seed zero.
+ */
+START_TEST(test_hash_xx64_vectors) {
+    ck_assert_uint_eq(hash_xx64_len("", 0), 0xEF46DB3751D8E999ul);
+    ck_assert_uint_eq(hash_xx64(NULL), 0xEF46DB3751D8E999ul);
+    ck_assert_uint_eq(hash_xx64("a"), 0xD24EC4F1A98C6E5Bul);
+    ck_assert_uint_eq(hash_xx64("abc"), 0x44BC2CF5AD770999ul);
+    ck_assert_uint_eq(hash_xx64("abcdefgh"), 0x3AD351775B4634B7ul);
+    ck_assert_uint_eq(
+            hash_xx64("0123456789abcdef0123456789abcdef0123"),
+            0xC4255BA3D1AF5461ul);
+    ck_assert_uint_eq(
+            hash_xx64("0123456789abcdef0123456789abcdef"
+                "0123456789abcdef0123456789abcdef01234567"),
+            0x05E93986B53BA7BBul);
+}
+END_TEST
+
+/*
+ * The string and length variants agree, and the length is respected.
+ */
+START_TEST(test_hash_len_variants) {
+    const char *s = "hash functions";
+    ck_assert_uint_eq(hash_wy(s), hash_wy_len(s, strlen(s)));
+    ck_assert_uint_eq(hash_xx64(s), hash_xx64_len(s, strlen(s)));
+    ck_assert_uint_ne(hash_wy_len(s, 4), hash_wy_len(s, 5));
+    ck_assert_uint_ne(hash_xx64_len(s, 4), hash_xx64_len(s, 5));
+    ck_assert_uint_eq(hash_wy(NULL), hash_wy_len("", 0));
+
+    /* Embedded NULs count as key bytes. */
+    ck_assert_uint_ne(hash_wy_len("a\0b", 3), hash_wy_len("a\0c", 3));
+    ck_assert_uint_ne(hash_xx64_len("a\0b", 3), hash_xx64_len("a\0c", 3));
+}
+END_TEST
+
+/*
+ * Single byte keys are mixed, not passed through as the byte value.
+ */
+START_TEST(test_hash_single_byte) {
+    const hash_func fns[] = {hash_wy_len, hash_xx64_len};
+    for (size_t f = 0; f < sizeof fns / sizeof fns[0]; f++) {
+        for (int c = 1; c < 256; c++) {
+            char b = (char) c;
+            ck_assert_uint_gt(fns[f](&b, 1), 0xFFFFFFFFul);
+        }
+    }
+}
+END_TEST
+
+static int bits_set(unsigned long x) {
+    int n = 0;
+    for (; x; x &= x - 1) {
+        n++;
+    }
+    return n;
+}
+
+/*
+ * Flipping any one input bit should flip about half of the output bits.
+ */
+START_TEST(test_hash_avalanche) {
+    const hash_func fns[] = {hash_wy_len, hash_xx64_len};
+    char key[40] = "avalanche test key, forty bytes long...";
+    for (size_t f = 0; f < sizeof fns / sizeof fns[0]; f++) {
+        for (size_t len = 1; len <= sizeof key; len += 7) {
+            unsigned long total = 0;
+            const unsigned long h = fns[f](key, len);
+            for (size_t bit = 0; bit < len * 8; bit++) {
+                key[bit / 8] ^= 1 << (bit % 8);
+                total += bits_set(h ^ fns[f](key, len));
+                key[bit / 8] ^= 1 << (bit % 8);
+            }
+            double mean = (double) total / (len * 8);
+            ck_assert_msg(mean > 24 && mean < 40,
+                    "mean %.1f bits flipped for length %zu", mean, len);
+        }
+    }
+}
+END_TEST
+
+/*
+ * Sequential numeric keys should spread evenly over a power-of-two number of
+ * buckets when indexed by the low bits of the hash.
+ */
+START_TEST(test_hash_distribution) {
+    const hash_func fns[] = {hash_wy_len, hash_xx64_len};
+    const size_t BUCKETS = 1024;
+    const size_t KEYS = BUCKETS * 16;
+    static unsigned int counts[1024];
+    char k[16];
+    for (size_t f = 0; f < sizeof fns / sizeof fns[0]; f++) {
+        memset(counts, 0, sizeof counts);
+        for (size_t i = 0; i < KEYS; i++) {
+            int len = snprintf(k, sizeof k, "%zu", i);
+            counts[fns[f](k, len) & (BUCKETS - 1)]++;
+        }
+        /*
+         * Chi-squared with 1023 degrees of freedom; anything over 1200 would
+         * be a very unlikely outcome for a uniform hash.
+         */
+        double expected = (double) KEYS / BUCKETS;
+        double chi2 = 0;
+        for (size_t b = 0; b < BUCKETS; b++) {
+            double d = counts[b] - expected;
+            chi2 += d * d / expected;
+        }
+        ck_assert_msg(chi2 < 1200, "chi-squared %.1f", chi2);
+    }
+}
+END_TEST
+
+/*
+ * Batch hashing gives exactly the same results as hashing one key at a time.
+ */
+START_TEST(test_hash_batch) {
+    const size_t N = 301;
+    char *keys[301];
+    size_t lens[301];
+    unsigned long out[301];
+    for (size_t i = 0; i < N; i++) {
+        lens[i] = (i * 7) % 41;
+        keys[i] = malloc(lens[i] + 1);
+        for (size_t j = 0; j < lens[i]; j++) {
+            keys[i][j] = (char) (i * 31 + j * 17 + 1);
+        }
+        keys[i][lens[i]] = '\0';
+    }
+
+    const hash_func fns[] = {hash_shimmy2_len, hash_wy_len, hash_xx64_len};
+    for (size_t f = 0; f < sizeof fns / sizeof fns[0]; f++) {
+        hash_batch(fns[f], (const char *const *) keys, lens, N, out);
+        for (size_t i = 0; i < N; i++) {
+            ck_assert_uint_eq(out[i], fns[f](keys[i], lens[i]));
+        }
+
+        /* Without lengths, keys are NUL-terminated. */
+        hash_batch(fns[f], (const char *const *) keys, NULL, N, out);
+        for (size_t i = 0; i < N; i++) {
+            ck_assert_uint_eq(out[i], fns[f](keys[i], strlen(keys[i])));
+        }
+    }
+
+    for (size_t i = 0; i < N; i++) {
+        free(keys[i]);
+    }
+}
+END_TEST
+
 Suite *hash_suite(void) {
     Suite *s;
     TCase *tc;
@@ -34,6 +185,18 @@ Suite *hash_suite(void) {
     tcase_add_test(tc, test_hash_shimmy2_variance);
     suite_add_tcase(s, tc);
 
+    tc = tcase_create("Word-at-a-time");
+    tcase_add_test(tc, test_hash_xx64_vectors);
+    tcase_add_test(tc, test_hash_len_variants);
+    tcase_add_test(tc, test_hash_single_byte);
+    tcase_add_test(tc, test_hash_avalanche);
+    tcase_add_test(tc, test_hash_distribution);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Batch");
+    tcase_add_test(tc, test_hash_batch);
+    suite_add_tcase(s, tc);
+
     return s;
 }
 
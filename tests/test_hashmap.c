@@ -1,8 +1,34 @@
 #include <check.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "./util.h"
 #include "../hashmap.h"
+#include "../hash.h"
+#include "../intern.h"
+
+/*
+ * Return the entry for key 'k' by walking both bucket arrays of 'm'.
+ */
+static struct hashmap_entry *find_entry(struct hashmap *m, const char *k) {
+    struct hashmap_entry *e;
+    for (unsigned int i = 0; i < m->old_size; i++) {
+        for (e = m->old_buckets[i]; e; e = e->next) {
+            if (strcmp(e->key, k) == 0) {
+                return e;
+            }
+        }
+    }
+    for (unsigned int i = 0; i < m->size; i++) {
+        for (e = m->buckets[i]; e; e = e->next) {
+            if (strcmp(e->key, k) == 0) {
+                return e;
+            }
+        }
+    }
+    return 0;
+}
 
 START_TEST(test_hashmap_create) {
     struct hashmap *m = hashmap_create();
@@ -12,7 +38,28 @@ START_TEST(test_hashmap_create) {
     for (size_t i = 0; i < m->size; i++) {
         ck_assert_ptr_null(m->buckets[i]);
     }
-    free(m);
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_create_with_hash) {
+    struct hashmap *m = hashmap_create_with_hash(hash_xx64_len);
+    ck_assert_ptr_nonnull(m);
+    ck_assert(m->hash == hash_xx64_len);
+
+    int *v = malloc(sizeof *v);
+    *v = 7;
+    ck_assert(hashmap_set(m, "seven", v));
+    ck_assert_int_eq(*((int *) hashmap_get(m, "seven")), 7);
+    ck_assert(hashmap_exists(m, "seven"));
+    ck_assert(hashmap_delete(m, "seven"));
+    ck_assert(!hashmap_exists(m, "seven"));
+    hashmap_destroy(m);
+
+    /* NULL falls back to the default hash. */
+    m = hashmap_create_with_hash(0);
+    ck_assert(m->hash == hash_shimmy2_len);
+    hashmap_destroy(m);
 }
 END_TEST
 
@@ -138,6 +185,128 @@ START_TEST(test_hashmap_delete) {
 }
 END_TEST
 
+START_TEST(test_hashmap_long_key) {
+    struct hashmap *m = hashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    /* Long enough that the entry is too big for the slab. */
+    char k[1024];
+    memset(k, 'k', sizeof k - 1);
+    k[sizeof k - 1] = '\0';
+
+    int *v = malloc(sizeof *v);
+    *v = 1024;
+    ck_assert(hashmap_set(m, k, v));
+    ck_assert_int_eq(*((int *) hashmap_get(m, k)), 1024);
+
+    v = malloc(sizeof *v);
+    *v = 512;
+    k[512] = '\0';
+    ck_assert(hashmap_set(m, k, v));
+    ck_assert_int_eq(*((int *) hashmap_get(m, k)), 512);
+    ck_assert(hashmap_delete(m, k));
+    ck_assert(!hashmap_exists(m, k));
+    k[512] = 'k';
+    ck_assert(hashmap_exists(m, k));
+
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_binary_keys) {
+    struct hashmap *m = hashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    /* Keys that differ only after an embedded NUL. */
+    const char a[] = {'i', 'd', '\0', 1};
+    const char b[] = {'i', 'd', '\0', 2};
+    int *v;
+
+    v = malloc(sizeof *v);
+    *v = 1;
+    ck_assert(hashmap_set_len(m, a, sizeof a, v));
+    v = malloc(sizeof *v);
+    *v = 2;
+    ck_assert(hashmap_set_len(m, b, sizeof b, v));
+    v = malloc(sizeof *v);
+    *v = 3;
+    ck_assert(hashmap_set(m, "id", v));
+    ck_assert_int_eq(m->count, 3);
+
+    ck_assert_int_eq(*((int *) hashmap_get_len(m, a, sizeof a)), 1);
+    ck_assert_int_eq(*((int *) hashmap_get_len(m, b, sizeof b)), 2);
+    ck_assert_int_eq(*((int *) hashmap_get_len(m, "id", 2)), 3);
+    ck_assert_int_eq(*((int *) hashmap_get(m, "id")), 3);
+
+    /* A prefix of a key is a different key. */
+    ck_assert(!hashmap_exists_len(m, a, sizeof a - 1));
+    ck_assert(hashmap_exists_len(m, a, sizeof a));
+
+    /* Zero-length key. */
+    v = malloc(sizeof *v);
+    *v = 0;
+    ck_assert(hashmap_set_len(m, "", 0, v));
+    ck_assert_int_eq(*((int *) hashmap_get(m, "")), 0);
+
+    ck_assert(hashmap_delete_len(m, a, sizeof a));
+    ck_assert(!hashmap_exists_len(m, a, sizeof a));
+    ck_assert(hashmap_exists_len(m, b, sizeof b));
+    ck_assert(!hashmap_delete_len(m, a, sizeof a));
+    ck_assert_int_eq(m->count, 3);
+
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_many) {
+    struct hashmap *m = hashmap_create_with_hash(hash_xx64_len);
+    ck_assert_ptr_nonnull(m);
+
+    const size_t N = 100;
+    char *keys[100];
+    size_t lens[100];
+    void *values[100];
+    void *out[100];
+    for (size_t i = 0; i < N; i++) {
+        keys[i] = malloc(48);
+        lens[i] = snprintf(keys[i], 48, "%0*zu", (int) (i % 40), i);
+        int *v = malloc(sizeof *v);
+        *v = (int) i;
+        values[i] = v;
+    }
+
+    /* Set the first half by NUL-terminated keys, the rest by length. */
+    ck_assert_uint_eq(hashmap_set_many(
+                m, (const char *const *) keys, values, N / 2), N / 2);
+    ck_assert_uint_eq(hashmap_set_many_len(m,
+                (const void *const *) &keys[N / 2], &lens[N / 2],
+                &values[N / 2], N - N / 2), N - N / 2);
+    ck_assert_int_eq(m->count, N);
+
+    for (size_t i = 0; i < N; i++) {
+        ck_assert_ptr_eq(hashmap_get(m, keys[i]), values[i]);
+    }
+
+    hashmap_get_many(m, (const char *const *) keys, N, out);
+    for (size_t i = 0; i < N; i++) {
+        ck_assert_ptr_eq(out[i], values[i]);
+    }
+
+    /* Absent keys come back as NULL. */
+    lens[0]++;
+    hashmap_get_many_len(m, (const void *const *) keys, lens, N, out);
+    ck_assert_ptr_null(out[0]);
+    for (size_t i = 1; i < N; i++) {
+        ck_assert_ptr_eq(out[i], values[i]);
+    }
+
+    for (size_t i = 0; i < N; i++) {
+        free(keys[i]);
+    }
+    hashmap_destroy(m);
+}
+END_TEST
+
 START_TEST(test_hashmap_exists) {
     struct hashmap *m = hashmap_create();
     ck_assert_ptr_nonnull(m);
@@ -230,6 +399,165 @@ START_TEST(test_hashmap_copy) {
 }
 END_TEST
 
+/*
+ * Point every key of 'm' at a fresh value, so a map whose values were shared
+ * by hashmap_copy() can be destroyed without freeing them twice.
+ */
+static void unshare_values(struct hashmap *m) {
+    for (unsigned int i = 0; i < m->size; i++) {
+        for (struct hashmap_entry *e = m->buckets[i]; e; e = e->next) {
+            int *v = malloc(sizeof *v);
+            *v = *((int *) e->value);
+            e->value = v;
+        }
+    }
+}
+
+START_TEST(test_hashmap_copy_bulk) {
+    struct hashmap *src = hashmap_create_with_hash(hash_xx64_len);
+    ck_assert_ptr_nonnull(src);
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    int *v;
+    for (int i = 0; i < 3000; i++) {
+        v = malloc(sizeof *v);
+        *v = i;
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(src, k, v);
+    }
+
+    /* An empty map with the same hash takes the same bucket layout. */
+    struct hashmap *dst = hashmap_create_with_hash(hash_xx64_len);
+    hashmap_copy(dst, src);
+    ck_assert_ptr_null(src->old_buckets);
+    ck_assert_uint_eq(dst->count, src->count);
+    ck_assert_uint_eq(dst->size, src->size);
+    for (unsigned int i = 0; i < src->size; i++) {
+        struct hashmap_entry *a = src->buckets[i];
+        struct hashmap_entry *b = dst->buckets[i];
+        for (; a && b; a = a->next, b = b->next) {
+            ck_assert_ptr_ne(a, b);
+            ck_assert_uint_eq(a->hash, b->hash);
+            ck_assert_uint_eq(a->len, b->len);
+            ck_assert_str_eq(a->key, b->key);
+            ck_assert_ptr_eq(a->value, b->value);
+        }
+        ck_assert_ptr_null(a);
+        ck_assert_ptr_null(b);
+    }
+    unshare_values(dst);
+    hashmap_destroy(dst);
+
+    /* A map with a different hash rehashes every key. */
+    dst = hashmap_create();
+    v = malloc(sizeof *v);
+    *v = -1;
+    hashmap_set(dst, "only-in-dst", v);
+    hashmap_copy(dst, src);
+    ck_assert_uint_eq(dst->count, 3001);
+    ck_assert_ptr_null(dst->old_buckets);
+    for (int i = 0; i < 3000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert_int_eq(*((int *) hashmap_get(dst, k)), i);
+        ck_assert_uint_eq(find_entry(dst, k)->hash, hash_shimmy2(k));
+    }
+    ck_assert_int_eq(*((int *) hashmap_get(dst, "only-in-dst")), -1);
+    unshare_values(dst);
+    hashmap_destroy(dst);
+    hashmap_destroy(src);
+}
+END_TEST
+
+START_TEST(test_hashmap_snapshot) {
+    struct hashmap *m = hashmap_create();
+    ck_assert_ptr_nonnull(m);
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    int *v;
+    for (int i = 0; i < 100; i++) {
+        v = malloc(sizeof *v);
+        *v = i;
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, v);
+    }
+
+    /* Taking a snapshot copies nothing. */
+    struct hashmap_snapshot *s = hashmap_snapshot(m);
+    ck_assert_ptr_nonnull(s);
+    ck_assert_ptr_eq(s->buckets, m->buckets);
+    ck_assert_uint_eq(s->count, 100);
+    int *old = hashmap_get(m, "1");
+
+    /* Update, delete and insert after the snapshot. */
+    v = malloc(sizeof *v);
+    *v = -1;
+    ck_assert(hashmap_set(m, "1", v));
+    ck_assert(hashmap_delete(m, "2"));
+    v = malloc(sizeof *v);
+    *v = 100;
+    ck_assert(hashmap_set(m, "100", v));
+    ck_assert_ptr_ne(s->buckets, m->buckets);
+
+    ck_assert_int_eq(*((int *) hashmap_get(m, "1")), -1);
+    ck_assert(!hashmap_exists(m, "2"));
+    ck_assert_int_eq(*((int *) hashmap_get(m, "100")), 100);
+    ck_assert_int_eq(*((int *) hashmap_snapshot_get(s, "1")), 1);
+    ck_assert_int_eq(*((int *) hashmap_snapshot_get(s, "2")), 2);
+    ck_assert(!hashmap_snapshot_exists(s, "100"));
+    ck_assert_ptr_null(hashmap_snapshot_get(s, 0));
+
+    /* Only the chains that were written to have been copied. */
+    unsigned int same = 0;
+    for (unsigned int i = 0; i < m->size; i++) {
+        same += m->buckets[i] == s->buckets[i];
+    }
+    ck_assert_uint_ge(same, m->size - 3);
+
+    /* A second snapshot sees the changes, and outlives the first. */
+    struct hashmap_snapshot *s2 = hashmap_snapshot(m);
+    ck_assert_int_eq(*((int *) hashmap_snapshot_get(s2, "1")), -1);
+    ck_assert(!hashmap_snapshot_exists(s2, "2"));
+    ck_assert(hashmap_snapshot_exists(s2, "100"));
+
+    /* Growing the map copies whatever the snapshots still share. */
+    for (int i = 101; i < 2000; i++) {
+        v = malloc(sizeof *v);
+        *v = i;
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, v);
+    }
+    for (int i = 0; i < 100; i += 2) {
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_delete(m, k);
+    }
+    ck_assert_uint_gt(m->size, s->size);
+    hashmap_snapshot_destroy(s);
+    for (int i = 0; i < 2000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        if (i == 1) {
+            ck_assert_int_eq(*((int *) hashmap_get(m, k)), -1);
+            ck_assert_int_eq(*((int *) hashmap_snapshot_get(s2, k)), -1);
+        } else if (i < 100 && i % 2 == 0) {
+            ck_assert(!hashmap_exists(m, k));
+            ck_assert(hashmap_snapshot_exists(s2, k) == (i != 2));
+        } else {
+            ck_assert_int_eq(*((int *) hashmap_get(m, k)), i);
+            ck_assert(hashmap_snapshot_exists(s2, k) == (i <= 100));
+        }
+    }
+    hashmap_snapshot_destroy(s2);
+    ck_assert_ptr_null(m->snapshots);
+    ck_assert_ptr_null(m->retired);
+    ck_assert(!m->shared);
+
+    /* Snapshots still open when the map is destroyed go with it. */
+    hashmap_snapshot(m);
+    hashmap_delete(m, "1");
+    hashmap_destroy(m);
+    free(old);
+}
+END_TEST
+
 START_TEST(test_hashmap_resize) {
     struct hashmap *m = hashmap_create();
     unsigned int size = m->size;
@@ -251,6 +579,681 @@ START_TEST(test_hashmap_resize) {
 }
 END_TEST
 
+START_TEST(test_hashmap_resize_incremental) {
+    struct hashmap *m = hashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    int *v;
+    bool migrating = false;
+    for (int i = 0; i < 2000; i++) {
+        v = malloc(sizeof *v);
+        *v = i;
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(hashmap_set(m, k, v));
+        if (m->old_buckets) {
+            migrating = true;
+            /* Old and new arrays together still hold every key so far. */
+            for (int j = 0; j <= i; j++) {
+                snprintf(k, KEYSIZE, "%d", j);
+                ck_assert(hashmap_exists(m, k));
+            }
+        }
+    }
+    ck_assert(migrating);
+    ck_assert_int_eq(m->count, 2000);
+
+    /* Deleting during a migration finds keys in either array. */
+    for (int i = 0; i < 2000; i += 3) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(hashmap_delete(m, k));
+    }
+    for (int i = 0; i < 2000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        v = hashmap_get(m, k);
+        if (i % 3) {
+            ck_assert_ptr_nonnull(v);
+            ck_assert_int_eq(*v, i);
+        } else {
+            ck_assert_ptr_null(v);
+        }
+    }
+
+    /* Enough operations drain the old array completely. */
+    for (unsigned int i = 0; i < m->size && m->old_buckets; i++) {
+        hashmap_get(m, "absent");
+    }
+    ck_assert_ptr_null(m->old_buckets);
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_resize_relink) {
+    struct hashmap *m = hashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    int *v = malloc(sizeof *v);
+    *v = -1;
+    hashmap_set(m, "first", v);
+    struct hashmap_entry *e = find_entry(m, "first");
+    ck_assert_ptr_nonnull(e);
+    ck_assert_uint_eq(e->hash, hash_shimmy2("first"));
+    char *key = e->key;
+
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    unsigned int size = m->size;
+    for (int i = 0; i < 1000; i++) {
+        v = malloc(sizeof *v);
+        *v = i;
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, v);
+    }
+    while (m->old_buckets) {
+        hashmap_get(m, "absent");
+    }
+    ck_assert_int_gt(m->size, size);
+
+    /* The same entry, with the same key allocation, moved across. */
+    ck_assert_ptr_eq(find_entry(m, "first"), e);
+    ck_assert_ptr_eq(e->key, key);
+    ck_assert_int_eq(*((int *) hashmap_get(m, "first")), -1);
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_options) {
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.capacity = 1000;
+    o.max_load = 0.75;
+    o.growth = 3;
+    struct hashmap *m = hashmap_create_with_options(&o);
+    ck_assert_ptr_nonnull(m);
+
+    /* Sized for the capacity, rounded up to a power of two. */
+    ck_assert_uint_eq(m->size, 2048);
+    ck_assert_uint_eq(m->growth, 4);
+    ck_assert(m->hash == hash_shimmy2_len);
+    hashmap_destroy(m);
+
+    /* Invalid policies */
+    hashmap_options_init(&o);
+    o.max_load = 0;
+    ck_assert_ptr_null(hashmap_create_with_options(&o));
+    hashmap_options_init(&o);
+    o.growth = 1;
+    ck_assert_ptr_null(hashmap_create_with_options(&o));
+    hashmap_options_init(&o);
+    o.min_load = 0.5;
+    ck_assert_ptr_null(hashmap_create_with_options(&o));
+
+    /* No options at all gives the defaults. */
+    m = hashmap_create_with_options(0);
+    ck_assert_ptr_nonnull(m);
+    ck_assert_uint_eq(m->size & (m->size - 1), 0);
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_reserve) {
+    struct hashmap *m = hashmap_create();
+    ck_assert_ptr_nonnull(m);
+    ck_assert(hashmap_reserve(m, 5000));
+    ck_assert_ptr_null(m->old_buckets);
+    unsigned int size = m->size;
+    ck_assert_uint_ge(size * m->max_load, 5000);
+
+    /* Filling up to the reserved capacity never resizes. */
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    int *v;
+    for (int i = 0; i < 5000; i++) {
+        v = malloc(sizeof *v);
+        *v = i;
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(hashmap_set(m, k, v));
+        ck_assert_uint_eq(m->size, size);
+        ck_assert_ptr_null(m->old_buckets);
+    }
+
+    /* Nor does deleting back down below the reserved capacity. */
+    for (int i = 0; i < 5000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(hashmap_delete(m, k));
+    }
+    ck_assert_uint_eq(m->size, size);
+
+    /* Reserving less than we have is a no-op. */
+    ck_assert(hashmap_reserve(m, 10));
+    ck_assert_uint_eq(m->size, size);
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_shrink) {
+    struct hashmap *m = hashmap_create();
+    ck_assert_ptr_nonnull(m);
+    unsigned int initial = m->size;
+
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    int *v;
+    for (int i = 0; i < 4000; i++) {
+        v = malloc(sizeof *v);
+        *v = i;
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, v);
+    }
+    unsigned int peak = m->size;
+    ck_assert_uint_gt(peak, initial);
+
+    for (int i = 0; i < 4000; i++) {
+        if (i % 100) {
+            snprintf(k, KEYSIZE, "%d", i);
+            ck_assert(hashmap_delete(m, k));
+        }
+    }
+    ck_assert_uint_lt(m->size, peak);
+    ck_assert_uint_ge(m->size, initial);
+    for (int i = 0; i < 4000; i += 100) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert_int_eq(*((int *) hashmap_get(m, k)), i);
+    }
+    hashmap_destroy(m);
+
+    /* A minimum load of zero turns shrinking off. */
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.min_load = 0;
+    m = hashmap_create_with_options(&o);
+    for (int i = 0; i < 4000; i++) {
+        v = malloc(sizeof *v);
+        *v = i;
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, v);
+    }
+    peak = m->size;
+    for (int i = 0; i < 4000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_delete(m, k);
+    }
+    ck_assert_uint_eq(m->size, peak);
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_values_word) {
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.values = HASHMAP_VALUES_WORD;
+    struct hashmap *m = hashmap_create_with_options(&o);
+    ck_assert_ptr_nonnull(m);
+    ck_assert(m->free_value == 0);
+
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    uintptr_t w;
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        w = (uintptr_t) i;
+        ck_assert(hashmap_set(m, k, &w));
+    }
+    /* Zero is a value like any other, and the map keeps its own copy. */
+    w = 99;
+    ck_assert_uint_eq(*(uintptr_t *) hashmap_get(m, "0"), 0);
+    ck_assert(hashmap_exists(m, "0"));
+    ck_assert_ptr_null(hashmap_get(m, "1000"));
+    ck_assert(!hashmap_set(m, "a", 0));
+
+    /* Counters can be bumped in place. */
+    struct hashmap_snapshot *s = hashmap_snapshot(m);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        w = *(uintptr_t *) hashmap_get(m, k) + 1;
+        ck_assert(hashmap_set(m, k, &w));
+    }
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert_uint_eq(*(uintptr_t *) hashmap_get(m, k), i + 1);
+        ck_assert_uint_eq(*(uintptr_t *) hashmap_snapshot_get(s, k), i);
+    }
+    ck_assert(hashmap_delete(m, "0"));
+    ck_assert_uint_eq(*(uintptr_t *) hashmap_snapshot_get(s, "0"), 0);
+    hashmap_snapshot_destroy(s);
+    hashmap_destroy(m);
+}
+END_TEST
+
+struct point {
+    double x;
+    double y;
+    int tag;
+};
+
+START_TEST(test_hashmap_values_inline) {
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.values = HASHMAP_VALUES_INLINE;
+    o.value_size = sizeof (struct point);
+    struct hashmap *m = hashmap_create_with_options(&o);
+    ck_assert_ptr_nonnull(m);
+
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    struct point p;
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        p.x = i;
+        p.y = -i;
+        p.tag = i;
+        ck_assert(hashmap_set(m, k, &p));
+    }
+    char long_key[300];
+    memset(long_key, 'k', sizeof long_key - 1);
+    long_key[sizeof long_key - 1] = 0;
+    p.tag = -1;
+    ck_assert(hashmap_set(m, long_key, &p));
+    ck_assert_int_eq(((struct point *) hashmap_get(m, long_key))->tag, -1);
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        struct point *q = hashmap_get(m, k);
+        ck_assert_uint_eq((uintptr_t) q % _Alignof (max_align_t), 0);
+        ck_assert(q->x == i && q->y == -i);
+        ck_assert_int_eq(q->tag, i);
+    }
+
+    /* Values are updated in place, or through a snapshot-safe copy. */
+    struct hashmap_snapshot *s = hashmap_snapshot(m);
+    p.tag = 5000;
+    ck_assert(hashmap_set(m, "5", &p));
+    ck_assert_int_eq(((struct point *) hashmap_get(m, "5"))->tag, 5000);
+    ck_assert_int_eq(((struct point *) hashmap_snapshot_get(s, "5"))->tag, 5);
+    hashmap_snapshot_destroy(s);
+
+    /* Copies carry their own inline values. */
+    struct hashmap *c = hashmap_create_with_options(&o);
+    hashmap_copy(c, m);
+    ck_assert_uint_eq(c->count, 1001);
+    ck_assert_ptr_ne(hashmap_get(c, "7"), hashmap_get(m, "7"));
+    ck_assert_int_eq(((struct point *) hashmap_get(c, "7"))->tag, 7);
+    ck_assert(hashmap_delete(c, "7"));
+    ck_assert_int_eq(((struct point *) hashmap_get(m, "7"))->tag, 7);
+    hashmap_destroy(c);
+    hashmap_destroy(m);
+
+    /* Inline values need a size. */
+    o.value_size = 0;
+    ck_assert_ptr_null(hashmap_create_with_options(&o));
+    o.values = HASHMAP_VALUES_INLINE + 1;
+    ck_assert_ptr_null(hashmap_create_with_options(&o));
+}
+END_TEST
+
+static int freed;
+
+static void count_free(void *v) {
+    freed++;
+    free(v);
+}
+
+START_TEST(test_hashmap_values_free) {
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.free_value = count_free;
+    struct hashmap *m = hashmap_create_with_options(&o);
+    ck_assert_ptr_nonnull(m);
+
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    for (int i = 0; i < 100; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, malloc(1));
+    }
+    freed = 0;
+    for (int i = 0; i < 10; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(hashmap_delete(m, k));
+    }
+    ck_assert_int_eq(freed, 10);
+
+    /* A value that is replaced is left to the caller. */
+    char *old = hashmap_get(m, "10");
+    ck_assert(hashmap_set(m, "10", malloc(1)));
+    ck_assert_int_eq(freed, 10);
+    free(old);
+
+    /* Values a snapshot can see are freed once it is gone. */
+    struct hashmap_snapshot *s = hashmap_snapshot(m);
+    ck_assert(hashmap_delete(m, "10"));
+    ck_assert_int_eq(freed, 10);
+    hashmap_snapshot_destroy(s);
+    ck_assert_int_eq(freed, 11);
+    hashmap_destroy(m);
+    ck_assert_int_eq(freed, 100);
+
+    /* With no destructor, the map leaves its values alone. */
+    int values[10];
+    o.free_value = 0;
+    m = hashmap_create_with_options(&o);
+    for (int i = 0; i < 10; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        values[i] = i;
+        hashmap_set(m, k, &values[i]);
+    }
+    ck_assert(hashmap_delete(m, "3"));
+    ck_assert_ptr_eq(hashmap_get(m, "4"), &values[4]);
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_get_or_insert) {
+    struct hashmap *m = hashmap_create();
+    ck_assert_ptr_nonnull(m);
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    bool created;
+
+    /* Count each key's occurrences, filling new values in place. */
+    for (int i = 0; i < 3000; i++) {
+        snprintf(k, KEYSIZE, "%d", i % 1000);
+        int **slot = hashmap_get_or_insert(m, k, &created);
+        ck_assert_ptr_nonnull(slot);
+        ck_assert(created == (i < 1000));
+        if (created) {
+            ck_assert_ptr_null(*slot);
+            *slot = calloc(1, sizeof **slot);
+        }
+        (**slot)++;
+    }
+    ck_assert_uint_eq(m->count, 1000);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert_int_eq(*((int *) hashmap_get(m, k)), 3);
+    }
+
+    /* Binary keys, and no flag wanted. */
+    int **slot = hashmap_get_or_insert_len(m, "a\0b", 3, 0);
+    *slot = malloc(sizeof **slot);
+    **slot = 7;
+    ck_assert_ptr_eq(hashmap_get_or_insert_len(m, "a\0b", 3, &created), slot);
+    ck_assert(!created);
+    ck_assert_int_eq(*((int *) hashmap_get_len(m, "a\0b", 3)), 7);
+    ck_assert_ptr_null(hashmap_get_or_insert(m, 0, &created));
+    ck_assert_ptr_null(hashmap_get_or_insert(0, "a", &created));
+    hashmap_destroy(m);
+
+    /* Word counters start at zero. */
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.values = HASHMAP_VALUES_WORD;
+    m = hashmap_create_with_options(&o);
+    for (int i = 0; i < 300; i++) {
+        snprintf(k, KEYSIZE, "%d", i % 100);
+        uintptr_t *count = hashmap_get_or_insert(m, k, 0);
+        (*count)++;
+    }
+    ck_assert_uint_eq(*(uintptr_t *) hashmap_get(m, "42"), 3);
+
+    /* A snapshot keeps the value it saw. */
+    struct hashmap_snapshot *s = hashmap_snapshot(m);
+    (*(uintptr_t *) hashmap_get_or_insert(m, "42", 0))++;
+    ck_assert_uint_eq(*(uintptr_t *) hashmap_get(m, "42"), 4);
+    ck_assert_uint_eq(*(uintptr_t *) hashmap_snapshot_get(s, "42"), 3);
+    hashmap_snapshot_destroy(s);
+    hashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_hashmap_take) {
+    struct hashmap *m = hashmap_create();
+    ck_assert_ptr_nonnull(m);
+    int *v = malloc(sizeof *v);
+    *v = 1;
+    hashmap_set(m, "a", v);
+
+    int *out = 0;
+    ck_assert(!hashmap_take(m, "b", &out));
+    ck_assert_ptr_null(out);
+    ck_assert(hashmap_take(m, "a", &out));
+    ck_assert_ptr_eq(out, v);
+    ck_assert(!hashmap_exists(m, "a"));
+    ck_assert_uint_eq(m->count, 0);
+    ck_assert(!hashmap_take(m, "a", 0));
+
+    /* While a snapshot can still see a value, it cannot be taken. */
+    hashmap_set(m, "a", out);
+    struct hashmap_snapshot *s = hashmap_snapshot(m);
+    out = 0;
+    ck_assert(!hashmap_take(m, "a", &out));
+    ck_assert_ptr_null(out);
+    hashmap_snapshot_destroy(s);
+    ck_assert(hashmap_take_len(m, "a", 1, &out));
+    ck_assert_int_eq(*out, 1);
+    free(out);
+    hashmap_destroy(m);
+
+    /* Inline values are copied out. */
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.values = HASHMAP_VALUES_INLINE;
+    o.value_size = 3 * sizeof (int);
+    m = hashmap_create_with_options(&o);
+    int in[3] = {1, 2, 3}, got[3] = {0};
+    hashmap_set(m, "x", in);
+    s = hashmap_snapshot(m);
+    ck_assert(hashmap_take(m, "x", got));
+    ck_assert_int_eq(got[2], 3);
+    ck_assert(!hashmap_exists(m, "x"));
+    ck_assert_int_eq(((int *) hashmap_snapshot_get(s, "x"))[1], 2);
+    hashmap_snapshot_destroy(s);
+    hashmap_destroy(m);
+}
+END_TEST
+
+static unsigned long hash_constant(const char *k, const size_t len) {
+    (void) k;
+    (void) len;
+    return 0;
+}
+
+START_TEST(test_hashmap_stats) {
+    struct hashmap_stats st;
+    hashmap_stats(0, &st);
+    ck_assert_uint_eq(st.buckets, 0);
+
+    struct hashmap *m = hashmap_create_with_hash(hash_xx64_len);
+    ck_assert_ptr_nonnull(m);
+    hashmap_stats(m, &st);
+    ck_assert_uint_eq(st.count, 0);
+    ck_assert_uint_eq(st.buckets, m->size);
+    ck_assert_uint_eq(st.chains[0], m->size);
+    ck_assert(st.empty_ratio == 1.0);
+    ck_assert_uint_eq(st.resizes, 0);
+
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    int *v;
+    for (int i = 0; i < 1000; i++) {
+        v = malloc(sizeof *v);
+        *v = i;
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, v);
+    }
+    hashmap_stats(m, &st);
+    ck_assert_uint_eq(st.count, 1000);
+    ck_assert_uint_gt(st.resizes, 0);
+    size_t buckets = 0, entries = 0;
+    for (size_t i = 0; i < HASHMAP_STATS_CHAINS; i++) {
+        buckets += st.chains[i];
+        entries += i * st.chains[i];
+    }
+    ck_assert_uint_eq(buckets, st.buckets);
+    ck_assert_uint_le(entries, 1000);
+    ck_assert_uint_ge(st.max_chain, 1);
+    ck_assert(st.empty_ratio > 0 && st.empty_ratio < 1);
+    ck_assert(st.hit_probes >= 1 && st.hit_probes <= st.max_chain);
+    ck_assert(st.miss_probes == 1000.0 / st.buckets);
+    ck_assert_uint_eq(st.bucket_bytes,
+            ((size_t) m->size + m->old_size) * sizeof (void *));
+    ck_assert_uint_eq(st.key_bytes, 10 * 2 + 90 * 3 + 900 * 4);
+    ck_assert_uint_ge(st.entry_bytes,
+            1000 * sizeof (struct hashmap_entry) + st.key_bytes);
+    hashmap_destroy(m);
+
+    /* Every key in one chain. */
+    m = hashmap_create_with_hash(hash_constant);
+    for (int i = 0; i < 10; i++) {
+        v = malloc(sizeof *v);
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, v);
+    }
+    hashmap_stats(m, &st);
+    ck_assert_uint_eq(st.max_chain, 10);
+    ck_assert_uint_eq(st.chains[HASHMAP_STATS_CHAINS - 1], 1);
+    ck_assert_uint_eq(st.chains[0], st.buckets - 1);
+    ck_assert(st.hit_probes == 5.5);
+
+#ifdef HASHMAP_COUNTERS
+    ck_assert(st.counted);
+    ck_assert_uint_eq(st.counters.inserts, 10);
+    hashmap_get(m, "9");
+    hashmap_get(m, "0");
+    hashmap_get(m, "x");
+    hashmap_get_or_insert(m, "0", 0);
+    hashmap_delete(m, "1");
+    hashmap_stats(m, &st);
+    ck_assert_uint_eq(st.counters.lookups, 3);
+    ck_assert_uint_eq(st.counters.hits, 2);
+    ck_assert_uint_eq(st.counters.hit_probes, 1 + 10);
+    ck_assert_uint_eq(st.counters.miss_probes, 10);
+    ck_assert_uint_eq(st.counters.updates, 1);
+    ck_assert_uint_eq(st.counters.deletes, 1);
+#else
+    ck_assert(!st.counted);
+    ck_assert_uint_eq(st.counters.lookups, 0);
+#endif
+    hashmap_destroy(m);
+}
+END_TEST
+
+static char *string_value(const char *s) {
+    char *v = malloc(strlen(s) + 1);
+    strcpy(v, s);
+    return v;
+}
+
+START_TEST(test_hashmap_interned) {
+    struct intern *t = intern_create();
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.intern = t;
+    struct hashmap *a = hashmap_create_with_options(&o);
+    struct hashmap *b = hashmap_create_with_options(&o);
+    ck_assert_ptr_eq(a->intern, t);
+
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(hashmap_set(a, k, string_value(k)));
+        ck_assert(hashmap_set(b, k, string_value("b")));
+    }
+    ck_assert(hashmap_set_len(a, "a\0b", 3, string_value("binary")));
+
+    /* Each key string is kept once, in the table, for both maps. */
+    ck_assert_uint_eq(t->count, 1001);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert_str_eq((const char *) hashmap_get(a, k), k);
+        ck_assert_str_eq((const char *) hashmap_get(b, k), "b");
+        const char *h = intern_find(t, k);
+        ck_assert_ptr_nonnull(h);
+        ck_assert(hashmap_exists_interned(a, h));
+        ck_assert_str_eq((const char *) hashmap_get_interned(a, h), k);
+        ck_assert_str_eq((const char *) hashmap_get_interned(b, h), "b");
+    }
+    ck_assert_str_eq((const char *) hashmap_get_len(a, "a\0b", 3), "binary");
+    ck_assert(!hashmap_exists_len(b, "a\0b", 3));
+    ck_assert(!hashmap_exists_interned(b, intern_find_len(t, "a\0b", 3)));
+
+    /* Entries hold the handle, and give back the string. */
+    const char *seven = intern_find(t, "7");
+    struct hashmap_entry *e = 0;
+    size_t len;
+    for (unsigned int i = 0; i < a->size && !e; i++) {
+        for (e = a->buckets[i]; e; e = e->next) {
+            if (hashmap_entry_key(a, e, &len) == seven) {
+                break;
+            }
+        }
+    }
+    for (unsigned int i = 0; i < a->old_size && !e; i++) {
+        for (e = a->old_buckets[i]; e; e = e->next) {
+            if (hashmap_entry_key(a, e, &len) == seven) {
+                break;
+            }
+        }
+    }
+    ck_assert_ptr_nonnull(e);
+    ck_assert_uint_eq(e->len, sizeof seven);
+    ck_assert_uint_eq(len, 1);
+    ck_assert_str_eq(hashmap_entry_key(a, e, &len), "7");
+
+    /* Lookups of strings never added leave the table alone. */
+    ck_assert_ptr_null(hashmap_get(a, "x"));
+    ck_assert(!hashmap_exists(a, "x"));
+    ck_assert(!hashmap_delete(a, "x"));
+    ck_assert_ptr_null(intern_find(t, "x"));
+    ck_assert_uint_eq(t->count, 1001);
+
+    /* A key interned by one map is still missing from the other. */
+    const char *x = intern_add(t, "x");
+    ck_assert(hashmap_set_interned(a, x, string_value("x")));
+    ck_assert_str_eq((const char *) hashmap_get(a, "x"), "x");
+    ck_assert(!hashmap_exists_interned(b, x));
+    ck_assert_ptr_null(hashmap_get_interned(b, x));
+
+    /* Handles only mean anything to a map with an intern table. */
+    struct hashmap *plain = hashmap_create();
+    ck_assert(!hashmap_set_interned(plain, x, (void *) "x"));
+    ck_assert_ptr_null(hashmap_get_interned(plain, x));
+
+    struct hashmap_snapshot *snap = hashmap_snapshot(a);
+    ck_assert(hashmap_delete_interned(a, x));
+    ck_assert(!hashmap_delete_interned(a, x));
+    ck_assert(hashmap_delete(a, "0"));
+    ck_assert(!hashmap_exists(a, "0"));
+    ck_assert(!hashmap_exists(a, "x"));
+    ck_assert_str_eq((const char *) hashmap_snapshot_get(snap, "x"), "x");
+    ck_assert_str_eq((const char *) hashmap_snapshot_get(snap, "0"), "0");
+    ck_assert_ptr_null(hashmap_snapshot_get(snap, "y"));
+    hashmap_snapshot_destroy(snap);
+
+    /* Copies into maps with and without the table. */
+    o.free_value = 0;
+    struct hashmap *c = hashmap_create_with_options(&o);
+    hashmap_copy(c, a);
+    hashmap_copy(plain, a);
+    ck_assert_uint_eq(c->count, 1000);
+    ck_assert_uint_eq(plain->count, 1000);
+    ck_assert_str_eq((const char *) hashmap_get(c, "999"), "999");
+    ck_assert_str_eq((const char *) hashmap_get(plain, "999"), "999");
+    ck_assert_str_eq((const char *) hashmap_get_len(plain, "a\0b", 3),
+            "binary");
+    ck_assert_uint_eq(t->count, 1002);
+    plain->free_value = 0;
+    hashmap_destroy(plain);
+    hashmap_destroy(c);
+
+    hashmap_destroy(a);
+    hashmap_destroy(b);
+    intern_destroy(t);
+}
+END_TEST
+
 Suite *hashmap_suite(void) {
     Suite *s;
     TCase *tc;
@@ -258,6 +1261,8 @@ Suite *hashmap_suite(void) {
     s = suite_create("Hashmap");
     tc = tcase_create("Create/destroy");
     tcase_add_test(tc, test_hashmap_create);
+    tcase_add_test(tc, test_hashmap_create_with_hash);
+    tcase_add_test(tc, test_hashmap_options);
     tcase_add_test(tc, test_hashmap_destroy);
     suite_add_tcase(s, tc);
 
@@ -265,6 +1270,11 @@ Suite *hashmap_suite(void) {
     tcase_add_test(tc, test_hashmap_set);
     tcase_add_test(tc, test_hashmap_get);
     tcase_add_test(tc, test_hashmap_delete);
+    tcase_add_test(tc, test_hashmap_long_key);
+    tcase_add_test(tc, test_hashmap_binary_keys);
+    tcase_add_test(tc, test_hashmap_many);
+    tcase_add_test(tc, test_hashmap_get_or_insert);
+    tcase_add_test(tc, test_hashmap_take);
     suite_add_tcase(s, tc);
 
     tc = tcase_create("Existence");
@@ -273,10 +1283,30 @@ Suite *hashmap_suite(void) {
 
     tc = tcase_create("Copy");
     tcase_add_test(tc, test_hashmap_copy);
+    tcase_add_test(tc, test_hashmap_copy_bulk);
+    tcase_add_test(tc, test_hashmap_snapshot);
     suite_add_tcase(s, tc);
 
     tc = tcase_create("Resize");
     tcase_add_test(tc, test_hashmap_resize);
+    tcase_add_test(tc, test_hashmap_resize_incremental);
+    tcase_add_test(tc, test_hashmap_resize_relink);
+    tcase_add_test(tc, test_hashmap_reserve);
+    tcase_add_test(tc, test_hashmap_shrink);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Values");
+    tcase_add_test(tc, test_hashmap_values_word);
+    tcase_add_test(tc, test_hashmap_values_inline);
+    tcase_add_test(tc, test_hashmap_values_free);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Stats");
+    tcase_add_test(tc, test_hashmap_stats);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Interned keys");
+    tcase_add_test(tc, test_hashmap_interned);
     suite_add_tcase(s, tc);
     return s;
 }
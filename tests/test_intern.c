@@ -0,0 +1,120 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "./util.h"
+#include "../intern.h"
+
+#define KEYSIZE 16
+
+START_TEST(test_intern_create) {
+    struct intern *t = intern_create();
+    ck_assert_ptr_nonnull(t);
+    ck_assert_uint_eq(t->count, 0);
+    ck_assert(t->hash == hash_xx64_len);
+    ck_assert_ptr_null(intern_find(t, "a"));
+    ck_assert_ptr_null(intern_add(t, 0));
+    ck_assert_ptr_null(intern_add(0, "a"));
+    ck_assert_ptr_null(intern_find(0, "a"));
+    intern_destroy(t);
+
+    t = intern_create_with_hash(hash_wy_len);
+    ck_assert(t->hash == hash_wy_len);
+    intern_destroy(t);
+
+    /* Doesn't crash */
+    intern_destroy(0);
+}
+END_TEST
+
+START_TEST(test_intern_add) {
+    struct intern *t = intern_create();
+    char k[KEYSIZE] = "hello";
+    const char *h = intern_add(t, k);
+    ck_assert_ptr_nonnull(h);
+    ck_assert_ptr_ne(h, k);
+    ck_assert_str_eq(h, "hello");
+    ck_assert_uint_eq(intern_len(h), 5);
+    ck_assert_uint_eq(intern_hash(h), hash_xx64_len("hello", 5));
+    ck_assert_uint_eq(t->count, 1);
+
+    /* The same string gives the same handle, from any copy of it. */
+    ck_assert_ptr_eq(intern_add(t, "hello"), h);
+    ck_assert_ptr_eq(intern_find(t, "hello"), h);
+    ck_assert_ptr_eq(intern_add_len(t, "hello, world", 5), h);
+    ck_assert_uint_eq(t->count, 1);
+    ck_assert_ptr_ne(intern_add(t, "hell"), h);
+    ck_assert_ptr_null(intern_find(t, "hello!"));
+
+    /* Empty and binary strings. */
+    const char *empty = intern_add(t, "");
+    ck_assert_str_eq(empty, "");
+    ck_assert_uint_eq(intern_len(empty), 0);
+    const char *b = intern_add_len(t, "a\0b", 3);
+    ck_assert_uint_eq(intern_len(b), 3);
+    ck_assert_int_eq(memcmp(b, "a\0b", 4), 0);
+    ck_assert_ptr_eq(intern_find_len(t, "a\0b", 3), b);
+    ck_assert_ptr_null(intern_find_len(t, "a\0c", 3));
+    ck_assert_ptr_ne(intern_add(t, "a"), b);
+
+    /* Strings too large for the slab. */
+    char *big = malloc(4096);
+    memset(big, 'x', 4096);
+    const char *hb = intern_add_len(t, big, 4096);
+    ck_assert_uint_eq(intern_len(hb), 4096);
+    ck_assert_ptr_eq(intern_find_len(t, big, 4096), hb);
+    free(big);
+    intern_destroy(t);
+}
+END_TEST
+
+START_TEST(test_intern_grow) {
+    struct intern *t = intern_create();
+    const char *h[5000];
+    char k[KEYSIZE];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        h[i] = intern_add(t, k);
+        ck_assert_ptr_nonnull(h[i]);
+    }
+    ck_assert_uint_eq(t->count, 5000);
+    ck_assert_uint_ge(t->size, 4096);
+
+    /* Handles survive the table growing. */
+    for (int i = 0; i < 5000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert_str_eq(h[i], k);
+        ck_assert_ptr_eq(intern_find(t, k), h[i]);
+        ck_assert_ptr_eq(intern_add(t, k), h[i]);
+    }
+    ck_assert_uint_eq(t->count, 5000);
+    intern_destroy(t);
+}
+END_TEST
+
+Suite *intern_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Intern");
+    tc = tcase_create("Intern");
+    tcase_add_test(tc, test_intern_create);
+    tcase_add_test(tc, test_intern_add);
+    tcase_add_test(tc, test_intern_grow);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = intern_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,179 @@
+#define _POSIX_C_SOURCE 200809L
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "./util.h"
+#include "../mhashmap.h"
+#include "../intern.h"
+
+#define KEYSIZE 16
+
+static size_t string_size(const void *v) {
+    return strlen(v) + 1;
+}
+
+static char *string_value(const char *s) {
+    char *v = malloc(strlen(s) + 1);
+    strcpy(v, s);
+    return v;
+}
+
+/*
+ * Create an empty temporary file, and write its name into 'path'.
+ */
+static void temp_file(char *path) {
+    strcpy(path, "/tmp/test_mhashmap.XXXXXX");
+    int fd = mkstemp(path);
+    ck_assert_int_ge(fd, 0);
+    close(fd);
+}
+
+START_TEST(test_mhashmap_empty) {
+    char path[32];
+    temp_file(path);
+    struct hashmap *m = hashmap_create();
+    ck_assert(mhashmap_write(m, path, string_size));
+    struct mhashmap *f = mhashmap_open(path);
+    ck_assert_ptr_nonnull(f);
+    ck_assert_uint_eq(f->count, 0);
+    ck_assert(!mhashmap_exists(f, "a"));
+    ck_assert(!mhashmap_exists(f, ""));
+    ck_assert_ptr_null(mhashmap_get(f, 0, 0));
+    mhashmap_close(f);
+    hashmap_destroy(m);
+
+    /* Invalid arguments */
+    ck_assert(!mhashmap_write(0, path, string_size));
+    ck_assert_ptr_null(mhashmap_open(0));
+    ck_assert_ptr_null(mhashmap_open("/nonexistent/file"));
+    unlink(path);
+}
+END_TEST
+
+START_TEST(test_mhashmap_get) {
+    char path[32];
+    temp_file(path);
+    struct hashmap *m = hashmap_create();
+    char k[KEYSIZE];
+    for (int i = 0; i < 3000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        hashmap_set(m, k, string_value(k));
+    }
+    hashmap_set(m, "", string_value("empty"));
+    hashmap_set_len(m, "a\0b", 3, string_value("binary"));
+    ck_assert(mhashmap_write(m, path, string_size));
+    hashmap_destroy(m);
+
+    struct mhashmap *f = mhashmap_open(path);
+    ck_assert_ptr_nonnull(f);
+    ck_assert_uint_eq(f->count, 3002);
+    size_t size;
+    for (int i = 0; i < 3000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        const char *v = mhashmap_get(f, k, &size);
+        ck_assert_ptr_nonnull(v);
+        ck_assert_str_eq(v, k);
+        ck_assert_uint_eq(size, strlen(k) + 1);
+        ck_assert_uint_eq((uintptr_t) v % 8, 0);
+    }
+    ck_assert_str_eq((const char *) mhashmap_get(f, "", 0), "empty");
+    ck_assert_str_eq(
+            (const char *) mhashmap_get_len(f, "a\0b", 3, 0), "binary");
+    ck_assert(!mhashmap_exists(f, "a"));
+    ck_assert(!mhashmap_exists(f, "3000"));
+    ck_assert(!mhashmap_exists_len(f, "a\0c", 3));
+    mhashmap_close(f);
+    unlink(path);
+}
+END_TEST
+
+START_TEST(test_mhashmap_hashes) {
+    char path[32];
+    temp_file(path);
+    /*
+     * Maps hashed with xx64 or otherwise, part way through a resize, and
+     * with interned keys.
+     */
+    struct intern *t = intern_create();
+    struct hashmap_options o;
+    hashmap_options_init(&o);
+    o.intern = t;
+    struct hashmap *a = hashmap_create_with_hash(hash_xx64_len);
+    struct hashmap *b = hashmap_create_with_hash(hash_wy_len);
+    struct hashmap *c = hashmap_create_with_options(&o);
+    char k[KEYSIZE];
+    for (int i = 0; i < 1025; i++) {
+        snprintf(k, KEYSIZE, "key:%d", i);
+        hashmap_set(a, k, string_value(k));
+        hashmap_set(b, k, string_value(k));
+        hashmap_set(c, k, string_value(k));
+    }
+    ck_assert_ptr_nonnull(b->old_buckets);
+
+    struct hashmap *maps[] = {a, b, c};
+    for (size_t j = 0; j < 3; j++) {
+        ck_assert(mhashmap_write(maps[j], path, string_size));
+        struct mhashmap *f = mhashmap_open(path);
+        ck_assert_ptr_nonnull(f);
+        ck_assert_uint_eq(f->count, 1025);
+        ck_assert_uint_eq(f->nbuckets, 2048);
+        for (int i = 0; i < 1025; i++) {
+            snprintf(k, KEYSIZE, "key:%d", i);
+            ck_assert_str_eq((const char *) mhashmap_get(f, k, 0), k);
+        }
+        mhashmap_close(f);
+        hashmap_destroy(maps[j]);
+    }
+    intern_destroy(t);
+    unlink(path);
+}
+END_TEST
+
+START_TEST(test_mhashmap_invalid) {
+    char path[32];
+    temp_file(path);
+    FILE *fp = fopen(path, "w");
+    fputs("not a hashmap file, just some text", fp);
+    fclose(fp);
+    ck_assert_ptr_null(mhashmap_open(path));
+
+    /* A file cut short no longer matches the size in its header. */
+    struct hashmap *m = hashmap_create();
+    hashmap_set(m, "a", string_value("a"));
+    ck_assert(mhashmap_write(m, path, string_size));
+    hashmap_destroy(m);
+    ck_assert(truncate(path, sizeof (struct mhashmap_header) + 8) == 0);
+    ck_assert_ptr_null(mhashmap_open(path));
+    unlink(path);
+}
+END_TEST
+
+Suite *mhashmap_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Mapped hashmap file");
+    tc = tcase_create("Write/open");
+    tcase_add_test(tc, test_mhashmap_empty);
+    tcase_add_test(tc, test_mhashmap_get);
+    tcase_add_test(tc, test_mhashmap_hashes);
+    tcase_add_test(tc, test_mhashmap_invalid);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = mhashmap_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,238 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "./util.h"
+#include "../ohashmap.h"
+
+static int *int_value(const int i) {
+    int *v = malloc(sizeof *v);
+    *v = i;
+    return v;
+}
+
+START_TEST(test_ohashmap_create) {
+    struct ohashmap *m = ohashmap_create();
+    ck_assert_ptr_nonnull(m);
+    ck_assert_int_gt(m->size, 0);
+    ck_assert_int_eq(m->count, 0);
+    for (size_t i = 0; i < m->size; i++) {
+        ck_assert_int_eq(m->hashes[i], 0);
+    }
+    ohashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_ohashmap_set) {
+    struct ohashmap *m = ohashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    /* NULL value */
+    ck_assert(!ohashmap_set(m, "a", 0));
+
+    /* Set value in empty map */
+    ck_assert(ohashmap_set(m, "a", int_value(0)));
+    ck_assert_int_eq(m->count, 1);
+
+    /* Overwrite value for existing key */
+    ck_assert(ohashmap_set(m, "a", int_value(1)));
+    ck_assert_int_eq(m->count, 1);
+
+    /* Set values in colliding keys */
+    ck_assert(ohashmap_set(m, "anear", int_value(2)));
+    ck_assert_int_eq(m->count, 2);
+
+    ck_assert(ohashmap_set(m, "dicot", int_value(3)));
+    ck_assert_int_eq(m->count, 3);
+
+    /* Empty key */
+    ck_assert(ohashmap_set(m, "", int_value(4)));
+    ck_assert_int_eq(m->count, 4);
+
+    ohashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_ohashmap_get) {
+    struct ohashmap *m = ohashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    int *p;
+
+    /* Non-existent key */
+    ck_assert_ptr_null(ohashmap_get(m, "absent"));
+
+    ohashmap_set(m, "a", int_value(0));
+    p = ohashmap_get(m, "a");
+    ck_assert_ptr_nonnull(p);
+    ck_assert_int_eq(*p, 0);
+
+    /* Overwrite value for existing key */
+    ohashmap_set(m, "a", int_value(1));
+    p = ohashmap_get(m, "a");
+    ck_assert_ptr_nonnull(p);
+    ck_assert_int_eq(*p, 1);
+
+    ohashmap_set(m, "anear", int_value(2));
+    ohashmap_set(m, "dicot", int_value(3));
+    ohashmap_set(m, "", int_value(4));
+    ck_assert_int_eq(*((int *) ohashmap_get(m, "anear")), 2);
+    ck_assert_int_eq(*((int *) ohashmap_get(m, "dicot")), 3);
+    ck_assert_int_eq(*((int *) ohashmap_get(m, "")), 4);
+
+    ohashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_ohashmap_delete) {
+    struct ohashmap *m = ohashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    /* Delete non-existent key */
+    ck_assert(!ohashmap_delete(m, "absent"));
+
+    ohashmap_set(m, "a", int_value(0));
+    ck_assert(ohashmap_delete(m, "a"));
+    ck_assert_int_eq(m->count, 0);
+    ck_assert_ptr_null(ohashmap_get(m, "a"));
+
+    ohashmap_set(m, "anear", int_value(2));
+    ohashmap_set(m, "dicot", int_value(3));
+
+    ck_assert(ohashmap_delete(m, "anear"));
+    ck_assert_ptr_null(ohashmap_get(m, "anear"));
+    ck_assert_int_eq(*((int *) ohashmap_get(m, "dicot")), 3);
+    ck_assert_int_eq(m->count, 1);
+
+    ck_assert(ohashmap_delete(m, "dicot"));
+    ck_assert_ptr_null(ohashmap_get(m, "dicot"));
+    ck_assert_int_eq(m->count, 0);
+
+    ohashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_ohashmap_exists) {
+    struct ohashmap *m = ohashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    ck_assert(!ohashmap_exists(m, "absent"));
+
+    ohashmap_set(m, "a", int_value(0));
+    ohashmap_set(m, "anear", int_value(2));
+    ohashmap_set(m, "dicot", int_value(3));
+    ck_assert(ohashmap_exists(m, "a"));
+    ck_assert(ohashmap_exists(m, "anear"));
+    ck_assert(ohashmap_exists(m, "dicot"));
+
+    ohashmap_delete(m, "anear");
+    ck_assert(!ohashmap_exists(m, "anear"));
+    ck_assert(ohashmap_exists(m, "dicot"));
+    ck_assert(ohashmap_exists(m, "a"));
+
+    ohashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_ohashmap_resize) {
+    struct ohashmap *m = ohashmap_create();
+    ck_assert_ptr_nonnull(m);
+    unsigned int size = m->size;
+
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(ohashmap_set(m, k, int_value(i)));
+    }
+    ck_assert_int_gt(m->size, size);
+    ck_assert_int_eq(m->count, 5000);
+
+    /* Delete every other key, then check everything is where it should be. */
+    for (int i = 0; i < 5000; i += 2) {
+        snprintf(k, KEYSIZE, "%d", i);
+        ck_assert(ohashmap_delete(m, k));
+    }
+    ck_assert_int_eq(m->count, 2500);
+    for (int i = 0; i < 5000; i++) {
+        snprintf(k, KEYSIZE, "%d", i);
+        if (i % 2) {
+            ck_assert_int_eq(*((int *) ohashmap_get(m, k)), i);
+        } else {
+            ck_assert(!ohashmap_exists(m, k));
+        }
+    }
+    ohashmap_destroy(m);
+}
+END_TEST
+
+START_TEST(test_ohashmap_arena) {
+    struct ohashmap *m = ohashmap_create();
+    ck_assert_ptr_nonnull(m);
+
+    /* Keys are packed end to end, with their NULs */
+    ck_assert(ohashmap_set(m, "ab", int_value(0)));
+    ck_assert(ohashmap_set(m, "cde", int_value(1)));
+    ck_assert_uint_eq(m->arena_used, 7);
+
+    /* Deleted keys are dead until the arena grows, then dropped */
+    const size_t KEYSIZE = 16;
+    char k[KEYSIZE];
+    ck_assert(ohashmap_delete(m, "ab"));
+    ck_assert_uint_eq(m->arena_dead, 3);
+    const size_t arena_size = m->arena_size;
+    int n = 0;
+    while (m->arena_size == arena_size) {
+        snprintf(k, KEYSIZE, "key%d", n);
+        ck_assert(ohashmap_set(m, k, int_value(n)));
+        n++;
+    }
+    ck_assert_uint_eq(m->arena_dead, 0);
+    ck_assert(!ohashmap_exists(m, "ab"));
+    ck_assert_int_eq(*((int *) ohashmap_get(m, "cde")), 1);
+    for (int i = 0; i < n; i++) {
+        snprintf(k, KEYSIZE, "key%d", i);
+        ck_assert_int_eq(*((int *) ohashmap_get(m, k)), i);
+    }
+    ohashmap_destroy(m);
+}
+END_TEST
+
+Suite *ohashmap_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Open-addressing hashmap");
+    tc = tcase_create("Create/destroy");
+    tcase_add_test(tc, test_ohashmap_create);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Set/get/delete");
+    tcase_add_test(tc, test_ohashmap_set);
+    tcase_add_test(tc, test_ohashmap_get);
+    tcase_add_test(tc, test_ohashmap_delete);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Existence");
+    tcase_add_test(tc, test_ohashmap_exists);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Resize");
+    tcase_add_test(tc, test_ohashmap_resize);
+    tcase_add_test(tc, test_ohashmap_arena);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = ohashmap_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
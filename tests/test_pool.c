@@ -0,0 +1,110 @@
+#include <check.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "./util.h"
+#include "../pool.h"
+
+#define TASKS 1000
+
+struct counts {
+    atomic_int runs[TASKS];
+    atomic_int total;
+};
+
+static void count_task(void *arg, int task) {
+    struct counts *c = arg;
+    atomic_fetch_add(&c->runs[task], 1);
+    atomic_fetch_add(&c->total, 1);
+}
+
+/*
+ * Run 'tasks' counting tasks on 'pool', and assert that each ran once.
+ */
+static void check_run(struct pool *pool, int tasks) {
+    struct counts *c = calloc(1, sizeof *c);
+    ck_assert_ptr_nonnull(c);
+    pool_run(pool, count_task, c, tasks);
+    ck_assert_int_eq(atomic_load(&c->total), tasks);
+    for (int i = 0; i < tasks; i++) {
+        ck_assert_int_eq(atomic_load(&c->runs[i]), 1);
+    }
+    free(c);
+}
+
+START_TEST(test_pool_create) {
+    ck_assert_ptr_null(pool_create(0));
+    ck_assert_ptr_null(pool_create(-1));
+    ck_assert_int_eq(pool_size(0), 1);
+
+    struct pool *pool = pool_create(1);
+    ck_assert_ptr_nonnull(pool);
+    ck_assert_int_eq(pool_size(pool), 1);
+    pool_destroy(pool);
+
+    pool = pool_create(8);
+    ck_assert_ptr_nonnull(pool);
+    ck_assert_int_eq(pool_size(pool), 8);
+    pool_destroy(pool);
+
+    /* Doesn't crash */
+    pool_destroy(0);
+}
+END_TEST
+
+START_TEST(test_pool_run) {
+    /* Without a pool, on the calling thread */
+    check_run(0, TASKS);
+    check_run(0, 0);
+
+    const int sizes[] = {1, 2, 4, 16};
+    for (int i = 0; i < 4; i++) {
+        struct pool *pool = pool_create(sizes[i]);
+        ck_assert_ptr_nonnull(pool);
+        check_run(pool, 0);
+        check_run(pool, 1);
+        check_run(pool, 3);
+        check_run(pool, TASKS);
+        pool_destroy(pool);
+    }
+}
+END_TEST
+
+START_TEST(test_pool_reuse) {
+    /* Many short jobs one after another, on the same workers */
+    struct pool *pool = pool_create(4);
+    ck_assert_ptr_nonnull(pool);
+    for (int i = 0; i < 500; i++) {
+        check_run(pool, 1 + i % 17);
+    }
+    pool_destroy(pool);
+}
+END_TEST
+
+Suite *pool_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Worker pool");
+    tc = tcase_create("Core");
+
+    tcase_add_test(tc, test_pool_create);
+    tcase_add_test(tc, test_pool_run);
+    tcase_add_test(tc, test_pool_reuse);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = pool_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "./util.h"
+#include "../slab.h"
+
+START_TEST(test_slab_create) {
+    struct slab *s = slab_create();
+    ck_assert_ptr_nonnull(s);
+    ck_assert_ptr_null(s->blocks);
+    for (size_t i = 0; i < SLAB_CLASSES; i++) {
+        ck_assert_ptr_null(s->free[i]);
+    }
+    slab_destroy(s);
+
+    /* Doesn't crash */
+    slab_destroy(0);
+}
+END_TEST
+
+START_TEST(test_slab_alloc) {
+    struct slab *s = slab_create();
+    char *p[1000];
+    for (size_t i = 0; i < 1000; i++) {
+        size_t size = 1 + i % SLAB_MAX_SIZE;
+        p[i] = slab_alloc(s, size);
+        ck_assert_ptr_nonnull(p[i]);
+        ck_assert_uint_eq((uintptr_t) p[i] % SLAB_ALIGN, 0);
+        memset(p[i], (int) i, size);
+    }
+    /* No object was overwritten by a later one. */
+    for (size_t i = 0; i < 1000; i++) {
+        size_t size = 1 + i % SLAB_MAX_SIZE;
+        for (size_t j = 0; j < size; j++) {
+            ck_assert_int_eq((unsigned char) p[i][j], (unsigned char) i);
+        }
+    }
+    slab_destroy(s);
+}
+END_TEST
+
+START_TEST(test_slab_free) {
+    struct slab *s = slab_create();
+
+    /* A freed object is reused by the next allocation of its class. */
+    void *a = slab_alloc(s, 40);
+    slab_free(s, a, 40);
+    void *b = slab_alloc(s, 33);
+    ck_assert_ptr_eq(a, b);
+
+    /* ... but not by an allocation of a different class. */
+    slab_free(s, b, 33);
+    void *c = slab_alloc(s, 16);
+    ck_assert_ptr_ne(a, c);
+
+    /* Large objects bypass the slab. */
+    void *d = slab_alloc(s, SLAB_MAX_SIZE + 1);
+    ck_assert_ptr_nonnull(d);
+    slab_free(s, d, SLAB_MAX_SIZE + 1);
+
+    /* Doesn't crash */
+    slab_free(s, 0, 16);
+    slab_destroy(s);
+}
+END_TEST
+
+Suite *slab_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Slab allocator");
+    tc = tcase_create("Core");
+    tcase_add_test(tc, test_slab_create);
+    tcase_add_test(tc, test_slab_alloc);
+    tcase_add_test(tc, test_slab_free);
+    suite_add_tcase(s, tc);
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = slab_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,7 +1,10 @@
 #include <check.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <pthread.h>
 #include "./util.h"
+#include "../pool.h"
 #include "../slisti.h"
 
 START_TEST(test_slisti_create) {
@@ -9,7 +12,7 @@ START_TEST(test_slisti_create) {
     ck_assert_ptr_nonnull(list);
     ck_assert_ptr_null(list->next);
     ck_assert_int_eq(list->value, 0);
-    free(list);
+    slisti_destroy(list);
 }
 END_TEST
 
@@ -429,6 +432,483 @@ START_TEST(test_slisti_from_json) {
 }
 END_TEST
 
+/*
+ * Assert that the handle 'list' holds exactly the first 'num' values of
+ * 'expect', and that its tail and length match its cells.
+ */
+static void check_list(
+        const struct slisti_list *list,
+        const int expect[],
+        int num) {
+    ck_assert_int_eq(slisti_list_length(list), num);
+    ck_assert_int_eq(slisti_length(list->head), num);
+    const struct slisti *cell = list->head, *last = 0;
+    for(int i = 0; i < num; i++, last = cell, cell = cell->next) {
+        ck_assert_int_eq(cell->value, expect[i]);
+    }
+    ck_assert(list->tail == last);
+}
+
+START_TEST(test_slisti_list_create) {
+    struct slisti_list *list = slisti_list_create();
+    ck_assert_ptr_nonnull(list);
+    check_list(list, 0, 0);
+    ck_assert_ptr_null(slisti_list_get(list, 0));
+    ck_assert_ptr_null(slisti_list_get(list, -1));
+    ck_assert(!slisti_list_delete(list, 0));
+    slisti_list_destroy(list);
+
+    list = slisti_list_from_array((int[]){3, 1, 2}, 3);
+    check_list(list, (int[]){3, 1, 2}, 3);
+    slisti_list_destroy(list);
+
+    /* Doesn't crash */
+    slisti_list_destroy(0);
+    ck_assert_int_eq(slisti_list_length(0), 0);
+    ck_assert_ptr_null(slisti_list_append(0, 0));
+}
+END_TEST
+
+START_TEST(test_slisti_list_append) {
+    struct slisti_list *list = slisti_list_create();
+    int expect[1000];
+    for(int i = 0; i < 1000; i++) {
+        expect[i] = i;
+        struct slisti *cell = slisti_list_append(list, i);
+        ck_assert_ptr_nonnull(cell);
+        ck_assert(list->tail == cell);
+        ck_assert(slisti_list_get(list, -1) == cell);
+        ck_assert_int_eq(slisti_list_length(list), i + 1);
+    }
+    check_list(list, expect, 1000);
+    ck_assert_int_eq(slisti_list_get(list, -1000)->value, 0);
+    ck_assert_int_eq(slisti_list_get(list, 500)->value, 500);
+    ck_assert_ptr_null(slisti_list_get(list, 1000));
+    ck_assert_ptr_null(slisti_list_get(list, -1001));
+    ck_assert(slisti_list_find(list, 999) == list->tail);
+    ck_assert_ptr_null(slisti_list_find(list, 1000));
+    slisti_list_destroy(list);
+}
+END_TEST
+
+START_TEST(test_slisti_list_insert_delete) {
+    struct slisti_list *list = slisti_list_create();
+    ck_assert_ptr_nonnull(slisti_list_insert(list, 0, 0));
+    /* [0] */
+    ck_assert_ptr_nonnull(slisti_list_insert(list, 0, 1));
+    /* [1, 0] */
+    ck_assert(slisti_list_insert(list, 10, 2) == list->tail);
+    /* [1, 0, 2] */
+    ck_assert_ptr_nonnull(slisti_list_insert(list, -1, 3));
+    /* [1, 0, 3, 2] */
+    ck_assert(slisti_list_insert(list, -10, 4) == list->head);
+    /* [4, 1, 0, 3, 2] */
+    check_list(list, (int[]){4, 1, 0, 3, 2}, 5);
+
+    ck_assert(!slisti_list_delete(list, 5));
+    ck_assert(!slisti_list_delete(list, -6));
+    ck_assert(slisti_list_delete(list, -1));
+    /* [4, 1, 0, 3] */
+    check_list(list, (int[]){4, 1, 0, 3}, 4);
+    ck_assert(slisti_list_delete(list, 0));
+    ck_assert(slisti_list_delete(list, 1));
+    /* [1, 3] */
+    check_list(list, (int[]){1, 3}, 2);
+    ck_assert(slisti_list_append(list, 5) == list->tail);
+    check_list(list, (int[]){1, 3, 5}, 3);
+    ck_assert(slisti_list_delete(list, -1));
+    ck_assert(slisti_list_delete(list, -1));
+    ck_assert(slisti_list_delete(list, -1));
+    check_list(list, 0, 0);
+    ck_assert_ptr_null(list->head);
+    ck_assert(slisti_list_append(list, 6) == list->head);
+    check_list(list, (int[]){6}, 1);
+    slisti_list_destroy(list);
+}
+END_TEST
+
+START_TEST(test_slisti_list_slice) {
+    ck_assert_ptr_null(slisti_list_slice(0, 0, 0));
+
+    struct slisti_list *list = slisti_list_from_array(
+            (int[]){0, 1, 2, 3, 4}, 5);
+    struct slisti_list *slice = slisti_list_slice(list, 2, 1);
+    check_list(slice, 0, 0);
+    slisti_list_destroy(slice);
+
+    slice = slisti_list_slice(list, 0, -1);
+    check_list(slice, (int[]){0, 1, 2, 3}, 4);
+    slisti_list_destroy(slice);
+
+    slice = slisti_list_slice(list, -2, 10);
+    check_list(slice, (int[]){3, 4}, 2);
+    slisti_list_destroy(slice);
+    slisti_list_destroy(list);
+}
+END_TEST
+
+START_TEST(test_slisti_list_map_filter_reduce) {
+    ck_assert_ptr_null(slisti_list_map(0, &mod2));
+    ck_assert_ptr_null(slisti_list_filter(0, &is_even));
+    ck_assert_int_eq(slisti_list_reduce(0, &add), 0);
+
+    struct slisti_list *source = slisti_list_from_array(
+            (int[]){0, 1, 2, 3, -1, -2, -3}, 7);
+    struct slisti_list *dest = slisti_list_map(source, &mod2);
+    check_list(dest, (int[]){0, 1, 0, 1, -1, 0, -1}, 7);
+    slisti_list_destroy(dest);
+
+    dest = slisti_list_filter(source, &is_even);
+    check_list(dest, (int[]){0, 2, -2}, 3);
+    slisti_list_destroy(dest);
+
+    ck_assert_int_eq(slisti_list_reduce(source, &add), 0);
+    slisti_list_destroy(source);
+}
+END_TEST
+
+START_TEST(test_slisti_list_json) {
+    char *json = slisti_list_to_json(0);
+    ck_assert_str_eq(json, "[]");
+    free(json);
+
+    struct slisti_list *list = slisti_list_from_json(" [ ] ");
+    check_list(list, 0, 0);
+    json = slisti_list_to_json(list);
+    ck_assert_str_eq(json, "[]");
+    free(json);
+    slisti_list_destroy(list);
+
+    ck_assert_ptr_null(slisti_list_from_json("[0, 1, {}]"));
+    ck_assert_ptr_null(slisti_list_from_json("{}"));
+
+    list = slisti_list_from_json("\n[\n  1,\n  -1\n] ");
+    check_list(list, (int[]){1, -1}, 2);
+    json = slisti_list_to_json(list);
+    ck_assert_str_eq(json, "[1,-1]");
+    free(json);
+    slisti_list_destroy(list);
+}
+END_TEST
+
+START_TEST(test_slisti_builtins) {
+    ck_assert(slisti_sum(0) == 0);
+    ck_assert_int_eq(slisti_min(0), INT_MAX);
+    ck_assert_int_eq(slisti_max(0), INT_MIN);
+    ck_assert_int_eq(slisti_count(0, 0), 0);
+    ck_assert_ptr_null(slisti_list_add(0, 1));
+    ck_assert_ptr_null(slisti_list_filter_range(0, 0, 1));
+
+    /*
+     * The kernels themselves are tested in test_vec.c; here, check that the
+     * runs gathered from the list meet up on either side of each boundary.
+     */
+    const int lengths[] = {1, 255, 256, 257, 512, 513, 1000};
+    int input[1000], expect[1000];
+    for(int i = 0; i < 1000; i++) {
+        input[i] = i;
+    }
+    for(int l = 0; l < 7; l++) {
+        const int length = lengths[l];
+        struct slisti_list *source = slisti_list_from_array(input, length);
+        ck_assert(slisti_sum(source->head) ==
+                (long long) length * (length - 1) / 2);
+        ck_assert_int_eq(slisti_min(source->head), 0);
+        ck_assert_int_eq(slisti_max(source->head), length - 1);
+        ck_assert_int_eq(slisti_count(source->head, length - 1), 1);
+
+        struct slisti_list *dest = slisti_list_add(source, 1);
+        for(int i = 0; i < length; i++) {
+            expect[i] = i + 1;
+        }
+        check_list(dest, expect, length);
+        slisti_list_destroy(dest);
+
+        /* A middle third, which for the longer lists spans a run boundary */
+        int n = 0;
+        for(int i = length / 3; i <= 2 * length / 3; i++) {
+            expect[n++] = i;
+        }
+        dest = slisti_list_filter_range(source, length / 3, 2 * length / 3);
+        check_list(dest, expect, n);
+        slisti_list_destroy(dest);
+
+        dest = slisti_list_filter_gt(source, length - 1);
+        check_list(dest, 0, 0);
+        slisti_list_destroy(dest);
+        slisti_list_destroy(source);
+    }
+}
+END_TEST
+
+/*
+ * Return the first of 'x' and 'y' that is not zero: associative, with zero
+ * as its identity, but not commutative.
+ */
+static int first_nonzero(int x, int y) {
+    return x ? x : y;
+}
+
+static int max(int x, int y) {
+    return x > y ? x : y;
+}
+
+START_TEST(test_slisti_parallel) {
+    ck_assert_ptr_null(slisti_list_pmap(0, &mod2, 0));
+    ck_assert_ptr_null(slisti_list_pfilter(0, &is_even, 0));
+    ck_assert_int_eq(slisti_list_preduce(0, &add, 7, 0), 7);
+
+    const int lengths[] = {0, 100, 100000};
+    const int sizes[] = {1, 4, 32};
+    int *input = malloc(100000 * sizeof *input);
+    int *expect = malloc(100000 * sizeof *expect);
+    ck_assert_ptr_nonnull(input);
+    ck_assert_ptr_nonnull(expect);
+    for(int i = 0; i < 100000; i++) {
+        input[i] = i % 1000 - (i % 3) * 500;
+    }
+    input[0] = 0;
+    input[1] = -5;
+
+    for(int p = 0; p < 3; p++) {
+        struct pool *pool = pool_create(sizes[p]);
+        ck_assert_ptr_nonnull(pool);
+        for(int l = 0; l < 3; l++) {
+            const int n = lengths[l];
+            struct slisti_list *source = slisti_list_from_array(input, n);
+
+            struct slisti_list *dest = slisti_list_pmap(source, &mod2, pool);
+            for(int i = 0; i < n; i++) {
+                expect[i] = mod2(input[i]);
+            }
+            check_list(dest, expect, n);
+            slisti_list_destroy(dest);
+
+            dest = slisti_list_pfilter(source, &is_even, pool);
+            int count = 0;
+            for(int i = 0; i < n; i++) {
+                if(is_even(input[i])) {
+                    expect[count++] = input[i];
+                }
+            }
+            check_list(dest, expect, count);
+            slisti_list_destroy(dest);
+
+            int sum = 0, most = INT_MIN;
+            for(int i = 0; i < n; i++) {
+                sum += input[i];
+                most = input[i] > most ? input[i] : most;
+            }
+            ck_assert_int_eq(slisti_list_preduce(source, &add, 0, pool), sum);
+            ck_assert_int_eq(slisti_list_preduce(source, &max, INT_MIN, pool),
+                    most);
+            ck_assert_int_eq(
+                    slisti_list_preduce(source, &first_nonzero, 0, pool),
+                    n > 1 ? -5 : 0);
+            slisti_list_destroy(source);
+        }
+        pool_destroy(pool);
+    }
+    free(input);
+    free(expect);
+}
+END_TEST
+
+/*
+ * A map function that counts how many values it has seen.
+ */
+static int calls = 0;
+
+static int counted(int x) {
+    calls++;
+    return x;
+}
+
+static int twice(int x) {
+    return x * 2;
+}
+
+START_TEST(test_slisti_pipe) {
+    struct slisti_pipe pipe;
+    struct slisti_list *source = slisti_list_from_array(
+            (int[]){0, 1, 2, 3, -1, -2, -3, 4, 5, 6}, 10);
+
+    /* Same results as materialising each step */
+    struct slisti *mapped = slisti_map(source->head, &twice);
+    struct slisti *filtered = slisti_filter(mapped, &is_even);
+    const int expect = slisti_reduce(filtered, &add);
+    slisti_destroy(mapped);
+    slisti_destroy(filtered);
+    ck_assert_int_eq(slisti_pipe_reduce(slisti_pipe_filter(slisti_pipe_map(
+                        slisti_pipe_init(&pipe, source->head), &twice),
+                    &is_even), &add), expect);
+
+    slisti_pipe_init(&pipe, source->head);
+    slisti_pipe_filter(&pipe, &is_even);
+    slisti_pipe_map(&pipe, &mod2);
+    struct slisti_list *dest = slisti_pipe_collect(&pipe);
+    check_list(dest, (int[]){0, 0, 0, 0, 0}, 5);
+    slisti_list_destroy(dest);
+
+    /* Stages apply in the order they were added */
+    slisti_pipe_skip(slisti_pipe_filter(
+                slisti_pipe_init(&pipe, source->head), &is_even), 2);
+    dest = slisti_pipe_collect(&pipe);
+    check_list(dest, (int[]){-2, 4, 6}, 3);
+    slisti_list_destroy(dest);
+    slisti_pipe_filter(slisti_pipe_skip(
+                slisti_pipe_init(&pipe, source->head), 2), &is_even);
+    dest = slisti_pipe_collect(&pipe);
+    check_list(dest, (int[]){2, -2, 4, 6}, 4);
+    slisti_list_destroy(dest);
+
+    int out[10];
+    slisti_pipe_slice(slisti_pipe_init(&pipe, source->head), 3, 6);
+    ck_assert_int_eq(slisti_pipe_to_array(&pipe, out, 10), 3);
+    ck_assert_int_eq(out[0], 3);
+    ck_assert_int_eq(out[1], -1);
+    ck_assert_int_eq(out[2], -2);
+    slisti_pipe_init(&pipe, source->head);
+    ck_assert_int_eq(slisti_pipe_to_array(&pipe, out, 4), 4);
+    ck_assert_int_eq(out[3], 3);
+    ck_assert_int_eq(slisti_pipe_to_array(&pipe, out, 10), 6);
+    ck_assert_int_eq(out[0], -1);
+
+    char *json = slisti_pipe_to_json(slisti_pipe_take(slisti_pipe_map(
+                    slisti_pipe_init(&pipe, source->head), &twice), 3));
+    ck_assert_str_eq(json, "[0,2,4]");
+    free(json);
+    json = slisti_pipe_to_json(slisti_pipe_slice(
+                slisti_pipe_init(&pipe, source->head), 5, 5));
+    ck_assert_str_eq(json, "[]");
+    free(json);
+
+    /* The walk stops once the take stage is full */
+    calls = 0;
+    slisti_pipe_take(slisti_pipe_filter(slisti_pipe_map(
+                    slisti_pipe_init(&pipe, source->head), &counted),
+                &is_even), 2);
+    ck_assert_int_eq(slisti_pipe_reduce(&pipe, &add), 2);
+    ck_assert_int_eq(calls, 3);
+    calls = 0;
+    slisti_pipe_take(slisti_pipe_map(
+                slisti_pipe_init(&pipe, source->head), &counted), 0);
+    ck_assert_int_eq(slisti_pipe_reduce(&pipe, &add), 0);
+    ck_assert_int_eq(calls, 0);
+
+    /* Failures carry through to the terminal */
+    slisti_pipe_init(&pipe, source->head);
+    for(int i = 0; i < SLISTI_PIPE_STAGES; i++) {
+        ck_assert_ptr_nonnull(slisti_pipe_map(&pipe, &twice));
+    }
+    ck_assert_ptr_null(slisti_pipe_map(&pipe, &twice));
+    ck_assert_ptr_null(slisti_pipe_slice(&pipe, 0, 1));
+    ck_assert_ptr_null(slisti_pipe_slice(
+                slisti_pipe_init(&pipe, source->head), -2, -1));
+    ck_assert_ptr_null(slisti_pipe_collect(0));
+    ck_assert_ptr_null(slisti_pipe_to_json(0));
+    ck_assert_int_eq(slisti_pipe_to_array(0, out, 10), -1);
+    ck_assert_int_eq(slisti_pipe_reduce(0, &add), 0);
+    ck_assert(!slisti_pipe_next(0, out));
+
+    /* An empty source */
+    dest = slisti_pipe_collect(slisti_pipe_init(&pipe, 0));
+    check_list(dest, 0, 0);
+    slisti_list_destroy(dest);
+    slisti_list_destroy(source);
+}
+END_TEST
+
+START_TEST(test_slisti_cells_contiguous) {
+    int input[1000];
+    for(int i = 0; i < 1000; i++) {
+        input[i] = i;
+    }
+    /* Start on a fresh block, which all the cells below fit in. */
+    slisti_cells_flush();
+    struct slisti *list = slisti_from_array(input, 1000);
+    struct slisti *mapped = slisti_map(list, &mod2);
+
+    /* Cells are laid out in list order, but for a move to a new block. */
+    struct slisti *lists[] = {list, mapped};
+    for(int j = 0; j < 2; j++) {
+        int breaks = 0;
+        for(struct slisti *cell = lists[j]; cell->next; cell = cell->next) {
+            breaks += cell->next != cell + 1;
+        }
+        ck_assert_int_le(breaks, 1);
+    }
+    slisti_destroy(mapped);
+
+    /* Single deleted cells are reused. */
+    struct slisti *cell = slisti_get(list, 500);
+    ck_assert(slisti_delete(list, 500) == list);
+    struct slisti *new = slisti_create(7);
+    ck_assert(new == cell);
+    ck_assert_int_eq(new->value, 7);
+    ck_assert_ptr_null(new->next);
+    slisti_destroy(new);
+
+    /*
+     * Cells from a block the thread is no longer carving are not cached, so
+     * they cannot keep that block alive.
+     */
+    slisti_cells_flush();
+    cell = slisti_get(list, 1);
+    ck_assert(slisti_delete(list, 1) == list);
+    new = slisti_create(7);
+    ck_assert(new != cell);
+    slisti_destroy(new);
+    slisti_destroy(list);
+
+    /* Carving carries on after giving the memory back. */
+    slisti_cells_flush();
+    slisti_cells_flush();
+    list = slisti_from_array(input, 1000);
+    ck_assert_int_eq(slisti_length(list), 1000);
+    ck_assert_int_eq(slisti_get(list, -1)->value, 999);
+    slisti_destroy(list);
+}
+END_TEST
+
+#define CELLS_THREADS 4
+#define CELLS_PER_THREAD 10000
+
+static void *build_lists(void *arg) {
+    struct slisti **lists = arg;
+    struct slisti_list *list = slisti_list_create();
+    for(int i = 0; i < CELLS_PER_THREAD; i++) {
+        slisti_list_append(list, i);
+    }
+    lists[0] = slisti_slice(list->head, 0, CELLS_PER_THREAD / 2);
+    lists[1] = slisti_filter(list->head, &is_even);
+    slisti_list_destroy(list);
+    return 0;
+}
+
+START_TEST(test_slisti_cells_threads) {
+    /* Lists built by threads that have exited, freed by another thread. */
+    pthread_t threads[CELLS_THREADS];
+    struct slisti *lists[CELLS_THREADS][2];
+    for(int i = 0; i < CELLS_THREADS; i++) {
+        pthread_create(&threads[i], 0, build_lists, lists[i]);
+    }
+    for(int i = 0; i < CELLS_THREADS; i++) {
+        pthread_join(threads[i], 0);
+    }
+    for(int i = 0; i < CELLS_THREADS; i++) {
+        ck_assert_int_eq(slisti_length(lists[i][0]), CELLS_PER_THREAD / 2);
+        ck_assert_int_eq(slisti_length(lists[i][1]), CELLS_PER_THREAD / 2);
+        ck_assert_int_eq(slisti_get(lists[i][0], -1)->value,
+                CELLS_PER_THREAD / 2 - 1);
+        ck_assert_int_eq(slisti_get(lists[i][1], -1)->value,
+                CELLS_PER_THREAD - 2);
+        slisti_destroy(lists[i][0]);
+        slisti_destroy(lists[i][1]);
+    }
+}
+END_TEST
+
 Suite *slisti_suite(void) {
     Suite *s;
     TCase *tc;
@@ -452,6 +932,37 @@ Suite *slisti_suite(void) {
     tcase_add_test(tc, test_slisti_from_json);
     suite_add_tcase(s, tc);
 
+    tc = tcase_create("List handle");
+
+    tcase_add_test(tc, test_slisti_list_create);
+    tcase_add_test(tc, test_slisti_list_append);
+    tcase_add_test(tc, test_slisti_list_insert_delete);
+    tcase_add_test(tc, test_slisti_list_slice);
+    tcase_add_test(tc, test_slisti_list_map_filter_reduce);
+    tcase_add_test(tc, test_slisti_list_json);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Built-ins");
+
+    tcase_add_test(tc, test_slisti_builtins);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Parallel");
+
+    tcase_add_test(tc, test_slisti_parallel);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Pipeline");
+
+    tcase_add_test(tc, test_slisti_pipe);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("Cells");
+
+    tcase_add_test(tc, test_slisti_cells_contiguous);
+    tcase_add_test(tc, test_slisti_cells_threads);
+    suite_add_tcase(s, tc);
+
     return s;
 }
 
@@ -0,0 +1,458 @@
+#include <check.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <string.h>
+#include "./util.h"
+#include "../ulisti.h"
+
+/*
+ * Assert that 'list' holds exactly the first 'num' values of 'expect', and
+ * that its nodes and length are consistent.
+ */
+static void check_list(
+        const struct ulisti *list,
+        const int expect[],
+        int num) {
+    ck_assert_int_eq(ulisti_length(list), num);
+    int i = 0;
+    const struct ulisti_node *node = list->head, *last = 0;
+    for (; node; last = node, node = node->next) {
+        ck_assert_int_gt(node->count, 0);
+        ck_assert_int_le(node->count, ULISTI_NODE_SIZE);
+        for (int j = 0; j < node->count; j++, i++) {
+            ck_assert_int_lt(i, num);
+            ck_assert_int_eq(node->values[j], expect[i]);
+        }
+    }
+    ck_assert_int_eq(i, num);
+    ck_assert(list->tail == last);
+}
+
+START_TEST(test_ulisti_create) {
+    struct ulisti *list = ulisti_create();
+    ck_assert_ptr_nonnull(list);
+    ck_assert_ptr_null(list->head);
+    ck_assert_ptr_null(list->tail);
+    ck_assert_int_eq(ulisti_length(list), 0);
+    ck_assert_ptr_null(ulisti_get(list, 0));
+    ck_assert_ptr_null(ulisti_get(list, -1));
+    ulisti_destroy(list);
+
+    /* Doesn't crash */
+    ulisti_destroy(0);
+}
+END_TEST
+
+START_TEST(test_ulisti_from_array) {
+    const int SIZE = 1000;
+    int input[SIZE];
+    for (int i = 0; i < SIZE; i++) {
+        input[i] = i * 7919 - 500;
+    }
+    struct ulisti *list = ulisti_from_array(input, 0);
+    ck_assert_ptr_nonnull(list);
+    ck_assert_int_eq(ulisti_length(list), 0);
+    ulisti_destroy(list);
+
+    list = ulisti_from_array(input, SIZE);
+    ck_assert_ptr_nonnull(list);
+    check_list(list, input, SIZE);
+
+    /* Every node but the last is full. */
+    for (struct ulisti_node *node = list->head; node != list->tail;
+            node = node->next) {
+        ck_assert_int_eq(node->count, ULISTI_NODE_SIZE);
+    }
+    ulisti_destroy(list);
+}
+END_TEST
+
+START_TEST(test_ulisti_append) {
+    ck_assert(!ulisti_append(0, 1));
+
+    struct ulisti *list = ulisti_create();
+    int expect[1000];
+    for (int i = 0; i < 1000; i++) {
+        expect[i] = i;
+        ck_assert(ulisti_append(list, i));
+        ck_assert_int_eq(ulisti_length(list), i + 1);
+        ck_assert_int_eq(*ulisti_get(list, -1), i);
+    }
+    check_list(list, expect, 1000);
+    ulisti_destroy(list);
+}
+END_TEST
+
+START_TEST(test_ulisti_get) {
+    int input[200];
+    for (int i = 0; i < 200; i++) {
+        input[i] = i;
+    }
+    struct ulisti *list = ulisti_from_array(input, 200);
+    for (int i = 0; i < 200; i++) {
+        ck_assert_int_eq(*ulisti_get(list, i), i);
+        ck_assert_int_eq(*ulisti_get(list, i - 200), i);
+    }
+
+    /* Out of bounds */
+    ck_assert_ptr_null(ulisti_get(list, 200));
+    ck_assert_ptr_null(ulisti_get(list, -201));
+    ck_assert_ptr_null(ulisti_get(0, 0));
+
+    *ulisti_get(list, 100) = -1;
+    ck_assert_int_eq(*ulisti_get(list, -100), -1);
+    ulisti_destroy(list);
+}
+END_TEST
+
+START_TEST(test_ulisti_find) {
+    ck_assert_ptr_null(ulisti_find(0, 0));
+
+    int input[200];
+    for (int i = 0; i < 200; i++) {
+        input[i] = i % 100;
+    }
+    struct ulisti *list = ulisti_from_array(input, 200);
+    for (int i = 0; i < 100; i++) {
+        int *v = ulisti_find(list, i);
+        ck_assert_ptr_nonnull(v);
+        ck_assert_int_eq(*v, i);
+        ck_assert(v == ulisti_get(list, i));
+    }
+    ck_assert_ptr_null(ulisti_find(list, 100));
+    ck_assert_ptr_null(ulisti_find(list, -1));
+    ulisti_destroy(list);
+}
+END_TEST
+
+START_TEST(test_ulisti_slice) {
+    ck_assert_ptr_null(ulisti_slice(0, 0, 0));
+
+    int input[200];
+    for (int i = 0; i < 200; i++) {
+        input[i] = i;
+    }
+    struct ulisti *list = ulisti_from_array(input, 5);
+
+    /* Slices that include no elements. */
+    const int empty[][2] = {{0, 0}, {1, 0}, {-1, 0}, {2, 1}, {5, 6},
+        {-1, -2}};
+    for (size_t i = 0; i < sizeof empty / sizeof *empty; i++) {
+        struct ulisti *slice = ulisti_slice(list, empty[i][0], empty[i][1]);
+        ck_assert_ptr_nonnull(slice);
+        ck_assert_int_eq(ulisti_length(slice), 0);
+        ulisti_destroy(slice);
+    }
+
+    struct ulisti *slice = ulisti_slice(list, 0, 1);
+    check_list(slice, input, 1);
+    ulisti_destroy(slice);
+
+    slice = ulisti_slice(list, 0, -1);
+    check_list(slice, input, 4);
+    ulisti_destroy(slice);
+
+    slice = ulisti_slice(list, -2, -1);
+    check_list(slice, &input[3], 1);
+    ulisti_destroy(slice);
+
+    slice = ulisti_slice(list, -10, 10);
+    check_list(slice, input, 5);
+    ulisti_destroy(slice);
+    ulisti_destroy(list);
+
+    /* Slices spanning several nodes. */
+    list = ulisti_from_array(input, 200);
+    slice = ulisti_slice(list, 10, -10);
+    check_list(slice, &input[10], 180);
+    ulisti_destroy(slice);
+    slice = ulisti_slice(list, ULISTI_NODE_SIZE, 2 * ULISTI_NODE_SIZE);
+    check_list(slice, &input[ULISTI_NODE_SIZE], ULISTI_NODE_SIZE);
+    ulisti_destroy(slice);
+    ulisti_destroy(list);
+}
+END_TEST
+
+START_TEST(test_ulisti_insert) {
+    ck_assert(!ulisti_insert(0, 0, 0));
+
+    struct ulisti *list = ulisti_create();
+    ck_assert(ulisti_insert(list, 0, 0));
+    /* [0] */
+    ck_assert(ulisti_insert(list, 0, 1));
+    /* [1, 0] */
+    ck_assert(ulisti_insert(list, 10, 2));
+    /* [1, 0, 2] */
+    ck_assert(ulisti_insert(list, -1, 3));
+    /* [1, 0, 3, 2] */
+    ck_assert(ulisti_insert(list, -10, 4));
+    /* [4, 1, 0, 3, 2] */
+    check_list(list, (int[]){4, 1, 0, 3, 2}, 5);
+    ulisti_destroy(list);
+
+    /* Inserts into full nodes split them. */
+    int expect[1000];
+    int n = 0;
+    list = ulisti_create();
+    for (int i = 0; i < 1000; i++) {
+        const int pos = (i * 37) % (n + 1);
+        ck_assert(ulisti_insert(list, pos, i));
+        for (int j = n; j > pos; j--) {
+            expect[j] = expect[j - 1];
+        }
+        expect[pos] = i;
+        n++;
+    }
+    check_list(list, expect, 1000);
+    ulisti_destroy(list);
+}
+END_TEST
+
+START_TEST(test_ulisti_delete) {
+    ck_assert(!ulisti_delete(0, 0));
+
+    struct ulisti *list = ulisti_from_array((int[]){0, 1, 2, 3, 4}, 5);
+    ck_assert(ulisti_delete(list, 0));
+    check_list(list, (int[]){1, 2, 3, 4}, 4);
+
+    /* Non-existent index: positive */
+    ck_assert(!ulisti_delete(list, 4));
+    /* Non-existent index: negative */
+    ck_assert(!ulisti_delete(list, -5));
+    ck_assert_int_eq(ulisti_length(list), 4);
+
+    ck_assert(ulisti_delete(list, 2));
+    ck_assert(ulisti_delete(list, 1));
+    ck_assert(ulisti_delete(list, -1));
+    check_list(list, (int[]){1}, 1);
+    ck_assert(ulisti_delete(list, 0));
+    ck_assert_int_eq(ulisti_length(list), 0);
+    ck_assert_ptr_null(list->head);
+    ck_assert_ptr_null(list->tail);
+    ck_assert(ulisti_append(list, 5));
+    check_list(list, (int[]){5}, 1);
+    ulisti_destroy(list);
+
+    /* Deletes across nodes, which empty and merge them. */
+    int expect[1000];
+    for (int i = 0; i < 1000; i++) {
+        expect[i] = i;
+    }
+    list = ulisti_from_array(expect, 1000);
+    int n = 1000;
+    while (n > 0) {
+        const int pos = (n * 53 + 7) % n;
+        ck_assert(ulisti_delete(list, pos));
+        for (int j = pos; j < n - 1; j++) {
+            expect[j] = expect[j + 1];
+        }
+        n--;
+        if (n % 100 == 0) {
+            check_list(list, expect, n);
+        }
+    }
+    ck_assert_ptr_null(list->head);
+    ulisti_destroy(list);
+}
+END_TEST
+
+int mod2(int x) {
+    return x % 2;
+}
+
+bool is_even(int x) {
+    return (x % 2) == 0;
+}
+
+int add(int x, int y) {
+    return x + y;
+}
+
+START_TEST(test_ulisti_map_filter_reduce) {
+    ck_assert_ptr_null(ulisti_map(0, &mod2));
+    ck_assert_ptr_null(ulisti_filter(0, &is_even));
+    ck_assert_int_eq(ulisti_reduce(0, &add), 0);
+
+    int input[200], mapped[200], filtered[200];
+    int n = 0, sum = 0;
+    for (int i = 0; i < 200; i++) {
+        input[i] = i - 100;
+        mapped[i] = mod2(input[i]);
+        if (is_even(input[i])) {
+            filtered[n++] = input[i];
+        }
+        sum += input[i];
+    }
+    struct ulisti *source = ulisti_from_array(input, 200);
+    struct ulisti *dest = ulisti_map(source, &mod2);
+    check_list(dest, mapped, 200);
+    ulisti_destroy(dest);
+
+    dest = ulisti_filter(source, &is_even);
+    check_list(dest, filtered, n);
+    ulisti_destroy(dest);
+
+    ck_assert_int_eq(ulisti_reduce(source, &add), sum);
+    ulisti_destroy(source);
+}
+END_TEST
+
+START_TEST(test_ulisti_to_json) {
+    char *json = ulisti_to_json(0);
+    ck_assert_str_eq(json, "[]");
+    free(json);
+
+    struct ulisti *list = ulisti_create();
+    json = ulisti_to_json(list);
+    ck_assert_str_eq(json, "[]");
+    free(json);
+
+    ulisti_append(list, 0);
+    json = ulisti_to_json(list);
+    ck_assert_str_eq(json, "[0]");
+    free(json);
+
+    ulisti_append(list, 1);
+    json = ulisti_to_json(list);
+    ck_assert_str_eq(json, "[0,1]");
+    free(json);
+    ulisti_destroy(list);
+
+    const int SIZE = 10;
+    int input[] = {-339477778, 1951527226, 1011318566, -104064784, 501816327,
+        1320182898, 1345528803, 1262206431, 567697681, 1208321048};
+    list = ulisti_from_array(input, SIZE);
+    json = ulisti_to_json(list);
+    ck_assert_str_eq(json, "[-339477778,1951527226,1011318566,-104064784,"
+            "501816327,1320182898,1345528803,1262206431,567697681,"
+            "1208321048]");
+    free(json);
+    ulisti_destroy(list);
+}
+END_TEST
+
+START_TEST(test_ulisti_from_json) {
+    /* Various bogus inputs */
+    ck_assert_ptr_null(ulisti_from_json(""));
+    ck_assert_ptr_null(ulisti_from_json("{}"));
+    ck_assert_ptr_null(ulisti_from_json("[[1,2], [3,4]]"));
+    ck_assert_ptr_null(ulisti_from_json("[0, 1, {}]"));
+    ck_assert_ptr_null(ulisti_from_json("[0, 1"));
+
+    struct ulisti *list = ulisti_from_json(" [ ] ");
+    ck_assert_ptr_nonnull(list);
+    ck_assert_int_eq(ulisti_length(list), 0);
+    ulisti_destroy(list);
+
+    list = ulisti_from_json("\n[\n  1,\n  -1\n] ");
+    check_list(list, (int[]){1, -1}, 2);
+    ulisti_destroy(list);
+
+    /* Round trip through several nodes. */
+    int input[200];
+    for (int i = 0; i < 200; i++) {
+        input[i] = (i - 100) * 1000003;
+    }
+    list = ulisti_from_array(input, 200);
+    char *json = ulisti_to_json(list);
+    ulisti_destroy(list);
+    list = ulisti_from_json(json);
+    check_list(list, input, 200);
+    free(json);
+    ulisti_destroy(list);
+}
+END_TEST
+
+START_TEST(test_ulisti_builtins) {
+    ck_assert(ulisti_sum(0) == 0);
+    ck_assert_int_eq(ulisti_min(0), INT_MAX);
+    ck_assert_int_eq(ulisti_max(0), INT_MIN);
+    ck_assert_int_eq(ulisti_count(0, 0), 0);
+    ck_assert_ptr_null(ulisti_add(0, 1));
+    ck_assert_ptr_null(ulisti_filter_range(0, 0, 1));
+
+    /*
+     * The kernels themselves are tested in test_vec.c; here, check that they
+     * see every node of a list with several nodes, the last of them part
+     * full, and one split by insert.
+     */
+    int input[201], expect[201];
+    for (int i = 0; i < 200; i++) {
+        input[i] = (i * 7919 % 1999) - 999;
+    }
+    struct ulisti *source = ulisti_from_array(input, 200);
+    ck_assert(ulisti_insert(source, 30, 7));
+    memmove(&input[31], &input[30], 170 * sizeof(int));
+    input[30] = 7;
+    long long sum = 0;
+    for (int i = 0; i < 201; i++) {
+        sum += input[i];
+    }
+    ck_assert(ulisti_sum(source) == sum);
+    ck_assert_int_eq(ulisti_min(source), -999);
+    ck_assert_int_eq(ulisti_max(source), 997);
+    ck_assert_int_eq(ulisti_count(source, 7), 1);
+
+    struct ulisti *dest = ulisti_add(source, 1);
+    for (int i = 0; i < 201; i++) {
+        expect[i] = input[i] + 1;
+    }
+    check_list(dest, expect, 201);
+    ulisti_destroy(dest);
+
+    /* Filters leave nodes of uneven sizes, or none */
+    int n = 0;
+    for (int i = 0; i < 201; i++) {
+        if (input[i] >= -10 && input[i] <= 10) {
+            expect[n++] = input[i];
+        }
+    }
+    dest = ulisti_filter_range(source, -10, 10);
+    check_list(dest, expect, n);
+    ulisti_destroy(dest);
+
+    dest = ulisti_filter_gt(source, 997);
+    check_list(dest, 0, 0);
+    ulisti_destroy(dest);
+    ulisti_destroy(source);
+}
+END_TEST
+
+Suite *ulisti_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Unrolled list");
+    tc = tcase_create("Core");
+
+    tcase_add_test(tc, test_ulisti_create);
+    tcase_add_test(tc, test_ulisti_from_array);
+    tcase_add_test(tc, test_ulisti_append);
+    tcase_add_test(tc, test_ulisti_get);
+    tcase_add_test(tc, test_ulisti_find);
+    tcase_add_test(tc, test_ulisti_slice);
+    tcase_add_test(tc, test_ulisti_insert);
+    tcase_add_test(tc, test_ulisti_delete);
+    tcase_add_test(tc, test_ulisti_map_filter_reduce);
+    tcase_add_test(tc, test_ulisti_builtins);
+    tcase_add_test(tc, test_ulisti_to_json);
+    tcase_add_test(tc, test_ulisti_from_json);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = ulisti_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,241 @@
+#include <check.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "./util.h"
+#include "../vec.h"
+
+/*
+ * Lengths around the vector widths, so that every kernel runs both its
+ * vector loop and its scalar tail.
+ */
+static const size_t lengths[] = {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 100};
+#define NUM_LENGTHS (sizeof(lengths) / sizeof(lengths[0]))
+#define MAX_LENGTH 100
+
+static const enum vec_level levels[] = {VEC_SCALAR, VEC_SSE2, VEC_AVX2};
+#define NUM_LEVELS (sizeof(levels) / sizeof(levels[0]))
+
+/*
+ * Fill 'values' with a spread of values including the extremes.
+ */
+static void fill(int *values, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        switch (i % 7) {
+            case 0: values[i] = INT_MAX; break;
+            case 3: values[i] = INT_MIN; break;
+            case 5: values[i] = 42; break;
+            default: values[i] = (int) (i * 7919 % 2001) - 1000; break;
+        }
+    }
+}
+
+static size_t filter_range(int *dst, const int *src, size_t n, int lo,
+        int hi) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (src[i] >= lo && src[i] <= hi) {
+            dst[count++] = src[i];
+        }
+    }
+    return count;
+}
+
+START_TEST(test_vec_level) {
+    const enum vec_level best = vec_level();
+    ck_assert_int_eq(vec_use(VEC_SCALAR), VEC_SCALAR);
+    ck_assert_int_eq(vec_level(), VEC_SCALAR);
+    ck_assert_int_eq(vec_use(VEC_AVX2), best);
+    ck_assert_int_eq(vec_level(), best);
+}
+END_TEST
+
+START_TEST(test_vec_reduce) {
+    int values[MAX_LENGTH];
+    fill(values, MAX_LENGTH);
+
+    for (size_t l = 0; l < NUM_LEVELS; l++) {
+        vec_use(levels[l]);
+        for (size_t i = 0; i < NUM_LENGTHS; i++) {
+            const size_t n = lengths[i];
+            long long sum = 0;
+            int min = INT_MAX, max = INT_MIN;
+            size_t count = 0;
+            for (size_t j = 0; j < n; j++) {
+                sum += values[j];
+                min = values[j] < min ? values[j] : min;
+                max = values[j] > max ? values[j] : max;
+                count += values[j] == 42;
+            }
+            ck_assert(vec_sum(values, n) == sum);
+            ck_assert_int_eq(vec_min(values, n), min);
+            ck_assert_int_eq(vec_max(values, n), max);
+            ck_assert_uint_eq(vec_count(values, n, 42), count);
+        }
+    }
+
+    /* The sum does not overflow */
+    int big[20];
+    for (size_t j = 0; j < 20; j++) {
+        big[j] = INT_MAX;
+    }
+    for (size_t l = 0; l < NUM_LEVELS; l++) {
+        vec_use(levels[l]);
+        ck_assert(vec_sum(big, 20) == 20ll * INT_MAX);
+        ck_assert_uint_eq(vec_count(big, 20, INT_MAX), 20);
+    }
+}
+END_TEST
+
+START_TEST(test_vec_transform) {
+    int values[MAX_LENGTH], expect[MAX_LENGTH], out[MAX_LENGTH];
+    fill(values, MAX_LENGTH);
+
+    for (size_t l = 0; l < NUM_LEVELS; l++) {
+        vec_use(levels[l]);
+        for (size_t i = 0; i < NUM_LENGTHS; i++) {
+            const size_t n = lengths[i];
+            const size_t size = n * sizeof(int);
+
+            for (size_t j = 0; j < n; j++) {
+                expect[j] = (int) ((unsigned int) values[j] + 1000u);
+            }
+            vec_add(out, values, n, 1000);
+            ck_assert(memcmp(out, expect, size) == 0);
+
+            for (size_t j = 0; j < n; j++) {
+                expect[j] = (int) ((unsigned int) values[j] * -3u);
+            }
+            vec_mul(out, values, n, -3);
+            ck_assert(memcmp(out, expect, size) == 0);
+
+            for (size_t j = 0; j < n; j++) {
+                expect[j] = values[j] < -500 ? -500 :
+                    values[j] > 500 ? 500 : values[j];
+            }
+            vec_clamp(out, values, n, -500, 500);
+            ck_assert(memcmp(out, expect, size) == 0);
+
+            /* In place */
+            memcpy(out, values, size);
+            vec_clamp(out, out, n, -500, 500);
+            ck_assert(memcmp(out, expect, size) == 0);
+        }
+    }
+}
+END_TEST
+
+START_TEST(test_vec_filter) {
+    int values[MAX_LENGTH], expect[MAX_LENGTH], out[MAX_LENGTH];
+    fill(values, MAX_LENGTH);
+
+    for (size_t l = 0; l < NUM_LEVELS; l++) {
+        vec_use(levels[l]);
+        for (size_t i = 0; i < NUM_LENGTHS; i++) {
+            const size_t n = lengths[i];
+            size_t count;
+
+            count = filter_range(expect, values, n, INT_MIN, -1);
+            ck_assert_uint_eq(vec_filter_lt(out, values, n, 0), count);
+            ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+
+            count = filter_range(expect, values, n, 1, INT_MAX);
+            ck_assert_uint_eq(vec_filter_gt(out, values, n, 0), count);
+            ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+
+            count = filter_range(expect, values, n, 42, 42);
+            ck_assert_uint_eq(vec_filter_eq(out, values, n, 42), count);
+            ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+
+            count = filter_range(expect, values, n, -100, 100);
+            ck_assert_uint_eq(vec_filter_range(out, values, n, -100, 100),
+                    count);
+            ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+
+            /* Nothing is less than INT_MIN or greater than INT_MAX */
+            ck_assert_uint_eq(vec_filter_lt(out, values, n, INT_MIN), 0);
+            ck_assert_uint_eq(vec_filter_gt(out, values, n, INT_MAX), 0);
+            ck_assert_uint_eq(vec_filter_range(out, values, n, 1, 0), 0);
+
+            /* In place */
+            count = filter_range(expect, values, n, INT_MIN, INT_MAX);
+            memcpy(out, values, n * sizeof(int));
+            ck_assert_uint_eq(vec_filter_range(out, out, n, INT_MIN,
+                        INT_MAX), count);
+            ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+            count = filter_range(expect, values, n, 0, INT_MAX);
+            memcpy(out, values, n * sizeof(int));
+            ck_assert_uint_eq(vec_filter_gt(out, out, n, -1), count);
+            ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+        }
+    }
+}
+END_TEST
+
+START_TEST(test_vec_apply) {
+    int values[MAX_LENGTH], expect[MAX_LENGTH], out[MAX_LENGTH];
+    const size_t n = MAX_LENGTH, size = n * sizeof(int);
+    fill(values, MAX_LENGTH);
+
+    /* Each operation runs the kernel of the same name */
+    vec_add(expect, values, n, 1000);
+    ck_assert_uint_eq(vec_apply(VEC_ADD, out, values, n, 1000, 0), n);
+    ck_assert(memcmp(out, expect, size) == 0);
+
+    vec_mul(expect, values, n, -3);
+    ck_assert_uint_eq(vec_apply(VEC_MUL, out, values, n, -3, 0), n);
+    ck_assert(memcmp(out, expect, size) == 0);
+
+    vec_clamp(expect, values, n, -500, 500);
+    ck_assert_uint_eq(vec_apply(VEC_CLAMP, out, values, n, -500, 500), n);
+    ck_assert(memcmp(out, expect, size) == 0);
+
+    size_t count = vec_filter_lt(expect, values, n, 0);
+    ck_assert_uint_eq(vec_apply(VEC_LT, out, values, n, 0, 0), count);
+    ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+
+    count = vec_filter_gt(expect, values, n, 0);
+    ck_assert_uint_eq(vec_apply(VEC_GT, out, values, n, 0, 0), count);
+    ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+
+    count = vec_filter_eq(expect, values, n, 42);
+    ck_assert_uint_eq(vec_apply(VEC_EQ, out, values, n, 42, 0), count);
+    ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+
+    count = vec_filter_range(expect, values, n, -100, 100);
+    ck_assert_uint_eq(vec_apply(VEC_RANGE, out, values, n, -100, 100),
+            count);
+    ck_assert(memcmp(out, expect, count * sizeof(int)) == 0);
+}
+END_TEST
+
+Suite *vec_suite(void) {
+    Suite *s;
+    TCase *tc;
+
+    s = suite_create("Vector built-ins");
+    tc = tcase_create("Core");
+
+    tcase_add_test(tc, test_vec_level);
+    tcase_add_test(tc, test_vec_reduce);
+    tcase_add_test(tc, test_vec_transform);
+    tcase_add_test(tc, test_vec_filter);
+    tcase_add_test(tc, test_vec_apply);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
+
+int main(void) {
+    int fails;
+    Suite *s;
+    SRunner *sr;
+
+    s = vec_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (fails == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,657 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <ctype.h>
+#include <errno.h>
+#include "ulisti.h"
+#include "vec.h"
+
+/*
+ * Return a new, empty node, or NULL on failure.
+ */
+static struct ulisti_node *ulisti_node_create(void) {
+    struct ulisti_node *node = malloc(sizeof *node);
+    if (node) {
+        node->next = 0;
+        node->count = 0;
+    }
+    return node;
+}
+
+/*
+ * Add a new, empty node to the end of 'list'.  Return false on failure.
+ */
+static bool ulisti_grow(struct ulisti *list) {
+    struct ulisti_node *node = ulisti_node_create();
+    if (!node) {
+        return false;
+    }
+    if (list->tail) {
+        list->tail->next = node;
+    } else {
+        list->head = node;
+    }
+    list->tail = node;
+    return true;
+}
+
+/*
+ * Append the first 'num' values of 'input' to 'list', a node's worth at a
+ * time.  Return false on failure, in which case some of the values may have
+ * been appended.
+ */
+static bool ulisti_extend(struct ulisti *list, const int input[], int num) {
+    while (num > 0) {
+        if ((!list->tail || list->tail->count == ULISTI_NODE_SIZE) &&
+                !ulisti_grow(list)) {
+            return false;
+        }
+        struct ulisti_node *node = list->tail;
+        int n = ULISTI_NODE_SIZE - node->count;
+        if (n > num) {
+            n = num;
+        }
+        memcpy(&node->values[node->count], input, n * sizeof *input);
+        node->count += n;
+        list->length += n;
+        input += n;
+        num -= n;
+    }
+    return true;
+}
+
+/*
+ * Return the node of 'list' holding position 'pos', and set 'pos' to the
+ * value's index within that node.  If 'prev' is not NULL, set it to the node
+ * before the one returned, or NULL if that is the first.
+ *
+ * 'pos' must be a valid, non-negative position.  A position in the last node
+ * is found without walking the list.
+ */
+static struct ulisti_node *ulisti_seek(
+        const struct ulisti *list,
+        int *pos,
+        struct ulisti_node **prev) {
+    struct ulisti_node *before = 0;
+    struct ulisti_node *node = list->head;
+    if (!prev && *pos >= list->length - list->tail->count) {
+        *pos -= list->length - list->tail->count;
+        return list->tail;
+    }
+    while (*pos >= node->count) {
+        *pos -= node->count;
+        before = node;
+        node = node->next;
+    }
+    if (prev) {
+        *prev = before;
+    }
+    return node;
+}
+
+/*
+ * Create a new, empty list.  Return a pointer to the list, or NULL on
+ * failure.
+ */
+struct ulisti *ulisti_create(void) {
+    struct ulisti *list = malloc(sizeof *list);
+    if (list) {
+        list->head = 0;
+        list->tail = 0;
+        list->length = 0;
+    }
+    return list;
+}
+
+/*
+ * Create a new list with values from the first 'num' elements of 'input'.
+ *
+ * Return a pointer to the new list, or NULL on failure.
+ */
+struct ulisti *ulisti_from_array(const int input[], const int num) {
+    struct ulisti *list = ulisti_create();
+    if (list && !ulisti_extend(list, input, num)) {
+        ulisti_destroy(list);
+        return 0;
+    }
+    return list;
+}
+
+/*
+ * Unallocate the given list and all of its nodes.
+ */
+void ulisti_destroy(struct ulisti *list) {
+    if (!list) {
+        return;
+    }
+    struct ulisti_node *node = list->head, *next;
+    for (; node; node = next) {
+        next = node->next;
+        free(node);
+    }
+    free(list);
+}
+
+/*
+ * Return the number of elements in the list.
+ */
+int ulisti_length(const struct ulisti *list) {
+    return list ? list->length : 0;
+}
+
+/*
+ * Append an integer to the end of the list.  Return false on failure.
+ */
+bool ulisti_append(struct ulisti *list, int value) {
+    return list && ulisti_extend(list, &value, 1);
+}
+
+/*
+ * Get a pointer to the value in 'list' at the given position.
+ *
+ * Non-negative values of 'pos' are counted from the first element as position
+ * zero.  Negative values of 'pos' are counted from the last element as
+ * position -1.
+ *
+ * The pointer stays valid until the list is next changed by an insert or a
+ * delete.  Return a NULL pointer if the requested position does not exist in
+ * the list.
+ */
+int *ulisti_get(struct ulisti *list, int pos) {
+    if (!list) {
+        return 0;
+    }
+    if (pos < 0) {
+        pos += list->length;
+    }
+    if (pos < 0 || pos >= list->length) {
+        return 0;
+    }
+    struct ulisti_node *node = ulisti_seek(list, &pos, 0);
+    return &node->values[pos];
+}
+
+/*
+ * Return a pointer to the first value in 'list' equal to 'value'.
+ *
+ * Return a NULL pointer if no such value can be found.
+ */
+int *ulisti_find(struct ulisti *list, int value) {
+    if (!list) {
+        return 0;
+    }
+    for (struct ulisti_node *node = list->head; node; node = node->next) {
+        for (int i = 0; i < node->count; i++) {
+            if (node->values[i] == value) {
+                return &node->values[i];
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Extract a slice from the given list.
+ *
+ * Return a new list composed of elements from the source list, beginning at
+ * position 'start' and up to (but not including) position 'end'.  Positions
+ * are counted as for slisti_slice().  If the requested range does not include
+ * any elements, the new list is empty.
+ *
+ * Return a NULL pointer on failure.
+ */
+struct ulisti *ulisti_slice(const struct ulisti *source, int start, int end) {
+    if (!source) {
+        return 0;
+    }
+    if (start < 0) {
+        start += source->length;
+    }
+    if (end < 0) {
+        end += source->length;
+    }
+    if (start < 0) {
+        start = 0;
+    }
+    if (end > source->length) {
+        end = source->length;
+    }
+    struct ulisti *slice = ulisti_create();
+    if (!slice || end <= start) {
+        return slice;
+    }
+    int i = start, left = end - start;
+    const struct ulisti_node *node = ulisti_seek(source, &i, 0);
+    for (; left > 0; node = node->next, i = 0) {
+        int n = node->count - i < left ? node->count - i : left;
+        if (!ulisti_extend(slice, &node->values[i], n)) {
+            ulisti_destroy(slice);
+            return 0;
+        }
+        left -= n;
+    }
+    return slice;
+}
+
+/*
+ * Insert an integer into the list at the given position.  Return false on
+ * failure.
+ *
+ * A negative position will be counted from the end of the list, -1 meaning
+ * the last element, -2 the second last, and so on.
+ *
+ * If the given position is too high, the value will be appended to the end of
+ * the list.  If the position is too low, it will be inserted at the beginning
+ * of the list.
+ */
+bool ulisti_insert(struct ulisti *list, int pos, int value) {
+    if (!list) {
+        return false;
+    }
+    if (pos < 0) {
+        pos += list->length;
+        if (pos < 0) {
+            pos = 0;
+        }
+    }
+    if (pos >= list->length) {
+        return ulisti_extend(list, &value, 1);
+    }
+    struct ulisti_node *node = ulisti_seek(list, &pos, 0);
+    if (node->count == ULISTI_NODE_SIZE) {
+        /* Split the node, moving its upper half into a new one. */
+        struct ulisti_node *split = ulisti_node_create();
+        if (!split) {
+            return false;
+        }
+        const int half = ULISTI_NODE_SIZE / 2;
+        split->count = ULISTI_NODE_SIZE - half;
+        memcpy(split->values, &node->values[half],
+                split->count * sizeof *split->values);
+        node->count = half;
+        split->next = node->next;
+        node->next = split;
+        if (list->tail == node) {
+            list->tail = split;
+        }
+        if (pos > half) {
+            node = split;
+            pos -= half;
+        }
+    }
+    memmove(&node->values[pos + 1], &node->values[pos],
+            (node->count - pos) * sizeof *node->values);
+    node->values[pos] = value;
+    node->count++;
+    list->length++;
+    return true;
+}
+
+/*
+ * Delete an element from the list at the given position.
+ *
+ * Non-negative values of 'pos' are counted from the first element as position
+ * zero.  Negative values of 'pos' are counted from the last element as
+ * position -1.
+ *
+ * Return whether an element was deleted.  If the requested position does not
+ * exist in the list, do nothing.
+ */
+bool ulisti_delete(struct ulisti *list, int pos) {
+    if (!list) {
+        return false;
+    }
+    if (pos < 0) {
+        pos += list->length;
+    }
+    if (pos < 0 || pos >= list->length) {
+        return false;
+    }
+    struct ulisti_node *prev;
+    struct ulisti_node *node = ulisti_seek(list, &pos, &prev);
+    node->count--;
+    list->length--;
+    memmove(&node->values[pos], &node->values[pos + 1],
+            (node->count - pos) * sizeof *node->values);
+
+    struct ulisti_node *next = node->next;
+    if (node->count == 0) {
+        if (prev) {
+            prev->next = next;
+        } else {
+            list->head = next;
+        }
+        if (list->tail == node) {
+            list->tail = prev;
+        }
+        free(node);
+    } else if (next && node->count + next->count <= ULISTI_NODE_SIZE / 2) {
+        memcpy(&node->values[node->count], next->values,
+                next->count * sizeof *next->values);
+        node->count += next->count;
+        node->next = next->next;
+        if (list->tail == next) {
+            list->tail = node;
+        }
+        free(next);
+    }
+    return true;
+}
+
+/*
+ * Create a new list by applying a map function to each element in source.
+ *
+ * The 'fn' argument is a pointer to a map function which accepts an integer
+ * element from the source list, and returns the desired integer to be added to
+ * the destination list.
+ *
+ * Return a pointer to the new list, or NULL on failure.
+ */
+struct ulisti *ulisti_map(const struct ulisti *source, int (*fn)(int)) {
+    if (!source) {
+        return 0;
+    }
+    struct ulisti *list = ulisti_create();
+    if (!list) {
+        return 0;
+    }
+    int buf[ULISTI_NODE_SIZE];
+    for (const struct ulisti_node *node = source->head; node;
+            node = node->next) {
+        for (int i = 0; i < node->count; i++) {
+            buf[i] = fn(node->values[i]);
+        }
+        if (!ulisti_extend(list, buf, node->count)) {
+            ulisti_destroy(list);
+            return 0;
+        }
+    }
+    return list;
+}
+
+/*
+ * Create a new list by applying a filter function to each element in source.
+ *
+ * The 'fn' argument is a pointer to a filter function which accepts an integer
+ * element from the source list, and returns a boolean to indicate whether that
+ * element ought to be included in the result list.
+ *
+ * Return a pointer to the new list, or NULL on failure.
+ */
+struct ulisti *ulisti_filter(const struct ulisti *source, bool (*fn)(int)) {
+    if (!source) {
+        return 0;
+    }
+    struct ulisti *list = ulisti_create();
+    if (!list) {
+        return 0;
+    }
+    int buf[ULISTI_NODE_SIZE];
+    for (const struct ulisti_node *node = source->head; node;
+            node = node->next) {
+        int n = 0;
+        for (int i = 0; i < node->count; i++) {
+            if (fn(node->values[i])) {
+                buf[n++] = node->values[i];
+            }
+        }
+        if (!ulisti_extend(list, buf, n)) {
+            ulisti_destroy(list);
+            return 0;
+        }
+    }
+    return list;
+}
+
+/*
+ * Return an integer by applying a reduce function to each element in source.
+ *
+ * The 'fn' argument is a pointer to a reduce function which accepts an integer
+ * state value, and an integer element from the source list, and returns the
+ * new state value.  State values are initialised to zero.
+ */
+int ulisti_reduce(const struct ulisti *source, int (*fn)(int, int)) {
+    int state = 0;
+    if (!source) {
+        return state;
+    }
+    for (const struct ulisti_node *node = source->head; node;
+            node = node->next) {
+        for (int i = 0; i < node->count; i++) {
+            state = fn(state, node->values[i]);
+        }
+    }
+    return state;
+}
+
+/*
+ * The built-in operations below run as SIMD kernels (see vec.h) directly on
+ * the values in each node.
+ */
+
+/*
+ * Return the sum of the elements in 'list'.  The sum is kept in a long long,
+ * so it cannot overflow.
+ */
+long long ulisti_sum(const struct ulisti *list) {
+    long long sum = 0;
+    for (const struct ulisti_node *node = list ? list->head : 0; node;
+            node = node->next) {
+        sum += vec_sum(node->values, node->count);
+    }
+    return sum;
+}
+
+/*
+ * Return the least element in 'list', or INT_MAX if the list is empty.
+ */
+int ulisti_min(const struct ulisti *list) {
+    int min = INT_MAX;
+    for (const struct ulisti_node *node = list ? list->head : 0; node;
+            node = node->next) {
+        const int value = vec_min(node->values, node->count);
+        min = value < min ? value : min;
+    }
+    return min;
+}
+
+/*
+ * Return the greatest element in 'list', or INT_MIN if the list is empty.
+ */
+int ulisti_max(const struct ulisti *list) {
+    int max = INT_MIN;
+    for (const struct ulisti_node *node = list ? list->head : 0; node;
+            node = node->next) {
+        const int value = vec_max(node->values, node->count);
+        max = value > max ? value : max;
+    }
+    return max;
+}
+
+/*
+ * Return the number of elements in 'list' equal to 'value'.
+ */
+int ulisti_count(const struct ulisti *list, int value) {
+    int count = 0;
+    for (const struct ulisti_node *node = list ? list->head : 0; node;
+            node = node->next) {
+        count += vec_count(node->values, node->count, value);
+    }
+    return count;
+}
+
+/*
+ * Create a new list by running the kernel for 'op', with arguments 'a' and
+ * 'b', on each node of source.  Return NULL on failure.
+ */
+static struct ulisti *ulisti_vec(
+        const struct ulisti *source,
+        const enum vec_op op,
+        const int a,
+        const int b) {
+    if (!source) {
+        return 0;
+    }
+    struct ulisti *list = ulisti_create();
+    if (!list) {
+        return 0;
+    }
+    int buf[ULISTI_NODE_SIZE];
+    for (const struct ulisti_node *node = source->head; node;
+            node = node->next) {
+        const size_t n = vec_apply(op, buf, node->values, node->count, a, b);
+        if (!ulisti_extend(list, buf, n)) {
+            ulisti_destroy(list);
+            return 0;
+        }
+    }
+    return list;
+}
+
+/*
+ * Create a new list with 'k' added to each element in source.  Arithmetic
+ * wraps around on overflow.  Return NULL on failure.
+ */
+struct ulisti *ulisti_add(const struct ulisti *source, int k) {
+    return ulisti_vec(source, VEC_ADD, k, 0);
+}
+
+/*
+ * Create a new list with each element in source multiplied by 'k'.
+ * Arithmetic wraps around on overflow.  Return NULL on failure.
+ */
+struct ulisti *ulisti_mul(const struct ulisti *source, int k) {
+    return ulisti_vec(source, VEC_MUL, k, 0);
+}
+
+/*
+ * Create a new list with each element in source raised to 'lo' and then
+ * lowered to 'hi'.  Return NULL on failure.
+ */
+struct ulisti *ulisti_clamp(const struct ulisti *source, int lo, int hi) {
+    return ulisti_vec(source, VEC_CLAMP, lo, hi);
+}
+
+/*
+ * Create a new list with the elements in source that are less than 'k', in
+ * order.  Return NULL on failure.
+ */
+struct ulisti *ulisti_filter_lt(const struct ulisti *source, int k) {
+    return ulisti_vec(source, VEC_LT, k, 0);
+}
+
+/*
+ * Create a new list with the elements in source that are greater than 'k', in
+ * order.  Return NULL on failure.
+ */
+struct ulisti *ulisti_filter_gt(const struct ulisti *source, int k) {
+    return ulisti_vec(source, VEC_GT, k, 0);
+}
+
+/*
+ * Create a new list with the elements in source that are equal to 'k'.
+ * Return NULL on failure.
+ */
+struct ulisti *ulisti_filter_eq(const struct ulisti *source, int k) {
+    return ulisti_vec(source, VEC_EQ, k, 0);
+}
+
+/*
+ * Create a new list with the elements in source from 'lo' to 'hi' inclusive,
+ * in order.  Return NULL on failure.
+ */
+struct ulisti *ulisti_filter_range(
+        const struct ulisti *source,
+        int lo,
+        int hi) {
+    return ulisti_vec(source, VEC_RANGE, lo, hi);
+}
+
+/*
+ * Return the given list formatted as compact JSON.
+ *
+ * The result is a newly malloc'd string.  It is the caller's responsibility to
+ * free the string.  Return a NULL pointer on failure.
+ */
+char *ulisti_to_json(const struct ulisti *list) {
+    char buf[64];
+    const size_t int_size = snprintf(buf, sizeof buf, "%d", INT_MIN);
+    const size_t length = ulisti_length(list);
+
+    /*
+     * All integers in the list, plus comma delimiters, plus surrounding square
+     * brackets, plus terminating NUL.
+     */
+    const size_t size = length * (int_size + 1) + 3;
+    char *result = malloc(size);
+    if (!result) {
+        return 0;
+    }
+    size_t pos = 0;
+    result[pos++] = '[';
+    for (const struct ulisti_node *node = list ? list->head : 0; node;
+            node = node->next) {
+        for (int i = 0; i < node->count; i++) {
+            pos += snprintf(&result[pos], size - pos, "%d,", node->values[i]);
+        }
+    }
+    if (length) {
+        pos--;
+    }
+    result[pos++] = ']';
+    result[pos] = '\0';
+    return result;
+}
+
+/*
+ * Return a pointer to a new list built from nul-terminated JSON ASCII text.
+ *
+ * The JSON text must decode to a single flat list of integers.  If the JSON
+ * text does not represent a list, or if any of the list's elements cannot be
+ * converted to an int, return a NULL pointer.  Unlike slisti_from_json(), an
+ * empty JSON list gives an empty list.
+ */
+struct ulisti *ulisti_from_json(const char *json) {
+    while (isspace(*json)) {
+        json++;
+    }
+    if (*(json++) != '[') {
+        return 0;
+    }
+    struct ulisti *list = ulisti_create();
+    if (!list) {
+        return 0;
+    }
+    while (isspace(*json)) {
+        json++;
+    }
+    if (*json == ']') {
+        return list;
+    }
+
+    char *pos = 0;
+    long int value;
+    while (*json != '\0') {
+        errno = 0;
+        value = strtol(json, &pos, 10);
+        if (json == pos || errno > 0 || value < INT_MIN || value > INT_MAX) {
+            break;
+        }
+        json = pos;
+        if (!ulisti_append(list, (int) value)) {
+            break;
+        }
+        while (isspace(*json)) {
+            json++;
+        }
+        if (*json == ']') {
+            return list;
+        } else if (*(json++) != ',') {
+            break;
+        }
+    }
+    ulisti_destroy(list);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <stdbool.h>
+
+/*
+ * An unrolled integer list, with the same conveniences as slisti.
+ *
+ * Values are kept in a singly-linked list of nodes, each holding a run of up
+ * to ULISTI_NODE_SIZE values in a plain array, so walking the list reads
+ * contiguous memory and only follows a pointer once per node.  A node fills
+ * four cache lines.  The list handle keeps the first and last nodes and the
+ * number of values, so length and append do not walk the list at all.
+ *
+ * Lists built from arrays, JSON or by appending fill every node but the last.
+ * Inserting into a full node splits it in two, and deleting from a node
+ * merges it with the next one once both fit in half a node.
+ *
+ * The built-in reductions, transforms and filters (ulisti_sum() to
+ * ulisti_filter_range()) run as SIMD kernels on each node's values in turn,
+ * rather than calling a function for every element.
+ */
+#define ULISTI_NODE_SIZE 60
+
+struct ulisti_node {
+    struct ulisti_node *next;
+    int count;
+    int values[ULISTI_NODE_SIZE];
+};
+
+struct ulisti {
+    struct ulisti_node *head;
+    struct ulisti_node *tail;
+    int length;
+};
+
+struct ulisti *ulisti_create(void);
+struct ulisti *ulisti_from_array(const int input[], int num);
+void ulisti_destroy(struct ulisti *list);
+int ulisti_length(const struct ulisti *list);
+bool ulisti_append(struct ulisti *list, int value);
+int *ulisti_get(struct ulisti *list, int pos);
+int *ulisti_find(struct ulisti *list, int value);
+struct ulisti *ulisti_slice(const struct ulisti *source, int start, int end);
+bool ulisti_insert(struct ulisti *list, int pos, int value);
+bool ulisti_delete(struct ulisti *list, int pos);
+struct ulisti *ulisti_map(const struct ulisti *list, int (*fn)(int));
+struct ulisti *ulisti_filter(const struct ulisti *list, bool (*fn)(int));
+int ulisti_reduce(const struct ulisti *list, int (*fn)(int, int));
+long long ulisti_sum(const struct ulisti *list);
+int ulisti_min(const struct ulisti *list);
+int ulisti_max(const struct ulisti *list);
+int ulisti_count(const struct ulisti *list, int value);
+struct ulisti *ulisti_add(const struct ulisti *source, int k);
+struct ulisti *ulisti_mul(const struct ulisti *source, int k);
+struct ulisti *ulisti_clamp(const struct ulisti *source, int lo, int hi);
+struct ulisti *ulisti_filter_lt(const struct ulisti *source, int k);
+struct ulisti *ulisti_filter_gt(const struct ulisti *source, int k);
+struct ulisti *ulisti_filter_eq(const struct ulisti *source, int k);
+struct ulisti *ulisti_filter_range(const struct ulisti *source, int lo,
+        int hi);
+char *ulisti_to_json(const struct ulisti *list);
+struct ulisti *ulisti_from_json(const char *json);
@@ -0,0 +1,545 @@
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include "./vec.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VEC_X86
+#include <immintrin.h>
+#define VEC_SSE2_FN __attribute__((target("sse2")))
+#define VEC_AVX2_FN __attribute__((target("avx2")))
+#define VEC_COUNT_RUN ((size_t) 1 << 30)
+#endif
+
+/*
+ * The kernels for one level.  Every filter is a range filter underneath, and
+ * min and max start from the identity of each, so that no values give
+ * INT_MAX and INT_MIN respectively.
+ */
+struct vec_kernels {
+    enum vec_level level;
+    long long (*sum)(const int *, size_t);
+    int (*min)(const int *, size_t);
+    int (*max)(const int *, size_t);
+    size_t (*count)(const int *, size_t, int);
+    void (*add)(int *, const int *, size_t, int);
+    void (*mul)(int *, const int *, size_t, int);
+    void (*clamp)(int *, const int *, size_t, int, int);
+    size_t (*range)(int *, const int *, size_t, int, int);
+};
+
+static long long scalar_sum(const int *src, size_t n) {
+    long long sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += src[i];
+    }
+    return sum;
+}
+
+static int scalar_min(const int *src, size_t n) {
+    int min = INT_MAX;
+    for (size_t i = 0; i < n; i++) {
+        min = src[i] < min ? src[i] : min;
+    }
+    return min;
+}
+
+static int scalar_max(const int *src, size_t n) {
+    int max = INT_MIN;
+    for (size_t i = 0; i < n; i++) {
+        max = src[i] > max ? src[i] : max;
+    }
+    return max;
+}
+
+static size_t scalar_count(const int *src, size_t n, int value) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        count += src[i] == value;
+    }
+    return count;
+}
+
+static void scalar_add(int *dst, const int *src, size_t n, int k) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = (int) ((unsigned int) src[i] + (unsigned int) k);
+    }
+}
+
+static void scalar_mul(int *dst, const int *src, size_t n, int k) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = (int) ((unsigned int) src[i] * (unsigned int) k);
+    }
+}
+
+static void scalar_clamp(int *dst, const int *src, size_t n, int lo, int hi) {
+    for (size_t i = 0; i < n; i++) {
+        const int v = src[i] < lo ? lo : src[i];
+        dst[i] = v > hi ? hi : v;
+    }
+}
+
+static size_t scalar_range(int *dst, const int *src, size_t n, int lo,
+        int hi) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        /* Store every value, but only count the ones that pass */
+        const int v = src[i];
+        dst[count] = v;
+        count += v >= lo && v <= hi;
+    }
+    return count;
+}
+
+#ifdef VEC_X86
+/*
+ * SSE2 has no 32-bit min, max or multiply, so they are built from compares
+ * and 64-bit multiplies.  The kernels work four values at a time and leave
+ * the last few to the scalar versions.
+ */
+VEC_SSE2_FN static inline __m128i sse2_select(__m128i mask, __m128i a,
+        __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+VEC_SSE2_FN static long long sse2_sum(const int *src, size_t n) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) &src[i]);
+        const __m128i sign = _mm_srai_epi32(v, 31);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+    }
+    long long lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, acc);
+    return lanes[0] + lanes[1] + scalar_sum(&src[i], n - i);
+}
+
+VEC_SSE2_FN static int sse2_min(const int *src, size_t n) {
+    __m128i acc = _mm_set1_epi32(INT_MAX);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) &src[i]);
+        acc = sse2_select(_mm_cmpgt_epi32(acc, v), v, acc);
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i *) lanes, acc);
+    const int min = scalar_min(lanes, 4);
+    const int rest = scalar_min(&src[i], n - i);
+    return rest < min ? rest : min;
+}
+
+VEC_SSE2_FN static int sse2_max(const int *src, size_t n) {
+    __m128i acc = _mm_set1_epi32(INT_MIN);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) &src[i]);
+        acc = sse2_select(_mm_cmpgt_epi32(v, acc), v, acc);
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i *) lanes, acc);
+    const int max = scalar_max(lanes, 4);
+    const int rest = scalar_max(&src[i], n - i);
+    return rest > max ? rest : max;
+}
+
+VEC_SSE2_FN static size_t sse2_count(const int *src, size_t n, int value) {
+    const __m128i key = _mm_set1_epi32(value);
+    size_t count = 0, i = 0;
+    while (i + 4 <= n) {
+        /* Add up the lanes every 2^30 values, long before they overflow. */
+        const size_t end = n - i > VEC_COUNT_RUN ? i + VEC_COUNT_RUN : n;
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 4 <= end; i += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i *) &src[i]);
+            acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(v, key));
+        }
+        unsigned int lanes[4];
+        _mm_storeu_si128((__m128i *) lanes, acc);
+        count += (size_t) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return count + scalar_count(&src[i], n - i, value);
+}
+
+VEC_SSE2_FN static void sse2_add(int *dst, const int *src, size_t n, int k) {
+    const __m128i kk = _mm_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) &src[i]);
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_add_epi32(v, kk));
+    }
+    scalar_add(&dst[i], &src[i], n - i, k);
+}
+
+VEC_SSE2_FN static void sse2_mul(int *dst, const int *src, size_t n, int k) {
+    const __m128i kk = _mm_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) &src[i]);
+        /* Multiply the even and odd lanes separately, keeping the low half. */
+        const __m128i even = _mm_mul_epu32(v, kk);
+        const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(v, 32), kk);
+        _mm_storeu_si128((__m128i *) &dst[i], _mm_unpacklo_epi32(
+                _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))));
+    }
+    scalar_mul(&dst[i], &src[i], n - i, k);
+}
+
+VEC_SSE2_FN static void sse2_clamp(int *dst, const int *src, size_t n, int lo,
+        int hi) {
+    const __m128i lo4 = _mm_set1_epi32(lo), hi4 = _mm_set1_epi32(hi);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *) &src[i]);
+        v = sse2_select(_mm_cmpgt_epi32(lo4, v), lo4, v);
+        v = sse2_select(_mm_cmpgt_epi32(v, hi4), hi4, v);
+        _mm_storeu_si128((__m128i *) &dst[i], v);
+    }
+    scalar_clamp(&dst[i], &src[i], n - i, lo, hi);
+}
+
+VEC_SSE2_FN static size_t sse2_range(int *dst, const int *src, size_t n,
+        int lo, int hi) {
+    const __m128i lo4 = _mm_set1_epi32(lo), hi4 = _mm_set1_epi32(hi);
+    size_t count = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) &src[i]);
+        const __m128i out = _mm_or_si128(_mm_cmpgt_epi32(lo4, v),
+                _mm_cmpgt_epi32(v, hi4));
+        const int bits = ~_mm_movemask_ps(_mm_castsi128_ps(out)) & 0xf;
+        if (bits == 0xf) {
+            _mm_storeu_si128((__m128i *) &dst[count], v);
+            count += 4;
+        } else if (bits) {
+            for (int j = 0; j < 4; j++) {
+                dst[count] = src[i + j];
+                count += (bits >> j) & 1;
+            }
+        }
+    }
+    return count + scalar_range(&dst[count], &src[i], n - i, lo, hi);
+}
+
+/*
+ * For each 8-bit mask of lanes, the lanes that are set, in order, four bits
+ * to a lane, for packing them to the front of a vector with
+ * _mm256_permutevar8x32_epi32().
+ */
+static const uint32_t vec_pack[256] = {
+    0x00000000, 0x00000000, 0x00000001, 0x00000010, 0x00000002, 0x00000020,
+    0x00000021, 0x00000210, 0x00000003, 0x00000030, 0x00000031, 0x00000310,
+    0x00000032, 0x00000320, 0x00000321, 0x00003210, 0x00000004, 0x00000040,
+    0x00000041, 0x00000410, 0x00000042, 0x00000420, 0x00000421, 0x00004210,
+    0x00000043, 0x00000430, 0x00000431, 0x00004310, 0x00000432, 0x00004320,
+    0x00004321, 0x00043210, 0x00000005, 0x00000050, 0x00000051, 0x00000510,
+    0x00000052, 0x00000520, 0x00000521, 0x00005210, 0x00000053, 0x00000530,
+    0x00000531, 0x00005310, 0x00000532, 0x00005320, 0x00005321, 0x00053210,
+    0x00000054, 0x00000540, 0x00000541, 0x00005410, 0x00000542, 0x00005420,
+    0x00005421, 0x00054210, 0x00000543, 0x00005430, 0x00005431, 0x00054310,
+    0x00005432, 0x00054320, 0x00054321, 0x00543210, 0x00000006, 0x00000060,
+    0x00000061, 0x00000610, 0x00000062, 0x00000620, 0x00000621, 0x00006210,
+    0x00000063, 0x00000630, 0x00000631, 0x00006310, 0x00000632, 0x00006320,
+    0x00006321, 0x00063210, 0x00000064, 0x00000640, 0x00000641, 0x00006410,
+    0x00000642, 0x00006420, 0x00006421, 0x00064210, 0x00000643, 0x00006430,
+    0x00006431, 0x00064310, 0x00006432, 0x00064320, 0x00064321, 0x00643210,
+    0x00000065, 0x00000650, 0x00000651, 0x00006510, 0x00000652, 0x00006520,
+    0x00006521, 0x00065210, 0x00000653, 0x00006530, 0x00006531, 0x00065310,
+    0x00006532, 0x00065320, 0x00065321, 0x00653210, 0x00000654, 0x00006540,
+    0x00006541, 0x00065410, 0x00006542, 0x00065420, 0x00065421, 0x00654210,
+    0x00006543, 0x00065430, 0x00065431, 0x00654310, 0x00065432, 0x00654320,
+    0x00654321, 0x06543210, 0x00000007, 0x00000070, 0x00000071, 0x00000710,
+    0x00000072, 0x00000720, 0x00000721, 0x00007210, 0x00000073, 0x00000730,
+    0x00000731, 0x00007310, 0x00000732, 0x00007320, 0x00007321, 0x00073210,
+    0x00000074, 0x00000740, 0x00000741, 0x00007410, 0x00000742, 0x00007420,
+    0x00007421, 0x00074210, 0x00000743, 0x00007430, 0x00007431, 0x00074310,
+    0x00007432, 0x00074320, 0x00074321, 0x00743210, 0x00000075, 0x00000750,
+    0x00000751, 0x00007510, 0x00000752, 0x00007520, 0x00007521, 0x00075210,
+    0x00000753, 0x00007530, 0x00007531, 0x00075310, 0x00007532, 0x00075320,
+    0x00075321, 0x00753210, 0x00000754, 0x00007540, 0x00007541, 0x00075410,
+    0x00007542, 0x00075420, 0x00075421, 0x00754210, 0x00007543, 0x00075430,
+    0x00075431, 0x00754310, 0x00075432, 0x00754320, 0x00754321, 0x07543210,
+    0x00000076, 0x00000760, 0x00000761, 0x00007610, 0x00000762, 0x00007620,
+    0x00007621, 0x00076210, 0x00000763, 0x00007630, 0x00007631, 0x00076310,
+    0x00007632, 0x00076320, 0x00076321, 0x00763210, 0x00000764, 0x00007640,
+    0x00007641, 0x00076410, 0x00007642, 0x00076420, 0x00076421, 0x00764210,
+    0x00007643, 0x00076430, 0x00076431, 0x00764310, 0x00076432, 0x00764320,
+    0x00764321, 0x07643210, 0x00000765, 0x00007650, 0x00007651, 0x00076510,
+    0x00007652, 0x00076520, 0x00076521, 0x00765210, 0x00007653, 0x00076530,
+    0x00076531, 0x00765310, 0x00076532, 0x00765320, 0x00765321, 0x07653210,
+    0x00007654, 0x00076540, 0x00076541, 0x00765410, 0x00076542, 0x00765420,
+    0x00765421, 0x07654210, 0x00076543, 0x00765430, 0x00765431, 0x07654310,
+    0x00765432, 0x07654320, 0x07654321, 0x76543210
+};
+
+VEC_AVX2_FN static long long avx2_sum(const int *src, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) &src[i]);
+        const __m128i b = _mm_loadu_si128((const __m128i *) &src[i + 4]);
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(a));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(b));
+    }
+    long long lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+        scalar_sum(&src[i], n - i);
+}
+
+VEC_AVX2_FN static int avx2_min(const int *src, size_t n) {
+    __m256i acc = _mm256_set1_epi32(INT_MAX);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_min_epi32(acc,
+                _mm256_loadu_si256((const __m256i *) &src[i]));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+    const int min = scalar_min(lanes, 8);
+    const int rest = scalar_min(&src[i], n - i);
+    return rest < min ? rest : min;
+}
+
+VEC_AVX2_FN static int avx2_max(const int *src, size_t n) {
+    __m256i acc = _mm256_set1_epi32(INT_MIN);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_max_epi32(acc,
+                _mm256_loadu_si256((const __m256i *) &src[i]));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+    const int max = scalar_max(lanes, 8);
+    const int rest = scalar_max(&src[i], n - i);
+    return rest > max ? rest : max;
+}
+
+VEC_AVX2_FN static size_t avx2_count(const int *src, size_t n, int value) {
+    const __m256i key = _mm256_set1_epi32(value);
+    size_t count = 0, i = 0;
+    while (i + 8 <= n) {
+        /* Add up the lanes every 2^30 values, long before they overflow. */
+        const size_t end = n - i > VEC_COUNT_RUN ? i + VEC_COUNT_RUN : n;
+        __m256i acc = _mm256_setzero_si256();
+        for (; i + 8 <= end; i += 8) {
+            const __m256i v = _mm256_loadu_si256((const __m256i *) &src[i]);
+            acc = _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(v, key));
+        }
+        unsigned int lanes[8];
+        _mm256_storeu_si256((__m256i *) lanes, acc);
+        for (int j = 0; j < 8; j++) {
+            count += lanes[j];
+        }
+    }
+    return count + scalar_count(&src[i], n - i, value);
+}
+
+VEC_AVX2_FN static void avx2_add(int *dst, const int *src, size_t n, int k) {
+    const __m256i kk = _mm256_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *) &src[i]);
+        _mm256_storeu_si256((__m256i *) &dst[i], _mm256_add_epi32(v, kk));
+    }
+    scalar_add(&dst[i], &src[i], n - i, k);
+}
+
+VEC_AVX2_FN static void avx2_mul(int *dst, const int *src, size_t n, int k) {
+    const __m256i kk = _mm256_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *) &src[i]);
+        _mm256_storeu_si256((__m256i *) &dst[i], _mm256_mullo_epi32(v, kk));
+    }
+    scalar_mul(&dst[i], &src[i], n - i, k);
+}
+
+VEC_AVX2_FN static void avx2_clamp(int *dst, const int *src, size_t n, int lo,
+        int hi) {
+    const __m256i lo8 = _mm256_set1_epi32(lo), hi8 = _mm256_set1_epi32(hi);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *) &src[i]);
+        _mm256_storeu_si256((__m256i *) &dst[i],
+                _mm256_min_epi32(_mm256_max_epi32(v, lo8), hi8));
+    }
+    scalar_clamp(&dst[i], &src[i], n - i, lo, hi);
+}
+
+VEC_AVX2_FN static size_t avx2_range(int *dst, const int *src, size_t n,
+        int lo, int hi) {
+    const __m256i lo8 = _mm256_set1_epi32(lo), hi8 = _mm256_set1_epi32(hi);
+    const __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256i nibble = _mm256_set1_epi32(0xf);
+    size_t count = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *) &src[i]);
+        const __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(lo8, v),
+                _mm256_cmpgt_epi32(v, hi8));
+        const int bits = ~_mm256_movemask_ps(_mm256_castsi256_ps(out)) & 0xff;
+        if (!bits) {
+            continue;
+        }
+        /*
+         * Pack the lanes that pass to the front and store all eight.  Any
+         * lanes past them are overwritten later, or lie beyond the result.
+         */
+        const __m256i lanes = _mm256_and_si256(nibble, _mm256_srlv_epi32(
+                _mm256_set1_epi32((int) vec_pack[bits]), shifts));
+        _mm256_storeu_si256((__m256i *) &dst[count],
+                _mm256_permutevar8x32_epi32(v, lanes));
+        count += __builtin_popcount(bits);
+    }
+    return count + scalar_range(&dst[count], &src[i], n - i, lo, hi);
+}
+#endif
+
+static const struct vec_kernels vec_table[] = {
+    {VEC_SCALAR, scalar_sum, scalar_min, scalar_max, scalar_count,
+        scalar_add, scalar_mul, scalar_clamp, scalar_range},
+#ifdef VEC_X86
+    {VEC_SSE2, sse2_sum, sse2_min, sse2_max, sse2_count,
+        sse2_add, sse2_mul, sse2_clamp, sse2_range},
+    {VEC_AVX2, avx2_sum, avx2_min, avx2_max, avx2_count,
+        avx2_add, avx2_mul, avx2_clamp, avx2_range},
+#endif
+};
+
+static _Atomic(const struct vec_kernels *) vec_kernels = 0;
+
+/*
+ * Return the highest level the CPU supports.
+ */
+static enum vec_level vec_best(void) {
+#ifdef VEC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return VEC_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return VEC_SSE2;
+    }
+#endif
+    return VEC_SCALAR;
+}
+
+static inline const struct vec_kernels *vec_get(void) {
+    const struct vec_kernels *k = atomic_load_explicit(&vec_kernels,
+            memory_order_relaxed);
+    if (!k) {
+        k = &vec_table[vec_best()];
+        atomic_store_explicit(&vec_kernels, k, memory_order_relaxed);
+    }
+    return k;
+}
+
+/*
+ * Return the level of the kernels in use.
+ */
+enum vec_level vec_level(void) {
+    return vec_get()->level;
+}
+
+/*
+ * Use the kernels for level 'level', or for the highest level the CPU
+ * supports if that is lower, for every thread.  Return the level now in use.
+ */
+enum vec_level vec_use(enum vec_level level) {
+    const enum vec_level best = vec_best();
+    const struct vec_kernels *k = &vec_table[level < best ? level : best];
+    atomic_store_explicit(&vec_kernels, k, memory_order_relaxed);
+    return k->level;
+}
+
+/*
+ * Return the sum of the 'n' values at 'src', which cannot overflow.
+ */
+long long vec_sum(const int *src, size_t n) {
+    return vec_get()->sum(src, n);
+}
+
+/*
+ * Return the least of the 'n' values at 'src', or INT_MAX if 'n' is zero.
+ */
+int vec_min(const int *src, size_t n) {
+    return vec_get()->min(src, n);
+}
+
+/*
+ * Return the greatest of the 'n' values at 'src', or INT_MIN if 'n' is zero.
+ */
+int vec_max(const int *src, size_t n) {
+    return vec_get()->max(src, n);
+}
+
+/*
+ * Return how many of the 'n' values at 'src' are equal to 'value'.
+ */
+size_t vec_count(const int *src, size_t n, int value) {
+    return vec_get()->count(src, n, value);
+}
+
+void vec_add(int *dst, const int *src, size_t n, int k) {
+    vec_get()->add(dst, src, n, k);
+}
+
+void vec_mul(int *dst, const int *src, size_t n, int k) {
+    vec_get()->mul(dst, src, n, k);
+}
+
+/*
+ * Write each value, raised to 'lo' and then lowered to 'hi', to 'dst'.
+ */
+void vec_clamp(int *dst, const int *src, size_t n, int lo, int hi) {
+    vec_get()->clamp(dst, src, n, lo, hi);
+}
+
+size_t vec_filter_lt(int *dst, const int *src, size_t n, int k) {
+    return k == INT_MIN ? 0 : vec_get()->range(dst, src, n, INT_MIN, k - 1);
+}
+
+size_t vec_filter_gt(int *dst, const int *src, size_t n, int k) {
+    return k == INT_MAX ? 0 : vec_get()->range(dst, src, n, k + 1, INT_MAX);
+}
+
+size_t vec_filter_eq(int *dst, const int *src, size_t n, int k) {
+    return vec_get()->range(dst, src, n, k, k);
+}
+
+/*
+ * Write the values from 'lo' to 'hi' inclusive to 'dst'.
+ */
+size_t vec_filter_range(int *dst, const int *src, size_t n, int lo, int hi) {
+    return vec_get()->range(dst, src, n, lo, hi);
+}
+
+/*
+ * Run operation 'op' on the 'n' values at 'src', writing the results to
+ * 'dst'.  Return the number of values written: 'n' for a transform, or the
+ * number that pass for a filter.
+ */
+size_t vec_apply(enum vec_op op, int *dst, const int *src, size_t n, int a,
+        int b) {
+    switch (op) {
+        case VEC_ADD:
+            vec_add(dst, src, n, a);
+            return n;
+        case VEC_MUL:
+            vec_mul(dst, src, n, a);
+            return n;
+        case VEC_CLAMP:
+            vec_clamp(dst, src, n, a, b);
+            return n;
+        case VEC_LT:
+            return vec_filter_lt(dst, src, n, a);
+        case VEC_GT:
+            return vec_filter_gt(dst, src, n, a);
+        case VEC_EQ:
+            return vec_filter_eq(dst, src, n, a);
+        case VEC_RANGE:
+            return vec_filter_range(dst, src, n, a, b);
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef VEC_H
+#define VEC_H
+
+#include <stddef.h>
+
+/*
+ * Built-in operations over arrays of ints, run as SIMD kernels.
+ *
+ * Each operation has a plain C version, and on x86 an SSE2 and an AVX2
+ * version.  The best one the CPU supports is picked on first use; vec_use()
+ * picks a lower level instead, for testing and benchmarking.
+ *
+ * The transforms write 'n' results to 'dst', and the filters write the values
+ * that pass, in order, returning how many there are.  'dst' must have room
+ * for 'n' values, and may be the same array as 'src'.  Arithmetic wraps
+ * around on overflow, as it would in unsigned arithmetic.
+ */
+enum vec_level {
+    VEC_SCALAR,
+    VEC_SSE2,
+    VEC_AVX2
+};
+
+enum vec_level vec_level(void);
+enum vec_level vec_use(enum vec_level);
+
+long long vec_sum(const int *src, size_t n);
+int vec_min(const int *src, size_t n);
+int vec_max(const int *src, size_t n);
+size_t vec_count(const int *src, size_t n, int value);
+
+void vec_add(int *dst, const int *src, size_t n, int k);
+void vec_mul(int *dst, const int *src, size_t n, int k);
+void vec_clamp(int *dst, const int *src, size_t n, int lo, int hi);
+
+size_t vec_filter_lt(int *dst, const int *src, size_t n, int k);
+size_t vec_filter_gt(int *dst, const int *src, size_t n, int k);
+size_t vec_filter_eq(int *dst, const int *src, size_t n, int k);
+size_t vec_filter_range(int *dst, const int *src, size_t n, int lo, int hi);
+
+/*
+ * The transforms and filters by name, for callers such as the lists that pick
+ * one at run time and apply it a run of values at a time with vec_apply().
+ * Operations that take one argument take it as 'a'; clamp and range take
+ * 'lo' as 'a' and 'hi' as 'b'.
+ */
+enum vec_op {
+    VEC_ADD,
+    VEC_MUL,
+    VEC_CLAMP,
+    VEC_LT,
+    VEC_GT,
+    VEC_EQ,
+    VEC_RANGE
+};
+
+size_t vec_apply(enum vec_op op, int *dst, const int *src, size_t n, int a,
+        int b);
+
+#endif